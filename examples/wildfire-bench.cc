@@ -0,0 +1,690 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/wildfire-module.h"
+
+// Micro benchmarks for the wildfire module.  Each benchmark is selected
+// with --bench and runs without a simulation topology.
+//
+//   ./waf --run "wildfire-bench --bench=auth"
+//   ./waf --run "wildfire-bench --bench=geo --nSubscribers=1000000"
+//   ./waf --run "wildfire-bench --bench=beacon --payloadSize=1000"
+//   ./waf --run "wildfire-bench --bench=routing --nEvacuees=50000"
+//   ./waf --run "wildfire-bench --bench=congestion --nEvacuees=100000"
+//   ./waf --run "wildfire-bench --bench=mobility --nEvacuees=100000"
+//   ./waf --run "wildfire-bench --bench=position --nNodes=1000"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("wildfire bench");
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double
+ElapsedSeconds (Clock::time_point start)
+{
+  return std::chrono::duration<double> (Clock::now () - start).count ();
+}
+
+/// Notification verification with and without the (id, hash) cache while
+/// every notification is heard nCopies times from rebroadcasting neighbours
+void
+BenchAuth (uint32_t nNotifications, uint32_t nCopies)
+{
+  Ed25519Seed privateKey;
+  privateKey.fill (7);
+  Ed25519PublicKey key = Ed25519GetPublicKey (privateKey);
+  std::vector<WildfireMessage> notifications;
+  for (uint32_t i = 0; i < nNotifications; ++i)
+    {
+      WildfireMessage message (i, WildfireMessageType::notification, Seconds (30), "Level 2 Alert");
+      message.sign (privateKey);
+      notifications.push_back (message);
+    }
+
+  std::vector<uint32_t> flood;
+  for (uint32_t i = 0; i < nNotifications; ++i)
+    {
+      flood.insert (flood.end (), nCopies, i);
+    }
+  std::mt19937 rng (1);
+  std::shuffle (flood.begin (), flood.end (), rng);
+
+  uint64_t valid = 0;
+  Clock::time_point start = Clock::now ();
+  for (uint32_t index : flood)
+    {
+      valid += notifications[index].isValid (key);
+    }
+  double uncached = ElapsedSeconds (start);
+
+  WildfireVerifyCache cache;
+  cache.SetCapacity (nNotifications);
+  start = Clock::now ();
+  for (uint32_t index : flood)
+    {
+      const WildfireMessage &message = notifications[index];
+      uint8_t fields[WildfireMessage::MAX_SIGNED_FIELDS_SIZE];
+      uint32_t fieldsSize = message.getSignedFields (fields);
+      const uint8_t *payload = reinterpret_cast<const uint8_t*> (message.getMessage ().data ());
+      bool result;
+      if (!cache.Lookup (message.getId (), message.getHash (), fields, fieldsSize,
+                         payload, message.getMessage ().size (), result))
+        {
+          result = message.isValid (key);
+          cache.Insert (message.getId (), message.getHash (), fields, fieldsSize,
+                        payload, message.getMessage ().size (), result);
+        }
+      valid += result;
+    }
+  double cached = ElapsedSeconds (start);
+
+  std::cout << "auth: " << flood.size () << " packets, " << valid << " valid" << std::endl;
+  std::cout << "  Ed25519 verifications/sec: " << flood.size () / uncached << std::endl;
+  std::cout << "  cached verifications/sec:  " << flood.size () / cached << std::endl;
+  std::cout << "  cache hit rate:           "
+            << static_cast<double> (cache.GetHits ()) / (cache.GetHits () + cache.GetMisses ()) << std::endl;
+}
+
+/// Subscribers inside a circular alert zone, grid query against a scan of
+/// every subscriber in a square county of the given side
+void
+BenchGeo (uint32_t nSubscribers, uint32_t nQueries, double side, double radius)
+{
+  std::mt19937 rng (1);
+  std::uniform_real_distribution<double> coordinate (0, side);
+
+  WildfireSubscriberRegistry registry;
+  registry.Reserve (nSubscribers);
+  for (uint32_t i = 0; i < nSubscribers; ++i)
+    {
+      registry.Subscribe (i, Address (), 0, Seconds (3600), Vector (coordinate (rng), coordinate (rng), 0));
+    }
+
+  std::vector<WildfireTargetArea> areas;
+  for (uint32_t i = 0; i < nQueries; ++i)
+    {
+      areas.push_back (WildfireTargetArea::Circle (Vector (coordinate (rng), coordinate (rng), 0), radius));
+    }
+
+  uint64_t scanned = 0;
+  Clock::time_point start = Clock::now ();
+  for (const WildfireTargetArea &area : areas)
+    {
+      for (uint32_t slot = 0; slot < registry.GetSlotCount (); ++slot)
+        {
+          scanned += area.Contains (registry.GetSlot (slot).position);
+        }
+    }
+  double scan = ElapsedSeconds (start);
+
+  uint64_t found = 0;
+  std::vector<uint32_t> slots;
+  start = Clock::now ();
+  for (const WildfireTargetArea &area : areas)
+    {
+      slots.clear ();
+      registry.Query (area, slots);
+      found += slots.size ();
+    }
+  double grid = ElapsedSeconds (start);
+
+  std::cout << "geo: " << nSubscribers << " subscribers, " << nQueries << " queries of radius " << radius << "m" << std::endl;
+  std::cout << "  subscribers per query:  " << static_cast<double> (found) / nQueries
+            << " (scan " << static_cast<double> (scanned) / nQueries << ")" << std::endl;
+  std::cout << "  scan queries/sec:       " << nQueries / scan << std::endl;
+  std::cout << "  grid queries/sec:       " << nQueries / grid << std::endl;
+}
+
+/// Peers within range of each node in a random field
+std::vector<std::vector<uint32_t> >
+MakeNeighbours (const std::vector<Vector> &positions, double range)
+{
+  std::vector<std::vector<uint32_t> > neighbours (positions.size ());
+  for (uint32_t i = 0; i < positions.size (); ++i)
+    {
+      for (uint32_t j = i + 1; j < positions.size (); ++j)
+        {
+          if (CalculateDistance (positions[i], positions[j]) <= range)
+            {
+              neighbours[i].push_back (j);
+              neighbours[j].push_back (i);
+            }
+        }
+    }
+  return neighbours;
+}
+
+/// Bytes on air per delivered notification for flooding (every node
+/// rebroadcasts every notification it holds each round) against digest
+/// beacons with pulls.  Rounds stand for BroadcastInterval, a transmission
+/// reaches every peer within range and nothing is lost.
+void
+BenchBeacon (uint32_t nNodes, double field, double range, uint32_t nNotifications,
+             uint32_t payloadSize, uint32_t rounds)
+{
+  if (nNodes == 0 || nNotifications == 0)
+    {
+      NS_FATAL_ERROR ("Beacon needs at least one node and one notification");
+    }
+  std::mt19937 rng (1);
+  std::uniform_real_distribution<double> coordinate (0, field);
+  std::vector<Vector> positions;
+  for (uint32_t i = 0; i < nNodes; ++i)
+    {
+      positions.push_back (Vector (coordinate (rng), coordinate (rng), 0));
+    }
+  std::vector<std::vector<uint32_t> > neighbours = MakeNeighbours (positions, range);
+
+  Ed25519Seed privateKey;
+  privateKey.fill (7);
+  std::vector<WildfireMessage> notifications;
+  std::vector<uint32_t> seeds;
+  std::uniform_int_distribution<uint32_t> node (0, nNodes - 1);
+  for (uint32_t i = 0; i < nNotifications; ++i)
+    {
+      WildfireMessage message (i, WildfireMessageType::notification, Seconds (3600), std::string (payloadSize, 'x'));
+      message.sign (privateKey);
+      notifications.push_back (message);
+      seeds.push_back (node (rng));
+    }
+  uint32_t notificationSize = notifications[0].toPacket (WildfireWireFormat::binary)->GetSize ();
+
+  // held[n][m]: node n holds notification m
+  std::vector<std::vector<bool> > initial (nNodes, std::vector<bool> (nNotifications, false));
+  for (uint32_t m = 0; m < nNotifications; ++m)
+    {
+      initial[seeds[m]][m] = true;
+    }
+
+  // Flooding
+  std::vector<std::vector<bool> > held = initial;
+  uint64_t floodBytes = 0;
+  uint64_t floodDelivered = 0;
+  for (uint32_t round = 0; round < rounds; ++round)
+    {
+      std::vector<std::vector<bool> > next = held;
+      for (uint32_t n = 0; n < nNodes; ++n)
+        {
+          for (uint32_t m = 0; m < nNotifications; ++m)
+            {
+              if (!held[n][m])
+                {
+                  continue;
+                }
+              floodBytes += notificationSize;
+              for (uint32_t peer : neighbours[n])
+                {
+                  floodDelivered += !next[peer][m];
+                  next[peer][m] = true;
+                }
+            }
+        }
+      held.swap (next);
+    }
+
+  // Digest beacons, a node missing something pulls it from the first
+  // beacon that advertises it this round
+  held = initial;
+  uint64_t beaconBytes = 0;
+  uint64_t beaconDelivered = 0;
+  for (uint32_t round = 0; round < rounds; ++round)
+    {
+      std::vector<std::vector<bool> > next = held;
+      std::vector<std::vector<bool> > pulled (nNodes, std::vector<bool> (nNotifications, false));
+      for (uint32_t n = 0; n < nNodes; ++n)
+        {
+          WildfireDigest digest;
+          for (uint32_t m = 0; m < nNotifications; ++m)
+            {
+              if (held[n][m])
+                {
+                  digest.Add (notifications[m]);
+                }
+            }
+          if (digest.IsEmpty ())
+            {
+              continue;
+            }
+          WildfireMessage beacon (round, WildfireMessageType::digest, Seconds (1), digest.Serialize ());
+          beaconBytes += beacon.toPacket (WildfireWireFormat::binary)->GetSize ();
+
+          for (uint32_t peer : neighbours[n])
+            {
+              WildfireDigest missing;
+              for (uint32_t m = 0; m < nNotifications; ++m)
+                {
+                  if (held[n][m] && !held[peer][m] && !pulled[peer][m])
+                    {
+                      missing.Add (notifications[m]);
+                      pulled[peer][m] = true;
+                    }
+                }
+              if (missing.IsEmpty ())
+                {
+                  continue;
+                }
+              WildfireMessage request (round, WildfireMessageType::pull, Seconds (1), missing.Serialize ());
+              beaconBytes += request.toPacket (WildfireWireFormat::binary)->GetSize ();
+              beaconBytes += missing.GetN () * static_cast<uint64_t> (notificationSize);
+              beaconDelivered += missing.GetN ();
+              for (uint32_t i = 0; i < missing.GetN (); ++i)
+                {
+                  next[peer][missing.Get (i).id] = true;
+                }
+            }
+        }
+      held.swap (next);
+    }
+
+  std::cout << "beacon: " << nNodes << " nodes, " << nNotifications << " notifications of "
+            << notificationSize << " bytes, " << rounds << " rounds, digest and pull headers of "
+            << WildfireHeader::COMPACT_SIZE << " bytes" << std::endl;
+  std::cout << "  flood:  " << floodBytes << " bytes, " << floodDelivered << " delivered, "
+            << (floodDelivered > 0 ? static_cast<double> (floodBytes) / floodDelivered : 0) << " bytes/delivery" << std::endl;
+  std::cout << "  beacon: " << beaconBytes << " bytes, " << beaconDelivered << " delivered, "
+            << (beaconDelivered > 0 ? static_cast<double> (beaconBytes) / beaconDelivered : 0) << " bytes/delivery" << std::endl;
+}
+
+/// Evacuation routes on a county sized road grid with jittered
+/// intersections and missing roads, cached shelter tree lookups against an
+/// A* search per evacuee to the closest shelter in a straight line
+void
+BenchRouting (uint32_t nEvacuees, uint32_t gridSide, double spacing, uint32_t nShelters, uint32_t nSearches)
+{
+  if (gridSide == 0 || nShelters == 0)
+    {
+      NS_FATAL_ERROR ("Routing needs a grid of at least one node and one shelter");
+    }
+  std::mt19937 rng (1);
+  std::uniform_real_distribution<double> jitter (-0.3 * spacing, 0.3 * spacing);
+  std::bernoulli_distribution road (0.9);
+
+  Ptr<WildfireRoadGraph> graph = Create<WildfireRoadGraph> ();
+  for (uint32_t row = 0; row < gridSide; ++row)
+    {
+      for (uint32_t column = 0; column < gridSide; ++column)
+        {
+          graph->AddNode (Vector (column * spacing + jitter (rng), row * spacing + jitter (rng), 0));
+          uint32_t node = row * gridSide + column;
+          if (column > 0 && road (rng))
+            {
+              graph->AddEdge (node - 1, node);
+            }
+          if (row > 0 && road (rng))
+            {
+              graph->AddEdge (node - gridSide, node);
+            }
+        }
+    }
+  std::uniform_int_distribution<uint32_t> node (0, gridSide * gridSide - 1);
+  std::vector<uint32_t> shelters;
+  for (uint32_t i = 0; i < nShelters; ++i)
+    {
+      shelters.push_back (node (rng));
+    }
+
+  Clock::time_point start = Clock::now ();
+  graph->Build ();
+  double build = ElapsedSeconds (start);
+  start = Clock::now ();
+  graph->SetShelters (shelters);
+  double tree = ElapsedSeconds (start);
+
+  std::uniform_real_distribution<double> coordinate (0, (gridSide - 1) * spacing);
+  std::vector<Vector> evacuees;
+  for (uint32_t i = 0; i < nEvacuees; ++i)
+    {
+      evacuees.push_back (Vector (coordinate (rng), coordinate (rng), 0));
+    }
+
+  uint64_t waypoints = 0;
+  start = Clock::now ();
+  for (const Vector &position : evacuees)
+    {
+      waypoints += graph->GetEvacuationRoute (position)->size ();
+    }
+  double cached = ElapsedSeconds (start);
+
+  nSearches = std::min (nSearches, nEvacuees);
+  uint64_t searched = 0;
+  start = Clock::now ();
+  for (uint32_t i = 0; i < nSearches; ++i)
+    {
+      uint32_t from = graph->FindNearestNode (evacuees[i]);
+      uint32_t closest = shelters[0];
+      for (uint32_t shelter : shelters)
+        {
+          if (CalculateDistance (graph->GetPosition (from), graph->GetPosition (shelter))
+              < CalculateDistance (graph->GetPosition (from), graph->GetPosition (closest)))
+            {
+              closest = shelter;
+            }
+        }
+      searched += graph->FindPath (from, closest).size ();
+    }
+  double search = ElapsedSeconds (start);
+
+  std::cout << "routing: " << graph->GetNNodes () << " intersections, " << graph->GetNEdges () << " roads, "
+            << nShelters << " shelters, " << nEvacuees << " evacuees" << std::endl;
+  std::cout << "  CSR build:              " << build << "s" << std::endl;
+  std::cout << "  shelter tree:           " << tree << "s" << std::endl;
+  std::cout << "  cached routes/sec:      " << nEvacuees / cached
+            << " (hit rate " << static_cast<double> (graph->GetCacheHits ()) / nEvacuees
+            << ", " << static_cast<double> (waypoints) / nEvacuees << " waypoints)" << std::endl;
+  std::cout << "  A* searches/sec:        " << nSearches / search
+            << " (" << static_cast<double> (searched) / std::max<uint32_t> (nSearches, 1) << " waypoints)" << std::endl;
+}
+
+/// Congestion ticks of evacuees converging on a few exits of a square
+/// county, timed inside a simulation
+void
+BenchCongestion (uint32_t nEvacuees, double side, uint32_t nExits, uint32_t nTicks)
+{
+  if (nExits == 0 || nTicks == 0)
+    {
+      NS_FATAL_ERROR ("Congestion needs at least one exit and one tick");
+    }
+  std::mt19937 rng (1);
+  std::uniform_real_distribution<double> coordinate (0, side);
+  std::uniform_int_distribution<uint32_t> exit (0, nExits - 1);
+  std::vector<Vector> exits;
+  for (uint32_t i = 0; i < nExits; ++i)
+    {
+      exits.push_back (Vector (coordinate (rng), coordinate (rng), 0));
+    }
+
+  Ptr<WildfireCongestion> congestion = Create<WildfireCongestion> ();
+  for (uint32_t i = 0; i < nEvacuees; ++i)
+    {
+      Ptr<WildfireMobilityModel> mobility = CreateObject<WildfireMobilityModel> ();
+      mobility->SetPosition (Vector (coordinate (rng), coordinate (rng), 0));
+      mobility->SetRoute (std::vector<Vector> (1, exits[exit (rng)]), 10);
+      congestion->Add (mobility);
+    }
+  congestion->Start ();
+  Simulator::Stop (Seconds (nTicks - 0.5));
+  Clock::time_point start = Clock::now ();
+  Simulator::Run ();
+  double run = ElapsedSeconds (start);
+
+  std::cout << "congestion: " << nEvacuees << " evacuees, " << nExits << " exits, "
+            << congestion->GetUpdates () << " ticks" << std::endl;
+  std::cout << "  update cost per tick:   "
+            << (congestion->GetUpdates () > 0 ? congestion->GetTotalUpdateCost () / congestion->GetUpdates () : 0)
+            << "s" << std::endl;
+  std::cout << "  last update cost:       " << congestion->GetLastUpdateCost () << "s" << std::endl;
+  std::cout << "  simulation wall clock:  " << run << "s" << std::endl;
+  congestion->Stop ();
+  Simulator::Destroy ();
+}
+
+/// Two identical populations, one of standalone mobility models and one
+/// bound to an engine, sampled at the same times
+struct MobilitySamples
+{
+  std::vector<Ptr<WildfireMobilityModel> > objects; //!< Standalone models
+  std::vector<Ptr<WildfireMobilityModel> > views; //!< Models bound to engine
+  Ptr<WildfireMobilityEngine> engine; //!< Shared kinematic state
+  std::vector<double> x; //!< Batch x positions
+  std::vector<double> y; //!< Batch y positions
+  double objectTime = 0; //!< Wall clock of the standalone queries
+  double viewTime = 0; //!< Wall clock of the per-object queries through the engine
+  double batchTime = 0; //!< Wall clock of the batch queries
+  double maxError = 0; //!< Largest batch position error in meters
+  double checksum = 0; //!< Keeps the queries from being optimized out
+  uint32_t samples = 0; //!< Number of sampling rounds
+};
+
+void
+SampleMobility (MobilitySamples *samples)
+{
+  uint32_t n = samples->objects.size ();
+  std::vector<Vector> reference (n);
+  Clock::time_point start = Clock::now ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      reference[i] = samples->objects[i]->GetPosition ();
+    }
+  samples->objectTime += ElapsedSeconds (start);
+
+  start = Clock::now ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      samples->checksum += samples->views[i]->GetPosition ().x;
+    }
+  samples->viewTime += ElapsedSeconds (start);
+
+  start = Clock::now ();
+  samples->engine->GetPositions (Simulator::Now (), samples->x, samples->y);
+  samples->batchTime += ElapsedSeconds (start);
+
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      uint32_t slot = samples->views[i]->GetEngineSlot ();
+      samples->maxError = std::max (samples->maxError, std::abs (samples->x[slot] - reference[i].x));
+      samples->maxError = std::max (samples->maxError, std::abs (samples->y[slot] - reference[i].y));
+    }
+  ++samples->samples;
+}
+
+/// Positions per second of the per-object mobility models against the
+/// batch query of the engine, on evacuees with multi-waypoint routes
+void
+BenchMobility (uint32_t nEvacuees, double side, uint32_t nTicks)
+{
+  std::mt19937 rng (1);
+  std::uniform_real_distribution<double> coordinate (0, side);
+  MobilitySamples samples;
+  samples.engine = Create<WildfireMobilityEngine> ();
+  for (uint32_t i = 0; i < nEvacuees; ++i)
+    {
+      Vector position (coordinate (rng), coordinate (rng), 0);
+      std::vector<Vector> route;
+      for (uint32_t j = 0; j < 4; ++j)
+        {
+          route.push_back (Vector (coordinate (rng), coordinate (rng), 0));
+        }
+      Ptr<WildfireMobilityModel> object = CreateObject<WildfireMobilityModel> ();
+      object->SetPosition (position);
+      object->SetRoute (route, 10);
+      samples.objects.push_back (object);
+      Ptr<WildfireMobilityModel> view = CreateObject<WildfireMobilityModel> ();
+      view->SetPosition (position);
+      view->SetEngine (samples.engine);
+      view->SetRoute (route, 10);
+      samples.views.push_back (view);
+    }
+  for (uint32_t tick = 1; tick <= nTicks; ++tick)
+    {
+      Simulator::Schedule (Seconds (tick), &SampleMobility, &samples);
+    }
+  Simulator::Run ();
+
+  double positions = static_cast<double> (nEvacuees) * samples.samples;
+  std::cout << "mobility: " << nEvacuees << " evacuees, " << samples.samples << " samples" << std::endl;
+  std::cout << "  per-object positions/s:   " << positions / samples.objectTime << std::endl;
+  std::cout << "  engine view positions/s:  " << positions / samples.viewTime << std::endl;
+  std::cout << "  batch positions/s:        " << positions / samples.batchTime << std::endl;
+  std::cout << "  max batch error:          " << samples.maxError << "m" << std::endl;
+  NS_LOG_INFO ("checksum " << samples.checksum);
+  Simulator::Destroy ();
+}
+
+/// One broadcast: the channel queries the position of every receiver
+/// nQueries times, for the models with and without the position cache
+void
+BroadcastPositions (std::vector<Ptr<WildfireMobilityModel> > *cached,
+                    std::vector<Ptr<WildfireMobilityModel> > *uncached,
+                    uint32_t nQueries, double *times, double *checksum)
+{
+  std::vector<Ptr<WildfireMobilityModel> > *populations[2] = {uncached, cached};
+  for (uint32_t p = 0; p < 2; ++p)
+    {
+      Clock::time_point start = Clock::now ();
+      for (const Ptr<WildfireMobilityModel> &mobility : *populations[p])
+        {
+          for (uint32_t q = 0; q < nQueries; ++q)
+            {
+              *checksum += mobility->GetPosition ().x;
+            }
+        }
+      times[p] += ElapsedSeconds (start);
+    }
+}
+
+/// GetPosition calls per second during broadcasts, with and without the
+/// per-timestamp position cache
+void
+BenchPosition (uint32_t nNodes, double field, uint32_t nBroadcasts, uint32_t nQueries)
+{
+  std::mt19937 rng (1);
+  std::uniform_real_distribution<double> coordinate (0, field);
+  std::vector<Ptr<WildfireMobilityModel> > cached;
+  std::vector<Ptr<WildfireMobilityModel> > uncached;
+  for (uint32_t i = 0; i < nNodes; ++i)
+    {
+      Vector position (coordinate (rng), coordinate (rng), 0);
+      std::vector<Vector> route;
+      for (uint32_t j = 0; j < 3; ++j)
+        {
+          route.push_back (Vector (coordinate (rng), coordinate (rng), 0));
+        }
+      for (uint32_t p = 0; p < 2; ++p)
+        {
+          Ptr<WildfireMobilityModel> mobility = CreateObject<WildfireMobilityModel> ();
+          mobility->SetAttribute ("PositionCache", BooleanValue (p == 1));
+          mobility->SetPosition (position);
+          mobility->SetRoute (route, 10);
+          (p == 1 ? cached : uncached).push_back (mobility);
+        }
+    }
+  double times[2] = {0, 0};
+  double checksum = 0;
+  for (uint32_t i = 0; i < nBroadcasts; ++i)
+    {
+      Simulator::Schedule (MilliSeconds (10 * (i + 1)), &BroadcastPositions, &cached, &uncached,
+                           nQueries, times, &checksum);
+    }
+  Simulator::Run ();
+
+  double calls = static_cast<double> (nNodes) * nBroadcasts * nQueries;
+  std::cout << "position: " << nNodes << " receivers, " << nBroadcasts << " broadcasts, "
+            << nQueries << " queries per receiver" << std::endl;
+  std::cout << "  uncached GetPosition/s: " << calls / times[0] << std::endl;
+  std::cout << "  cached GetPosition/s:   " << calls / times[1] << std::endl;
+  std::cout << "  per broadcast:          " << times[0] / nBroadcasts << "s -> "
+            << times[1] / nBroadcasts << "s" << std::endl;
+  NS_LOG_INFO ("checksum " << checksum);
+  Simulator::Destroy ();
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string bench = "auth";
+  uint32_t nNotifications = 100;
+  uint32_t nCopies = 100;
+  uint32_t nSubscribers = 100000;
+  uint32_t nQueries = 100;
+  double side = 50000;
+  double radius = 2000;
+  uint32_t nNodes = 200;
+  double field = 1000;
+  double range = 150;
+  uint32_t payloadSize = 100;
+  uint32_t rounds = 30;
+  uint32_t nEvacuees = 100000;
+  uint32_t gridSide = 300;
+  double spacing = 100;
+  uint32_t nShelters = 8;
+  uint32_t nSearches = 1000;
+  uint32_t nExits = 4;
+  uint32_t nTicks = 60;
+  uint32_t nBroadcasts = 1000;
+  uint32_t nPositionQueries = 6;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("bench", "Benchmark to run: auth, geo, beacon, routing, congestion, mobility, position", bench);
+  cmd.AddValue ("nNotifications", "Number of distinct notifications", nNotifications);
+  cmd.AddValue ("nCopies", "Number of times each notification is received", nCopies);
+  cmd.AddValue ("nSubscribers", "Number of subscribers (geo)", nSubscribers);
+  cmd.AddValue ("nQueries", "Number of target area queries (geo)", nQueries);
+  cmd.AddValue ("side", "Side of the square scenario area in meters (geo, congestion, mobility)", side);
+  cmd.AddValue ("radius", "Radius of the target area in meters (geo)", radius);
+  cmd.AddValue ("nNodes", "Number of peers (beacon, position)", nNodes);
+  cmd.AddValue ("field", "Side of the square peer field in meters (beacon, position)", field);
+  cmd.AddValue ("range", "Wi-Fi range in meters (beacon)", range);
+  cmd.AddValue ("payloadSize", "Alert payload size in bytes (beacon)", payloadSize);
+  cmd.AddValue ("rounds", "Broadcast intervals simulated (beacon)", rounds);
+  cmd.AddValue ("nEvacuees", "Number of evacuees routed (routing, congestion, mobility)", nEvacuees);
+  cmd.AddValue ("gridSide", "Intersections per side of the road grid (routing)", gridSide);
+  cmd.AddValue ("spacing", "Distance between intersections in meters (routing)", spacing);
+  cmd.AddValue ("nShelters", "Number of shelters (routing)", nShelters);
+  cmd.AddValue ("nSearches", "Evacuees routed with an A* search each (routing)", nSearches);
+  cmd.AddValue ("nExits", "Number of exits evacuees head for (congestion)", nExits);
+  cmd.AddValue ("nBroadcasts", "Number of broadcasts (position)", nBroadcasts);
+  cmd.AddValue ("nPositionQueries", "Position queries per receiver and broadcast (position)", nPositionQueries);
+  cmd.AddValue ("nTicks", "Number of one second ticks (congestion, mobility)", nTicks);
+  cmd.Parse (argc, argv);
+
+  if (bench == "auth")
+    {
+      BenchAuth (nNotifications, nCopies);
+    }
+  else if (bench == "geo")
+    {
+      BenchGeo (nSubscribers, nQueries, side, radius);
+    }
+  else if (bench == "beacon")
+    {
+      BenchBeacon (nNodes, field, range, nNotifications, payloadSize, rounds);
+    }
+  else if (bench == "routing")
+    {
+      BenchRouting (nEvacuees, gridSide, spacing, nShelters, nSearches);
+    }
+  else if (bench == "congestion")
+    {
+      BenchCongestion (nEvacuees, side, nExits, nTicks);
+    }
+  else if (bench == "mobility")
+    {
+      BenchMobility (nEvacuees, side, nTicks);
+    }
+  else if (bench == "position")
+    {
+      BenchPosition (nNodes, field, nBroadcasts, nPositionQueries);
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown benchmark " << bench);
+    }
+
+  return 0;
+}
@@ -46,7 +46,7 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("wildfire example");
 
-void disconnect (Ptr<NetDevice> router);
+void disconnect (Ptr<NetDevice> router, bool admissionControl);
 
 void RemainingEnergy (Ptr<OutputStreamWrapper> stream, double oldValue, double remainingEnergy);
 void TotalEnergy (Ptr<OutputStreamWrapper> stream, double oldValue, double totalEnergy);
@@ -55,12 +55,37 @@ static void PeerLogRecieved (Ptr<OutputStreamWrapper> stream);
 static void LogSent (Ptr<OutputStreamWrapper> stream);
 static void LogAck (Ptr<OutputStreamWrapper> stream);
 static void LogSub (Ptr<OutputStreamWrapper> stream);
+static void LogDuplicate (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet);
+static void LogDeferred (Ptr<OutputStreamWrapper> stream, Time delay);
+static void LogCollided (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet, WifiPhyRxfailureReason reason);
+static void LogSubscribeAttempt (Ptr<OutputStreamWrapper> stream, uint32_t attempt);
+static void LogSubscribed (Ptr<OutputStreamWrapper> stream, Time elapsed);
+static void LogFanoutComplete (Ptr<OutputStreamWrapper> stream, Time elapsed);
+static void LogHops (Ptr<OutputStreamWrapper> stream, uint32_t hops);
+static void LogDeliveryRatio (Ptr<OutputStreamWrapper> stream, uint32_t id, double ratio);
+static void LogRetransmit (Ptr<OutputStreamWrapper> stream, uint32_t id, uint32_t subscribers);
+static void LogPeerBytes (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet, const Address &from, const Address &to);
 
 uint64_t notifications_received = 0;
 uint64_t peer_notifications_received = 0;
 uint64_t total_sent_messages = 0;
 uint64_t total_notification_acks = 0;
 uint64_t total_subs = 0;
+uint64_t total_duplicates = 0;
+uint64_t total_deferred = 0;
+uint64_t total_collided = 0;
+uint64_t total_subscribe_attempts = 0;
+uint64_t total_subscribed = 0;
+Time total_subscribe_time;
+Time max_subscribe_time;
+Time max_fanout_time;
+double last_delivery_ratio = 0;
+uint64_t total_hops = 0;
+uint64_t total_hop_samples = 0;
+uint32_t max_hops_seen = 0;
+uint64_t total_retransmissions = 0;
+uint64_t total_peer_bytes = 0;
+Ipv4Address server_address;
 double total_power = 0;
 uint64_t total_dead_battery = 0;
 uint32_t nNodes = 2;
@@ -68,8 +93,27 @@ uint32_t nNodes = 2;
 int
 main (int argc, char *argv[])
 {
+  std::string broadcastMode = "Fixed";
+  std::string wireFormat = "Binary";
+  uint32_t maxSubscribeRate = 0;
+  bool timeline = false;
+  uint32_t maxHops = 255;
+  bool energyAware = false;
+  std::string roadGraph;
+  std::string mobilityTrace;
+  bool congestion = false;
+
   CommandLine cmd (__FILE__);
   cmd.AddValue ("nNodes", "Number of nodes to create", nNodes);
+  cmd.AddValue ("broadcastMode", "Client rebroadcast scheduling (Fixed, Trickle, Gossip or Beacon)", broadcastMode);
+  cmd.AddValue ("wireFormat", "Encoding of server and client messages (Binary or Text)", wireFormat);
+  cmd.AddValue ("maxHops", "Peer relays a notification may take", maxHops);
+  cmd.AddValue ("timeline", "Raise the evacuation level of zone 1 at 5s, 8s and 11s instead of a single alert", timeline);
+  cmd.AddValue ("energyAware", "Scale client rebroadcasts with remaining energy and duty cycle Wi-Fi when critical", energyAware);
+  cmd.AddValue ("roadGraph", "Edge list file of the roads and shelters clients evacuate along", roadGraph);
+  cmd.AddValue ("mobilityTrace", "Binary trace, or node,time,x,y CSV converted next to it, replayed by the UEs", mobilityTrace);
+  cmd.AddValue ("congestion", "Slow evacuees down with the node density around them", congestion);
+  cmd.AddValue ("maxSubscribeRate", "Subscriptions the server accepts per second, 0 for no limit", maxSubscribeRate);
   cmd.Parse (argc, argv);
 
   Time::SetResolution (Time::NS);
@@ -112,6 +156,7 @@ main (int argc, char *argv[])
   Ipv4InterfaceContainer internetIpIfaces = ipv4h.Assign (internetDevices);
   // interface 0 is localhost, 1 is the p2p device
   Ipv4Address remoteHostAddr = internetIpIfaces.GetAddress (1);
+  server_address = remoteHostAddr;
 
   Ipv4StaticRoutingHelper ipv4RoutingHelper;
   Ptr<Ipv4StaticRouting> remoteHostStaticRouting = ipv4RoutingHelper.GetStaticRouting (remoteHost->GetObject<Ipv4> ());
@@ -148,6 +193,22 @@ main (int argc, char *argv[])
   mobility.SetMobilityModel ("ns3::WildfireMobilityModel");
 
   mobility.Install (ueNodes);
+  if (!mobilityTrace.empty ())
+    {
+      std::string csv = ".csv";
+      if (mobilityTrace.size () > csv.size ()
+          && mobilityTrace.compare (mobilityTrace.size () - csv.size (), csv.size (), csv) == 0)
+        {
+          std::string converted = mobilityTrace.substr (0, mobilityTrace.size () - csv.size ()) + ".wft";
+          if (!WildfireMobilityTrace::ConvertCsv (mobilityTrace, converted))
+            {
+              NS_FATAL_ERROR ("Cannot convert mobility trace " << mobilityTrace);
+            }
+          mobilityTrace = converted;
+        }
+      WildfireTraceMobilityHelper traceMobility (mobilityTrace);
+      traceMobility.Install (ueNodes);
+    }
 
   // Install LTE Devices to the nodes
   Config::SetDefault ("ns3::LteEnbRrc::SrsPeriodicity", UintegerValue (80)); // must be more than number of UEnodes
@@ -179,7 +240,7 @@ main (int argc, char *argv[])
 
   /** Wifi Model **/
   NodeContainer wifiNodes;
-  for (int i = 0; i < ueNodes.GetN (); ++i)
+  for (uint32_t i = 0; i < ueNodes.GetN (); ++i)
     {
       wifiNodes.Add (ueNodes.Get (i));
     }
@@ -252,7 +313,7 @@ main (int argc, char *argv[])
   AsciiTraceHelper asciiTraceHelper2;
   Ptr<OutputStreamWrapper> stream2 = asciiTraceHelper2.CreateFileStream ("NoPowerCount.dat");
 
-  for (int i = 0; i < sources.GetN (); ++i)
+  for (uint32_t i = 0; i < sources.GetN (); ++i)
     {
       Ptr<BasicEnergySource> basicSourcePtr = DynamicCast<BasicEnergySource> (sources.Get (i));
       basicSourcePtr->TraceConnectWithoutContext ("RemainingEnergy", MakeBoundCallback (&RemainingEnergy, stream2));
@@ -272,50 +333,136 @@ main (int argc, char *argv[])
   address.Assign (wifiDevices);
 
   WildfireServerHelper echoServer (202);
+  echoServer.SetAttribute ("MaxSubscribeRate", UintegerValue (maxSubscribeRate));
+  echoServer.SetAttribute ("WireFormat", StringValue (wireFormat));
 
   ApplicationContainer serverApps = echoServer.Install (remoteHostContainer.Get (0));
   serverApps.Start (Seconds (1.0));
   //serverApps.Stop (Seconds (60.0));
   // Delaying notification 60 seconds to give enought time for initialization
-  echoServer.ScheduleNotification (serverApps.Get (0), Seconds (5.0));
+  if (timeline)
+    {
+      std::vector<WildfireLevelChange> changes;
+      changes.push_back (WildfireLevelChange {Seconds (5.0), 1, 1, WildfireTargetArea ()});
+      changes.push_back (WildfireLevelChange {Seconds (8.0), 1, 2, WildfireTargetArea ()});
+      // The last level sends the evacuation route along
+      std::vector<Vector> route;
+      route.push_back (Vector (10000, 10000, 0));
+      route.push_back (Vector (17500, 10000, 0));
+      route.push_back (Vector (17500, 17500, 0));
+      changes.push_back (WildfireLevelChange {Seconds (11.0), 1, 3, WildfireTargetArea (), route});
+      echoServer.ScheduleTimeline (serverApps.Get (0), changes);
+    }
+  else
+    {
+      echoServer.ScheduleNotification (serverApps.Get (0), Seconds (5.0));
+    }
 
   WildfireClientHelper echoClient (remoteHostAddr, 202, 202);
   echoClient.SetAttribute ("BroadcastInterval", TimeValue (Seconds (1.0)));
+  echoClient.SetAttribute ("BroadcastMode", StringValue (broadcastMode));
+  echoClient.SetAttribute ("WireFormat", StringValue (wireFormat));
+  echoClient.SetAttribute ("MaxHops", UintegerValue (maxHops));
+  echoClient.SetAttribute ("EnergyAware", BooleanValue (energyAware));
+  if (!roadGraph.empty ())
+    {
+      Ptr<WildfireRoadGraph> graph = Create<WildfireRoadGraph> ();
+      if (!graph->Load (roadGraph))
+        {
+          NS_FATAL_ERROR ("Cannot load road graph " << roadGraph);
+        }
+      echoClient.SetRoadGraph (graph);
+    }
+  // Clients verify notifications relayed by peers before their own
+  // subscription is acked, or after the disruption cut them off
+  echoClient.SetServerKey (serverApps.Get (0));
 
   ApplicationContainer clientApps = echoClient.Install (wifiNodes);
+  echoClient.AssignStreams (wifiNodes, 0);
   clientApps.Start (Seconds (2.0));
   //clientApps.Stop (Seconds (60.0));
 
-  for ( int i = 0; i < clientApps.GetN (); ++i)
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
     {
       echoClient.ScheduleSubscription (clientApps.Get (i), Seconds (2.5), remoteHostAddr );
     }
 
   AsciiTraceHelper asciiTraceHelper;
   Ptr<OutputStreamWrapper> stream = asciiTraceHelper.CreateFileStream ("NotificationCount.dat");
-  for ( int i = 0; i < clientApps.GetN (); ++i)
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
     {
       clientApps.Get (i)->TraceConnectWithoutContext ("RxNotification", MakeBoundCallback (&LogRecieved, stream));
     }
 
   stream = asciiTraceHelper.CreateFileStream ("PeerNotificationCount.dat");
-  for ( int i = 0; i < clientApps.GetN (); ++i)
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
     {
       clientApps.Get (i)->TraceConnectWithoutContext ("RxPeerNotification", MakeBoundCallback (&PeerLogRecieved, stream));
     }
 
 
   stream = asciiTraceHelper.CreateFileStream ("SentCount.dat");
-  for ( int i = 0; i < clientApps.GetN (); ++i)
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
     {
       clientApps.Get (i)->TraceConnectWithoutContext ("Tx", MakeBoundCallback (&LogSent, stream));
     }
 
   serverApps.Get (0)->TraceConnectWithoutContext ("Tx", MakeBoundCallback (&LogSent, stream));
 
+  stream = asciiTraceHelper.CreateFileStream ("DuplicateCount.dat");
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
+    {
+      clientApps.Get (i)->TraceConnectWithoutContext ("DuplicatesDropped", MakeBoundCallback (&LogDuplicate, stream));
+    }
+
+  stream = asciiTraceHelper.CreateFileStream ("HopsToDelivery.dat");
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
+    {
+      clientApps.Get (i)->TraceConnectWithoutContext ("HopsToDelivery", MakeBoundCallback (&LogHops, stream));
+    }
+
+  stream = asciiTraceHelper.CreateFileStream ("PeerBytes.dat");
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
+    {
+      clientApps.Get (i)->TraceConnectWithoutContext ("TxWithAddresses", MakeBoundCallback (&LogPeerBytes, stream));
+    }
+
+  stream = asciiTraceHelper.CreateFileStream ("DeferredCount.dat");
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
+    {
+      clientApps.Get (i)->TraceConnectWithoutContext ("TxDeferred", MakeBoundCallback (&LogDeferred, stream));
+    }
+
+  stream = asciiTraceHelper.CreateFileStream ("CollidedCount.dat");
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
+    {
+      clientApps.Get (i)->TraceConnectWithoutContext ("TxCollided", MakeBoundCallback (&LogCollided, stream));
+    }
+
   stream = asciiTraceHelper.CreateFileStream ("AckCount.dat");
   serverApps.Get (0)->TraceConnectWithoutContext ("Ack", MakeBoundCallback (&LogAck, stream));
 
+  stream = asciiTraceHelper.CreateFileStream ("SubscribeAttempts.dat");
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
+    {
+      clientApps.Get (i)->TraceConnectWithoutContext ("SubscribeAttempt", MakeBoundCallback (&LogSubscribeAttempt, stream));
+    }
+
+  stream = asciiTraceHelper.CreateFileStream ("SubscribeTime.dat");
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
+    {
+      clientApps.Get (i)->TraceConnectWithoutContext ("Subscribed", MakeBoundCallback (&LogSubscribed, stream));
+    }
+
+  stream = asciiTraceHelper.CreateFileStream ("FanoutTime.dat");
+  serverApps.Get (0)->TraceConnectWithoutContext ("FanoutComplete", MakeBoundCallback (&LogFanoutComplete, stream));
+
+  stream = asciiTraceHelper.CreateFileStream ("DeliveryRatio.dat");
+  serverApps.Get (0)->TraceConnectWithoutContext ("DeliveryRatio", MakeBoundCallback (&LogDeliveryRatio, stream));
+
+  stream = asciiTraceHelper.CreateFileStream ("RetransmitCount.dat");
+  serverApps.Get (0)->TraceConnectWithoutContext ("Retransmit", MakeBoundCallback (&LogRetransmit, stream));
+
   stream = asciiTraceHelper.CreateFileStream ("SubCount.dat");
   serverApps.Get (0)->TraceConnectWithoutContext ("Sub", MakeBoundCallback (&LogSub, stream));
 
@@ -327,28 +474,105 @@ main (int argc, char *argv[])
   //pointToPoint.EnableAsciiAll (ascii.CreateFileStream ("myfirst.tr"));
 
   // Schedule Network Disruption
-  Simulator::Schedule (Seconds (4.0), disconnect, enbLteDevs.Get (1));
+  Simulator::Schedule (Seconds (4.0), disconnect, enbLteDevs.Get (1), maxSubscribeRate > 0);
+
+  Ptr<WildfireCongestion> traffic;
+  if (congestion)
+    {
+      traffic = Create<WildfireCongestion> ();
+      for (uint32_t i = 0; i < ueNodes.GetN (); ++i)
+        {
+          traffic->Add (ueNodes.Get (i)->GetObject<WildfireMobilityModel> ());
+        }
+      traffic->Start ();
+    }
 
   // Simulator must be stopped when using energy
   Simulator::Stop (Seconds (20.0));
 
   Simulator::Run ();
 
+  double totalEnergyConsumed = 0;
   for (DeviceEnergyModelContainer::Iterator iter = deviceModels.Begin (); iter != deviceModels.End (); iter++)
     {
       double energyConsumed = (*iter)->GetTotalEnergyConsumption ();
+      totalEnergyConsumed += energyConsumed;
       NS_LOG_UNCOND ("End of simulation (" << Simulator::Now ().GetSeconds ()
                                            << "s) Total energy consumed by radio = " << energyConsumed << "J");
     }
 
+  NS_LOG_UNCOND ("Subscribed " << total_subscribed << " of " << nNodes << " clients in "
+                                 << total_subscribe_attempts << " attempts");
+  if (total_subscribed > 0)
+    {
+      NS_LOG_UNCOND ("Time to subscribe: mean " << total_subscribe_time.GetSeconds () / total_subscribed
+                                                << "s, max " << max_subscribe_time.GetSeconds () << "s");
+    }
+  NS_LOG_UNCOND ("Server time to last subscriber = " << max_fanout_time.GetSeconds () << "s");
+  if (total_hop_samples > 0)
+    {
+      NS_LOG_UNCOND ("Hops to delivery: mean " << static_cast<double> (total_hops) / total_hop_samples
+                                               << ", max " << max_hops_seen);
+    }
+  NS_LOG_UNCOND ("Server delivery ratio = " << last_delivery_ratio << " after "
+                                            << total_retransmissions << " retransmissions");
+  NS_LOG_UNCOND ("Broadcast mode " << broadcastMode << ": " << total_sent_messages << " transmissions, "
+                                   << notifications_received << " notifications delivered");
+  if (notifications_received > 0)
+    {
+      NS_LOG_UNCOND ("Transmissions per delivered notification = "
+                     << static_cast<double> (total_sent_messages) / notifications_received);
+      NS_LOG_UNCOND ("Peer bytes on air per delivered notification = "
+                     << static_cast<double> (total_peer_bytes) / notifications_received);
+    }
+  NS_LOG_UNCOND ("Average radio energy per node = " << totalEnergyConsumed / nNodes << "J");
+  if (traffic)
+    {
+      NS_LOG_UNCOND ("Congestion updates = " << traffic->GetUpdates () << ", mean cost "
+                                             << traffic->GetTotalUpdateCost () / std::max<uint64_t> (traffic->GetUpdates (), 1) << "s");
+    }
+  NS_LOG_UNCOND ("Deferred transmissions = " << total_deferred << ", Wi-Fi frames lost to collisions = " << total_collided);
+  if (totalEnergyConsumed > 0)
+    {
+      NS_LOG_UNCOND ("Notifications delivered per joule = " << notifications_received / totalEnergyConsumed);
+    }
+
+  // Per node energy per delivered notification, the source includes idle
+  // listening so this is what bounds the node lifetime
+  stream = asciiTraceHelper.CreateFileStream ("EnergyPerDelivery.dat");
+  for (uint32_t i = 0; i < clientApps.GetN (); ++i)
+    {
+      Ptr<WildfireClient> client = DynamicCast<WildfireClient> (clientApps.Get (i));
+      Ptr<EnergySource> source = sources.Get (i);
+      double consumed = source->GetInitialEnergy () - source->GetRemainingEnergy ();
+      *stream->GetStream () << client->GetNode ()->GetId () << "\t" << consumed << "\t"
+                            << client->GetDeliveredCount () << "\t";
+      if (client->GetDeliveredCount () > 0)
+        {
+          *stream->GetStream () << consumed / client->GetDeliveredCount ();
+        }
+      else
+        {
+          *stream->GetStream () << "-";
+        }
+      *stream->GetStream () << "\t" << source->GetEnergyFraction () << std::endl;
+    }
+
   Simulator::Destroy ();
   return 0;
 }
 
-void disconnect (Ptr<NetDevice> enbDevice)
+void disconnect (Ptr<NetDevice> enbDevice, bool admissionControl)
 {
-  // Assert that all Nodes have subscribed
-  NS_ASSERT (total_subs == nNodes);
+  // Subscriptions are spread over the second before the disruption, only
+  // admission control may still hold some back.  Those nodes verify the
+  // alerts relayed by their peers with the provisioned server key
+  NS_ASSERT_MSG (admissionControl || total_subs == nNodes,
+                 "Only " << total_subs << " of " << nNodes << " nodes subscribed before the disruption");
+  if (total_subs < nNodes)
+    {
+      NS_LOG_UNCOND ("Network disrupted with " << total_subs << " of " << nNodes << " nodes subscribed");
+    }
   auto enb = DynamicCast<LteEnbNetDevice, NetDevice> (enbDevice);
   auto phy = enb->GetPhy ();
   phy->SetTxPower (0);
@@ -417,3 +641,81 @@ LogSub (Ptr<OutputStreamWrapper> stream)
   *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << total_subs << std::endl;
 }
 
+static void
+LogDuplicate (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet)
+{
+  ++total_duplicates;
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << total_duplicates << std::endl;
+}
+
+static void
+LogDeferred (Ptr<OutputStreamWrapper> stream, Time delay)
+{
+  ++total_deferred;
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << total_deferred << "\t" << delay.GetSeconds () << std::endl;
+}
+
+static void
+LogCollided (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet, WifiPhyRxfailureReason reason)
+{
+  ++total_collided;
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << total_collided << "\t" << reason << std::endl;
+}
+
+static void
+LogSubscribeAttempt (Ptr<OutputStreamWrapper> stream, uint32_t attempt)
+{
+  ++total_subscribe_attempts;
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << total_subscribe_attempts << "\t" << attempt << std::endl;
+}
+
+static void
+LogSubscribed (Ptr<OutputStreamWrapper> stream, Time elapsed)
+{
+  ++total_subscribed;
+  total_subscribe_time += elapsed;
+  max_subscribe_time = Max (max_subscribe_time, elapsed);
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << total_subscribed << "\t" << elapsed.GetSeconds () << std::endl;
+}
+
+static void
+LogFanoutComplete (Ptr<OutputStreamWrapper> stream, Time elapsed)
+{
+  max_fanout_time = Max (max_fanout_time, elapsed);
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << elapsed.GetSeconds () << std::endl;
+}
+
+static void
+LogDeliveryRatio (Ptr<OutputStreamWrapper> stream, uint32_t id, double ratio)
+{
+  last_delivery_ratio = ratio;
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << id << "\t" << ratio << std::endl;
+}
+
+static void
+LogPeerBytes (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet, const Address &from, const Address &to)
+{
+  // Only peer traffic goes over Wi-Fi, subscriptions and server acks use LTE
+  if (InetSocketAddress::IsMatchingType (to) && InetSocketAddress::ConvertFrom (to).GetIpv4 () == server_address)
+    {
+      return;
+    }
+  total_peer_bytes += packet->GetSize ();
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << total_peer_bytes << std::endl;
+}
+
+static void
+LogRetransmit (Ptr<OutputStreamWrapper> stream, uint32_t id, uint32_t subscribers)
+{
+  total_retransmissions += subscribers;
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << id << "\t" << subscribers << std::endl;
+}
+
+static void
+LogHops (Ptr<OutputStreamWrapper> stream, uint32_t hops)
+{
+  total_hops += hops;
+  ++total_hop_samples;
+  max_hops_seen = std::max (max_hops_seen, hops);
+  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << hops << std::endl;
+}
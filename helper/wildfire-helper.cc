@@ -18,6 +18,7 @@
 #include "wildfire-helper.h"
 #include "ns3/uinteger.h"
 #include "ns3/names.h"
+#include "ns3/log.h"
 
 #include "ns3/wildfire-server.h"
 #include "ns3/wildfire-client.h"
@@ -25,6 +26,8 @@
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE ("WildfireHelper");
+
 WildfireServerHelper::WildfireServerHelper (uint16_t port)
 {
   m_factory.SetTypeId (WildfireServer::GetTypeId ());
@@ -80,6 +83,24 @@ WildfireServerHelper::ScheduleNotification (Ptr<Application> app, Time dt)
   app->GetObject<WildfireServer>()->ScheduleNotification (dt);
 }
 
+void
+WildfireServerHelper::ScheduleNotification (Ptr<Application> app, Time dt, WildfireServer::FanoutPriority priority)
+{
+  app->GetObject<WildfireServer>()->ScheduleNotification (dt, priority);
+}
+
+void
+WildfireServerHelper::ScheduleNotification (Ptr<Application> app, Time dt, const WildfireTargetArea &area)
+{
+  app->GetObject<WildfireServer>()->ScheduleNotification (dt, area);
+}
+
+void
+WildfireServerHelper::ScheduleTimeline (Ptr<Application> app, const std::vector<WildfireLevelChange> &timeline)
+{
+  app->GetObject<WildfireServer>()->ScheduleTimeline (timeline);
+}
+
 WildfireClientHelper::WildfireClientHelper (Address address, uint16_t remotePort, uint16_t port)
 {
   m_factory.SetTypeId (WildfireClient::GetTypeId ());
@@ -134,6 +155,11 @@ WildfireClientHelper::InstallPriv (Ptr<Node> node) const
   Ptr<Application> app = m_factory.Create<WildfireClient> ();
   Ptr<WildfireClient> wildfire_client = DynamicCast<WildfireClient> (app);
   wildfire_client->SetMobility (node->GetObject<WildfireMobilityModel> ());
+  wildfire_client->SetRoadGraph (m_roadGraph);
+  if (m_hasServerKey)
+    {
+      wildfire_client->SetServerKey (m_serverKey);
+    }
   node->AddApplication (app);
 
   return app;
@@ -145,4 +171,72 @@ WildfireClientHelper::ScheduleSubscription (Ptr<Application> app, Time dt, Ipv4A
   app->GetObject<WildfireClient>()->ScheduleSubscription (dt, dest);
 }
 
+void
+WildfireClientHelper::SetRoadGraph (Ptr<WildfireRoadGraph> graph)
+{
+  m_roadGraph = graph;
+}
+
+void
+WildfireClientHelper::SetServerKey (Ptr<Application> server)
+{
+  m_serverKey = server->GetObject<WildfireServer> ()->GetPublicKey ();
+  m_hasServerKey = true;
+}
+
+WildfireTraceMobilityHelper::WildfireTraceMobilityHelper (const std::string &filename)
+  : m_trace (Create<WildfireMobilityTrace> ())
+{
+  if (!m_trace->Open (filename))
+    {
+      NS_FATAL_ERROR ("Cannot open mobility trace " << filename);
+    }
+}
+
+void
+WildfireTraceMobilityHelper::Install (NodeContainer c) const
+{
+  if (c.GetN () > m_trace->GetNNodes ())
+    {
+      NS_LOG_WARN ("Mobility trace has " << m_trace->GetNNodes () << " nodes for " << c.GetN ()
+                                         << " nodes, the rest keep their mobility");
+    }
+  for (uint32_t i = 0; i < c.GetN () && i < m_trace->GetNNodes (); ++i)
+    {
+      Ptr<Node> node = c.Get (i);
+      Ptr<WildfireMobilityModel> mobility = node->GetObject<WildfireMobilityModel> ();
+      if (!mobility)
+        {
+          mobility = CreateObject<WildfireMobilityModel> ();
+          node->AggregateObject (mobility);
+        }
+      mobility->SetTrace (m_trace, i);
+    }
+}
+
+Ptr<WildfireMobilityTrace>
+WildfireTraceMobilityHelper::GetTrace (void) const
+{
+  return m_trace;
+}
+
+int64_t
+WildfireClientHelper::AssignStreams (NodeContainer c, int64_t stream)
+{
+  int64_t currentStream = stream;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      for (uint32_t j = 0; j < node->GetNApplications (); j++)
+        {
+          Ptr<WildfireClient> client = DynamicCast<WildfireClient> (node->GetApplication (j));
+          if (client)
+            {
+              currentStream += client->AssignStreams (currentStream);
+            }
+        }
+    }
+  return (currentStream - stream);
+}
+
 } // namespace ns3
\ No newline at end of file
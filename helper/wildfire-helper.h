@@ -23,6 +23,9 @@
 #include "ns3/node-container.h"
 #include "ns3/object-factory.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/wildfire-server.h"
+#include "ns3/wildfire-road-graph.h"
+#include "ns3/wildfire-mobility-trace.h"
 
 namespace ns3 {
 
@@ -35,6 +38,9 @@ class WildfireServerHelper
     ApplicationContainer Install (std::string nodeName) const;
     ApplicationContainer Install (NodeContainer c) const;
     void ScheduleNotification(Ptr<Application> app, Time dt);
+    void ScheduleNotification(Ptr<Application> app, Time dt, WildfireServer::FanoutPriority priority);
+    void ScheduleNotification(Ptr<Application> app, Time dt, const WildfireTargetArea &area);
+    void ScheduleTimeline(Ptr<Application> app, const std::vector<WildfireLevelChange> &timeline);
   
   private:
     Ptr<Application> InstallPriv (Ptr<Node> node) const;
@@ -53,9 +59,58 @@ public:
   ApplicationContainer Install (NodeContainer c) const;
   void ScheduleSubscription(Ptr<Application> app, Time dt, Ipv4Address dest);
 
+  /**
+   * \brief Road graph shared by the clients installed from now on, notifications
+   * without a route are followed along the roads to the nearest shelter
+   */
+  void SetRoadGraph (Ptr<WildfireRoadGraph> graph);
+
+  /**
+   * \brief Provision the clients installed from now on with the public key
+   * of server, they verify notifications relayed by peers without subscribing
+   */
+  void SetServerKey (Ptr<Application> server);
+
+  /**
+   * Assign fixed random variable stream numbers to the wildfire clients
+   * installed on the given nodes.
+   *
+   * \param c NodeContainer of the nodes holding the clients
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned
+   */
+  int64_t AssignStreams (NodeContainer c, int64_t stream);
+
 private:
   Ptr<Application> InstallPriv (Ptr<Node> node) const;
   ObjectFactory m_factory; //!< Object factory.
+  Ptr<WildfireRoadGraph> m_roadGraph; //!< Road graph of the installed clients
+  Ed25519PublicKey m_serverKey; //!< Server public key of the installed clients
+  bool m_hasServerKey = false; //!< Whether m_serverKey is provisioned
+};
+
+/**
+ * \brief Replay a binary mobility trace on nodes, streaming the fixes from
+ * the file as the simulation runs
+ */
+class WildfireTraceMobilityHelper
+{
+public:
+  /**
+   * \param filename trace written by WildfireMobilityTrace::ConvertCsv
+   */
+  WildfireTraceMobilityHelper (const std::string &filename);
+
+  /**
+   * Node i of the container replays node i of the trace, nodes without a
+   * WildfireMobilityModel get one.  The earliest fix of the trace plays at
+   * simulation time 0, shift it with GetTrace ()->SetTimeOffset first.
+   */
+  void Install (NodeContainer c) const;
+  Ptr<WildfireMobilityTrace> GetTrace (void) const;
+
+private:
+  Ptr<WildfireMobilityTrace> m_trace; //!< Trace shared by the installed nodes
 };
 
 }
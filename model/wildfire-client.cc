@@ -15,6 +15,9 @@
  *
  * Author: Brian O'Neill <broneill@pdx.edu>
  */
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include "ns3/log.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
@@ -27,6 +30,14 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/energy-source-container.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/enum.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
 #include "ns3/trace-source-accessor.h"
 #include "wildfire-client.h"
 
@@ -62,6 +73,159 @@ WildfireClient::GetTypeId (void)
                    TimeValue (Seconds (1.0)),
                    MakeTimeAccessor (&WildfireClient::m_broadcast_interval),
                    MakeTimeChecker ())
+    .AddAttribute ("FirstBroadcastJitter",
+                   "Random delay in seconds added to the first rebroadcast after a notification is received",
+                   StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=0.5]"),
+                   MakePointerAccessor (&WildfireClient::m_firstBroadcastJitter),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("BroadcastJitter",
+                   "Random delay in seconds added to every following rebroadcast",
+                   StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=0.1]"),
+                   MakePointerAccessor (&WildfireClient::m_broadcastJitter),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("AckJitter",
+                   "Random delay in seconds before a notification is acknowledged",
+                   StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=0.1]"),
+                   MakePointerAccessor (&WildfireClient::m_ackJitter),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("SubscribeStartJitter",
+                   "Random delay in seconds added to a scheduled subscription to spread clients started together",
+                   StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=1.0]"),
+                   MakePointerAccessor (&WildfireClient::m_subscribeStartJitter),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("SubscribeBackoffMin",
+                   "Backoff before the first subscription retry, doubled on every following retry",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&WildfireClient::m_subscribeBackoffMin),
+                   MakeTimeChecker ())
+    .AddAttribute ("SubscribeBackoffMax",
+                   "Maximum backoff between subscription retries",
+                   TimeValue (Seconds (32.0)),
+                   MakeTimeAccessor (&WildfireClient::m_subscribeBackoffMax),
+                   MakeTimeChecker ())
+    .AddAttribute ("BroadcastMode",
+                   "Rebroadcast scheduling. Fixed: every BroadcastInterval. "
+                   "Trickle: a Trickle timer set by TrickleImin, TrickleImax and TrickleK. "
+                   "Gossip: once, with a probability set by the Gossip* attributes. "
+                   "Beacon: a digest every BroadcastInterval, neighbours pull what they miss "
+                   "and retry after PullTimeout, needs the Binary WireFormat",
+                   EnumValue (WildfireClient::FIXED),
+                   MakeEnumAccessor (&WildfireClient::m_broadcastMode),
+                   MakeEnumChecker (WildfireClient::FIXED, "Fixed",
+                                    WildfireClient::TRICKLE, "Trickle",
+                                    WildfireClient::GOSSIP, "Gossip",
+                                    WildfireClient::BEACON, "Beacon"))
+    .AddAttribute ("GossipRange",
+                   "Gossip: sender distance in meters at which the distance factor of the rebroadcast probability reaches 1",
+                   DoubleValue (100),
+                   MakeDoubleAccessor (&WildfireClient::m_gossipRange),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("GossipMinProbability",
+                   "Gossip: lowest rebroadcast probability of a notification that is not suppressed",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&WildfireClient::m_gossipMinProbability),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("GossipCounterThreshold",
+                   "Gossip: copies heard during the assessment delay after which the rebroadcast is suppressed, 0 disables",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&WildfireClient::m_gossipCounterThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("GossipDensityThreshold",
+                   "Gossip: neighbour count above which the rebroadcast probability is scaled down proportionally",
+                   UintegerValue (6),
+                   MakeUintegerAccessor (&WildfireClient::m_gossipDensityThreshold),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("GossipNeighbourWindow",
+                   "Gossip: how long a peer counts as a neighbour after it was last heard",
+                   TimeValue (Seconds (5)),
+                   MakeTimeAccessor (&WildfireClient::m_gossipNeighbourWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("EvacuationDestination",
+                   "Destination of notifications that carry no evacuation route",
+                   VectorValue (Vector (17500, 17500, 0)),
+                   MakeVectorAccessor (&WildfireClient::m_evacuationDestination),
+                   MakeVectorChecker ())
+    .AddAttribute ("EvacuationSpeed",
+                   "Evacuation speed in m/s",
+                   DoubleValue (10),
+                   MakeDoubleAccessor (&WildfireClient::m_evacuationSpeed),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("PullTimeout",
+                   "Beacon: time before a notification pulled from a neighbour is requested again",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&WildfireClient::m_pullTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("EnergyAware",
+                   "Bind to the node energy source and scale rebroadcasts with the remaining energy",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&WildfireClient::m_energyAware),
+                   MakeBooleanChecker ())
+    .AddAttribute ("EnergyLowThreshold",
+                   "Remaining energy fraction below which the rebroadcast interval grows and the relay probability shrinks",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&WildfireClient::m_energyLowThreshold),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("EnergyCriticalThreshold",
+                   "Remaining energy fraction below which the client stops relaying and duty cycles the Wi-Fi PHY",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&WildfireClient::m_energyCriticalThreshold),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("EnergyIntervalStretch",
+                   "Factor applied to BroadcastInterval as the remaining energy falls to EnergyCriticalThreshold",
+                   DoubleValue (4),
+                   MakeDoubleAccessor (&WildfireClient::m_energyIntervalStretch),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("ListenWindow",
+                   "Time the Wi-Fi PHY stays awake per duty cycle once energy is critical",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&WildfireClient::m_listenWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("SleepInterval",
+                   "Time the Wi-Fi PHY sleeps per duty cycle once energy is critical",
+                   TimeValue (Seconds (9)),
+                   MakeTimeAccessor (&WildfireClient::m_sleepInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("TrickleImin",
+                   "Minimum Trickle interval",
+                   TimeValue (MilliSeconds (500)),
+                   MakeTimeAccessor (&WildfireClient::m_trickleImin),
+                   MakeTimeChecker ())
+    .AddAttribute ("TrickleImax",
+                   "Maximum Trickle interval",
+                   TimeValue (Seconds (16)),
+                   MakeTimeAccessor (&WildfireClient::m_trickleImax),
+                   MakeTimeChecker ())
+    .AddAttribute ("TrickleK",
+                   "Trickle redundancy constant, copies heard before a rebroadcast is suppressed",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&WildfireClient::m_trickleK),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("WireFormat",
+                   "Encoding used for wildfire messages, Text is the legacy '|' delimited format",
+                   EnumValue (static_cast<int> (WildfireWireFormat::binary)),
+                   MakeEnumAccessor (&WildfireClient::SetWireFormat, &WildfireClient::GetWireFormat),
+                   MakeEnumChecker (static_cast<int> (WildfireWireFormat::binary), "Binary",
+                                    static_cast<int> (WildfireWireFormat::text), "Text"))
+    .AddAttribute ("VerifyCacheSize",
+                   "Number of (id, hash) notification verification results to remember",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&WildfireClient::m_verifyCacheSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SeenFilterAging",
+                   "How long a notification is remembered by the duplicate filter",
+                   TimeValue (Seconds (30)),
+                   MakeTimeAccessor (&WildfireClient::m_seenFilterAging),
+                   MakeTimeChecker ())
+    .AddAttribute ("MessageStoreCapacity",
+                   "Maximum number of notifications kept for rebroadcast",
+                   UintegerValue (32),
+                   MakeUintegerAccessor (&WildfireClient::m_messageStoreCapacity),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxHops",
+                   "Notifications are only relayed to peers while their hop count stays within this limit",
+                   UintegerValue (255),
+                   MakeUintegerAccessor (&WildfireClient::m_maxHops),
+                   MakeUintegerChecker<uint8_t> ())
     .AddTraceSource ("Tx", "A new packet is created and is sent",
                      MakeTraceSourceAccessor (&WildfireClient::m_txTrace),
                      "")
@@ -80,6 +244,43 @@ WildfireClient::GetTypeId (void)
     .AddTraceSource ("RxPeerNotification", "A Peer Notification has been received",
                      MakeTraceSourceAccessor (&WildfireClient::m_rxPeerNotification),
                      "")
+    .AddTraceSource ("DuplicatesDropped", "A duplicate notification was dropped before decoding",
+                     MakeTraceSourceAccessor (&WildfireClient::m_duplicatesDropped),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("TxDeferred", "A rebroadcast or ack was deferred by a random jitter",
+                     MakeTraceSourceAccessor (&WildfireClient::m_txDeferred),
+                     "ns3::Time::TracedCallback")
+    .AddTraceSource ("TxCollided", "A Wi-Fi frame was lost on this node to an overlapping transmission, "
+                     "with the PHY drop reason",
+                     MakeTraceSourceAccessor (&WildfireClient::m_txCollided),
+                     "ns3::WifiPhyStateHelper::RxFailureReasonTracedCallback")
+    .AddTraceSource ("BroadcastSuppressed", "A Trickle rebroadcast was suppressed",
+                     MakeTraceSourceAccessor (&WildfireClient::m_txSuppressed),
+                     "")
+    .AddTraceSource ("HopsToDelivery", "A new notification was received, with the number of peer relays it took",
+                     MakeTraceSourceAccessor (&WildfireClient::m_hopsTrace),
+                     "")
+    .AddTraceSource ("GossipProbability", "A gossip rebroadcast decision was made, with its probability",
+                     MakeTraceSourceAccessor (&WildfireClient::m_gossipProbability),
+                     "")
+    .AddTraceSource ("PullRequest", "A pull request was sent to a neighbour, with the number of notifications requested",
+                     MakeTraceSourceAccessor (&WildfireClient::m_pullTrace),
+                     "")
+    .AddTraceSource ("EnergyPerDelivery", "A new notification was received, with the energy drawn so far per notification in joules",
+                     MakeTraceSourceAccessor (&WildfireClient::m_energyPerDelivery),
+                     "")
+    .AddTraceSource ("DutyCycle", "The Wi-Fi PHY went to sleep (true) or woke up (false) while energy is critical",
+                     MakeTraceSourceAccessor (&WildfireClient::m_dutyCycle),
+                     "")
+    .AddTraceSource ("StaleDropped", "A superseded zone alert version was dropped, with the zone and version",
+                     MakeTraceSourceAccessor (&WildfireClient::m_staleDropped),
+                     "")
+    .AddTraceSource ("SubscribeAttempt", "A subscription request was sent, with the attempt number",
+                     MakeTraceSourceAccessor (&WildfireClient::m_subscribeAttempt),
+                     "")
+    .AddTraceSource ("Subscribed", "The subscription was acknowledged, with the time since the first attempt",
+                     MakeTraceSourceAccessor (&WildfireClient::m_subscribedTrace),
+                     "ns3::Time::TracedCallback")
   ;
   return tid;
 }
@@ -88,20 +289,17 @@ WildfireClient::WildfireClient ()
 {
   NS_LOG_FUNCTION (this);
   m_socket = 0;
-  m_messages = new std::map<u_int32_t, WildfireMessage*>();
   m_id = rand () % UINT32_MAX;
+  m_trickleRng = CreateObject<UniformRandomVariable> ();
+  m_subscribeRng = CreateObject<UniformRandomVariable> ();
+  m_gossipRng = CreateObject<UniformRandomVariable> ();
+  m_energyRng = CreateObject<UniformRandomVariable> ();
 }
 
 WildfireClient::~WildfireClient ()
 {
   NS_LOG_FUNCTION (this);
   m_socket = 0;
-
-  for(std::map<uint32_t, WildfireMessage*>::iterator itr = m_messages->begin (); itr != m_messages->end (); itr++)
-    {
-      delete (itr->second);
-    }
-  delete m_messages;
 }
 
 void
@@ -125,10 +323,29 @@ WildfireClient::SetMobility (const Ptr<WildfireMobilityModel> mobility)
   m_mobility = mobility;
 }
 
+void
+WildfireClient::SetRoadGraph (Ptr<WildfireRoadGraph> graph)
+{
+  m_roadGraph = graph;
+}
+
+void
+WildfireClient::SetServerKey (const Ed25519PublicKey &key)
+{
+  m_serverKey = key;
+  m_hasServerKey = true;
+  m_serverKeyProvisioned = true;
+  m_verifyCache.Clear ();
+}
+
 void
 WildfireClient::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  UnbindEnergySource ();
+  BindCollisionTrace (false);
+  m_roadGraph = 0;
+  m_mobility = 0;
   Application::DoDispose ();
 }
 
@@ -137,6 +354,17 @@ WildfireClient::StartApplication (void)
 {
   NS_LOG_FUNCTION (this);
 
+  m_verifyCache.SetCapacity (m_verifyCacheSize);
+  m_messages.SetCapacity (m_messageStoreCapacity);
+  m_seenFilter.SetAging (m_seenFilterAging);
+  if (m_broadcastMode == BEACON && m_wireFormat == WildfireWireFormat::text)
+    {
+      NS_FATAL_ERROR ("Beacon mode needs the binary wire format");
+    }
+  m_trickle.SetParameters (m_trickleImin, m_trickleImax, m_trickleK);
+  m_trickle.SetRandomVariable (m_trickleRng);
+  m_trickle.SetCallbacks (MakeCallback (&WildfireClient::TrickleTransmit, this),
+                          MakeCallback (&WildfireClient::TrickleSuppressed, this));
   if (m_socket == 0)
     {
       TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
@@ -159,6 +387,8 @@ WildfireClient::StartApplication (void)
                                MakeCallback (&WildfireClient::HandleAccept, this) );*/
   m_socket->SetRecvCallback (MakeCallback (&WildfireClient::HandleRead, this));
   m_socket->SetAllowBroadcast (true);
+  BindEnergySource ();
+  BindCollisionTrace (true);
 }
 
 void
@@ -168,12 +398,22 @@ WildfireClient::StopApplication ()
 
   if (m_socket != 0)
     {
+      SendUnsubscribe ();
       m_socket->Close ();
       m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
       m_socket = 0;
     }
 
   Simulator::Cancel (m_broadcastEvent);
+  Simulator::Cancel (m_expiryEvent);
+  Simulator::Cancel (m_subscribeEvent);
+  Simulator::Cancel (m_renewEvent);
+  Simulator::Cancel (m_dutyCycleEvent);
+  m_trickle.Stop ();
+  m_gossip.clear ();
+  m_pulls.clear ();
+  UnbindEnergySource ();
+  BindCollisionTrace (false);
 }
 
 bool
@@ -210,108 +450,826 @@ WildfireClient::HandleRead (Ptr<Socket> socket)
       m_rxTrace (packet);
       m_rxTraceWithAddresses (packet, from, localAddress);
 
-      // Get data from packet
-      uint32_t size = packet->GetSize ();
-      uint8_t buffer[size];
-      packet->CopyData (buffer, size);
+      // Decode the fixed header straight from the packet, the payload is only
+      // copied when the message is new and kept in m_messages
+      WildfireHeader header;
+      WildfireMessage decoded;
+      bool isDecoded = m_wireFormat == WildfireWireFormat::text;
+      if (isDecoded)
+        {
+          decoded = WildfireMessage (packet, m_wireFormat);
+          header = decoded.getHeader ();
+        }
+      else if (WildfireHeader::IsComplete (packet))
+        {
+          packet->RemoveHeader (header);
+        }
+      else
+        {
+          NS_LOG_INFO ("Dropping truncated packet of " << packet->GetSize () << " bytes");
+          continue;
+        }
+      NS_LOG_INFO ("Received message: " << header);
 
-      // Store data as application message
-      std::vector<uint8_t> vbuffer (buffer, buffer + sizeof buffer / sizeof buffer[0]);
-      WildfireMessage* message = new WildfireMessage (&vbuffer);
-      m_messages->insert (std::pair<uint32_t, WildfireMessage*> (message->getId (), message));
+      Ipv4Address sender = InetSocketAddress::ConvertFrom (from).GetIpv4 ();
+      bool fromServer = sender == Ipv4Address::ConvertFrom (m_peerAddress);
+      if (!fromServer)
+        {
+          ObserveNeighbour (sender);
+        }
 
-      auto converted_message = message->toString ();
-      NS_LOG_INFO ("Received message: " << *converted_message);
-      delete converted_message;
+      // Digests and pulls are peer control traffic, they are not signed or stored
+      if (header.GetType () == WildfireMessageType::digest
+          || header.GetType () == WildfireMessageType::pull)
+        {
+          if (!isDecoded)
+            {
+              decoded = WildfireMessage (header, packet);
+            }
+          if (fromServer || m_broadcastMode != BEACON)
+            {
+              continue;
+            }
+          if (header.GetType () == WildfireMessageType::digest)
+            {
+              HandleDigest (decoded, from);
+            }
+          else
+            {
+              HandlePull (decoded, from);
+            }
+          continue;
+        }
+
+      // Most notifications heard during a flood are copies of one already
+      // accepted, drop them before any payload or signature work
+      if (header.GetType () == WildfireMessageType::notification
+          && m_seenFilter.Contains (header, Simulator::Now ()))
+        {
+          NS_LOG_LOGIC ("Dropping duplicate notification " << header.GetId ());
+          m_duplicatesDropped (packet);
+          if (fromServer)
+            {
+              // A server copy is a retransmission, our ack was lost or the
+              // notification came from a peer first, ack it again
+              ScheduleAck (socket, from, header.GetId ());
+            }
+          if (m_broadcastMode == TRICKLE)
+            {
+              m_trickle.Consistent ();
+            }
+          else if (m_broadcastMode == GOSSIP && !fromServer)
+            {
+              ObserveGossipCopy (header);
+            }
+          continue;
+        }
+
+      // Notifications must carry a valid signature, repeated copies of the
+      // same signed bytes are answered from the cache without checking the signature again
+      if (header.GetType () == WildfireMessageType::notification)
+        {
+          if (!isDecoded)
+            {
+              decoded = WildfireMessage (header, packet);
+              isDecoded = true;
+            }
+          uint8_t fields[WildfireMessage::MAX_SIGNED_FIELDS_SIZE];
+          uint32_t fieldsSize = decoded.getSignedFields (fields);
+          const uint8_t *payload = reinterpret_cast<const uint8_t*> (decoded.getMessage ().data ());
+          uint32_t payloadSize = decoded.getMessage ().size ();
+          bool valid = false;
+          if (!m_verifyCache.Lookup (decoded.getId (), decoded.getHash (), fields, fieldsSize,
+                                     payload, payloadSize, valid))
+            {
+              valid = m_hasServerKey && decoded.isValid (m_serverKey);
+              m_verifyCache.Insert (decoded.getId (), decoded.getHash (), fields, fieldsSize,
+                                    payload, payloadSize, valid);
+            }
+
+          if (!valid)
+            {
+              NS_LOG_INFO ("Dropping notification " << header.GetId () << " with invalid hash");
+              continue;
+            }
+          m_seenFilter.Add (header, Simulator::Now ());
+        }
 
-      if(message->getType () == WildfireMessageType::acknowledgement)
+      // Only notifications are kept, everything else is handled from the decoded copy.
+      // Zone alerts are looked up by zone, only a newer version than the stored one is new
+      const WildfireMessage *stored = header.GetZone () != 0
+        ? m_messages.FindZone (header.GetOrigin (), header.GetZone ())
+        : m_messages.Find (header.GetOrigin (), header.GetId ());
+      if (stored != nullptr && header.GetZone () != 0 && header.GetVersion () != stored->getVersion ())
         {
-          // TODO: Need to ensure this is ack from subscription request
-          m_subscribed = true;
-          if(from == m_peerAddress)
+          if (header.GetVersion () < stored->getVersion ())
             {
-              if(m_key != nullptr)
+              // A neighbour is still flooding a superseded level, in Trickle
+              // mode that is an inconsistency answered by sending ours soon
+              NS_LOG_LOGIC ("Dropping superseded version " << header.GetVersion () << " of zone " << header.GetZone ());
+              m_staleDropped (header.GetZone (), header.GetVersion ());
+              if (m_broadcastMode == TRICKLE)
                 {
-                  delete m_key;
+                  m_trickle.Inconsistent ();
                 }
+              continue;
+            }
+          stored = nullptr;
+        }
+      bool isNew = false;
+      if (stored == nullptr)
+        {
+          if (!isDecoded)
+            {
+              decoded = WildfireMessage (header, packet);
+            }
+          if (WildfireMessageStore::IsStorable (decoded.getType ()) && !decoded.isExpired ())
+            {
+              // Record the hops taken, then store the message in the form our
+              // rebroadcasts send so the cached packet is reused as is
+              m_hopsTrace (decoded.getHops ());
+              decoded.relay ();
+              decoded.setPosition (GetPosition ());
+              if (m_messageStoreCapacity == 0)
+                {
+                  // Nothing is kept for rebroadcast, the message is still
+                  // delivered from the decoded copy
+                  isNew = true;
+                }
+              else
+                {
+                  stored = m_messages.Insert (std::move (decoded));
+                  if (stored == nullptr)
+                    {
+                      // decoded was moved into the store, nothing is left to handle
+                      NS_LOG_LOGIC ("Message store rejected notification " << header.GetId ());
+                      continue;
+                    }
+                  isNew = true;
+                  ScheduleExpiry ();
+                }
+            }
+        }
+      const WildfireMessage &message = stored != nullptr ? *stored : decoded;
 
-              m_key = message->getMessage ();
+      if(message.getType () == WildfireMessageType::acknowledgement && fromServer)
+        {
+          if (!m_subscribed)
+            {
+              m_subscribed = true;
+              Simulator::Cancel (m_subscribeEvent);
+              m_subscribedTrace (Simulator::Now () - m_subscribeStart);
+            }
+          // The ack expires with the server lease, renew half way through it
+          Simulator::Cancel (m_renewEvent);
+          m_leaseExpiry = message.getExpiresAt ();
+          Time lease = m_leaseExpiry - Simulator::Now ();
+          if (lease.IsStrictlyPositive ())
+            {
+              m_renewEvent = Simulator::Schedule (Seconds (lease.GetSeconds () / 2),
+                                                  &WildfireClient::RenewSubscription, this);
+            }
+          // Without a provisioned key the server address vouches for the key in the ack
+          const std::string &key = message.getMessage ();
+          if (!m_serverKeyProvisioned && key.size () == m_serverKey.size ()
+              && (!m_hasServerKey || std::memcmp (key.data (), m_serverKey.data (), key.size ()) != 0))
+            {
+              std::copy (key.begin (), key.end (), m_serverKey.begin ());
+              m_hasServerKey = true;
+              m_verifyCache.Clear ();
             }
           NS_LOG_INFO ("Ack received on client");
         }
 
-      if(!m_received && message->getType () == WildfireMessageType::notification
-         && message->isValid (m_key) && !message->isExpired ())
+      // The server refuses subscriptions it cannot admit, expires_at of the
+      // error carries the earliest time to try again
+      if (message.getType () == WildfireMessageType::error && fromServer && !m_subscribed)
         {
-          // TODO: Update to get destination from message
-          if (m_mobility)
+          NS_LOG_INFO ("Subscription refused, retry after " << message.getExpiresAt ().As (Time::S));
+          Simulator::Cancel (m_subscribeEvent);
+          ScheduleSubscriptionRetry (message.getExpiresAt ());
+        }
+
+      // Every new notification or zone version is reported, acked and rebroadcast
+      if(isNew)
+        {
+          // A route in the notification replaces the current one, without a
+          // route the node evacuates once, by road to the nearest shelter when
+          // there is a road graph and to EvacuationDestination otherwise
+          if (m_mobility && !message.getRoute ().empty ())
             {
-              m_mobility->SetDestinationVelocity (Vector (17500, 17500, 0), 10);
+              m_mobility->SetRoute (message.getRoute (), m_evacuationSpeed);
+            }
+          else if (m_mobility && !m_received)
+            {
+              std::shared_ptr<const std::vector<Vector> > road;
+              if (m_roadGraph)
+                {
+                  road = m_roadGraph->GetEvacuationRoute (m_mobility->GetPosition ());
+                }
+              if (road && !road->empty ())
+                {
+                  m_mobility->SetRoute (*road, m_evacuationSpeed);
+                }
+              else
+                {
+                  m_mobility->SetDestinationVelocity (m_evacuationDestination, m_evacuationSpeed);
+                }
             }
           m_rxNotification ();
-          auto sender = InetSocketAddress::ConvertFrom (from).GetIpv4 ();
-          if ( sender != m_peerAddress )
+          if (!fromServer)
             {
               m_rxPeerNotification ();
             }
           m_received = true;
-          NS_LOG_INFO ("Send Ack to " << InetSocketAddress::ConvertFrom (from).GetIpv4 ());
-          SendAck (socket, &from, message->getId ());
+          ++m_delivered;
+          m_energyPerDelivery (GetEnergyConsumed () / m_delivered);
+          ScheduleAck (socket, from, message.getId ());
 
           // Schedule broadcast instead of instant broadcast so the simulation has time to receive
-          // messages on nearby devices
-          m_broadcastEvent =  Simulator::Schedule (m_broadcast_interval, &WildfireClient::Broadcast, this);
+          // messages on nearby devices.  A running broadcast loop is restarted so a
+          // new version goes out as quickly as the first notification did
+          if (m_broadcastMode == FIXED || m_broadcastMode == BEACON)
+            {
+              m_pulls.erase ((static_cast<uint64_t> (header.GetOrigin ()) << 32) | header.GetId ());
+              Simulator::Cancel (m_broadcastEvent);
+              ScheduleBroadcast (m_firstBroadcastJitter);
+            }
+          else if (m_broadcastMode == GOSSIP)
+            {
+              ScheduleGossip (header, fromServer);
+            }
+        }
+
+      // A retransmission of a stored notification the seen filter already forgot
+      else if (fromServer && message.getType () == WildfireMessageType::notification)
+        {
+          ScheduleAck (socket, from, message.getId ());
+        }
+
+      // New data is a Trickle inconsistency, rebroadcast quickly again
+      if (isNew && m_broadcastMode == TRICKLE)
+        {
+          m_trickle.Inconsistent ();
+        }
+    }
+}
+
+uint32_t
+WildfireClient::SendStoredNotifications ()
+{
+  NS_LOG_DEBUG ("At time " << Simulator::Now ().As (Time::S) << " Rebroadcast Over Wifi");
+  m_messages.EvictExpired (Simulator::Now ());
+  Address dest = InetSocketAddress (Ipv4Address ("255.255.255.255"), m_port);
+  uint32_t sent = 0;
+  for(auto itr = m_messages.Begin (); itr != m_messages.End (); itr++)
+    {
+      // Stored messages are already in relay form, an exhausted TTL or a hop
+      // count above MaxHops ends the relay chain here
+      if (!CanRelay (*itr))
+        {
+          continue;
         }
+      SendMsg (m_socket, dest, *itr);
+      ++sent;
     }
+  return sent;
+}
+
+bool
+WildfireClient::CanRelay (const WildfireMessage &message) const
+{
+  // Like an IP TTL, a relay that decrements it to zero drops the message
+  return message.getTtl () > 0 && message.getHops () <= m_maxHops
+         && !m_dutyCycleEvent.IsRunning ();
 }
 
 void
 WildfireClient::Broadcast ()
 {
-  Ptr<Packet> packet;
-  bool found = false;
-  NS_LOG_DEBUG ("At time " << Simulator::Now ().As (Time::S) << " Rebroadcast Over Wifi");
-  for(auto itr = m_messages->begin (); itr != m_messages->end (); itr++)
+  uint32_t sent = m_broadcastMode == BEACON ? SendDigest () : SendStoredNotifications ();
+  if (sent > 0)
+    {
+      ScheduleBroadcast (m_broadcastJitter);
+    }
+}
+
+uint32_t
+WildfireClient::SendDigest ()
+{
+  m_messages.EvictExpired (Simulator::Now ());
+  WildfireDigest digest;
+  for (auto itr = m_messages.Begin (); itr != m_messages.End (); itr++)
+    {
+      if (CanRelay (*itr))
+        {
+          digest.Add (*itr);
+        }
+    }
+  if (digest.IsEmpty ())
+    {
+      return 0;
+    }
+  NS_LOG_DEBUG ("At time " << Simulator::Now ().As (Time::S) << " Digest beacon of " << digest.GetN () << " notifications");
+  WildfireMessage beacon (m_id++, WildfireMessageType::digest, Simulator::Now () + m_broadcast_interval, digest.Serialize ());
+  beacon.setOrigin (GetNode ()->GetId ());
+  SendMsg (m_socket, InetSocketAddress (Ipv4Address ("255.255.255.255"), m_port), beacon);
+  return digest.GetN ();
+}
+
+void
+WildfireClient::HandleDigest (const WildfireMessage &message, const Address &from)
+{
+  WildfireDigest digest;
+  if (!digest.Deserialize (message.getMessage ()))
+    {
+      NS_LOG_INFO ("Dropping malformed digest from " << InetSocketAddress::ConvertFrom (from).GetIpv4 ());
+      return;
+    }
+
+  // Forget timed out pulls, notifications no neighbour advertises again
+  // would otherwise stay in the map
+  Time now = Simulator::Now ();
+  for (auto pending = m_pulls.begin (); pending != m_pulls.end (); )
+    {
+      if (now - pending->second >= m_pullTimeout)
+        {
+          pending = m_pulls.erase (pending);
+        }
+      else
+        {
+          ++pending;
+        }
+    }
+
+  WildfireDigest missing;
+  for (uint32_t i = 0; i < digest.GetN (); ++i)
+    {
+      const WildfireDigest::Entry &entry = digest.Get (i);
+      const WildfireMessage *stored = entry.zone != 0
+        ? m_messages.FindZone (entry.origin, entry.zone)
+        : m_messages.Find (entry.origin, entry.id);
+      if (stored != nullptr && (entry.zone == 0 || stored->getVersion () >= entry.version))
+        {
+          continue;
+        }
+      // Several neighbours advertise the same notification, pull it from
+      // the first one and only ask again once the pull timed out
+      uint64_t key = (static_cast<uint64_t> (entry.origin) << 32) | entry.id;
+      if (!m_pulls.emplace (key, now).second)
+        {
+          continue;
+        }
+      missing.Add (entry);
+    }
+
+  if (missing.IsEmpty ())
+    {
+      return;
+    }
+  NS_LOG_DEBUG ("At time " << now.As (Time::S) << " Pulling " << missing.GetN () << " notifications from "
+                           << InetSocketAddress::ConvertFrom (from).GetIpv4 ());
+  WildfireMessage request (m_id++, WildfireMessageType::pull, now + m_pullTimeout, missing.Serialize ());
+  request.setOrigin (GetNode ()->GetId ());
+  m_pullTrace (missing.GetN ());
+  SendMsg (m_socket, InetSocketAddress (InetSocketAddress::ConvertFrom (from).GetIpv4 (), m_port), request);
+}
+
+void
+WildfireClient::HandlePull (const WildfireMessage &message, const Address &from)
+{
+  WildfireDigest digest;
+  if (!digest.Deserialize (message.getMessage ()))
+    {
+      NS_LOG_INFO ("Dropping malformed pull from " << InetSocketAddress::ConvertFrom (from).GetIpv4 ());
+      return;
+    }
+  Address dest = InetSocketAddress (InetSocketAddress::ConvertFrom (from).GetIpv4 (), m_port);
+  for (uint32_t i = 0; i < digest.GetN (); ++i)
+    {
+      const WildfireDigest::Entry &entry = digest.Get (i);
+      const WildfireMessage *stored = entry.zone != 0
+        ? m_messages.FindZone (entry.origin, entry.zone)
+        : m_messages.Find (entry.origin, entry.id);
+      // A newer zone version than the one pulled is sent instead
+      if (stored != nullptr && !stored->isExpired () && CanRelay (*stored))
+        {
+          SendMsg (m_socket, dest, *stored);
+        }
+    }
+}
+
+void
+WildfireClient::ScheduleBroadcast (Ptr<RandomVariableStream> jitter)
+{
+  // Nodes informed in the same LTE scheduling window would otherwise
+  // rebroadcast at the same instant
+  Time delay = Seconds (jitter->GetValue ());
+  m_txDeferred (delay);
+  // Low energy stretches the interval up to EnergyIntervalStretch times
+  double stretch = 1 + (m_energyIntervalStretch - 1) * (1 - GetEnergyScale ());
+  m_broadcastEvent = Simulator::Schedule (Seconds (m_broadcast_interval.GetSeconds () * stretch) + delay,
+                                          &WildfireClient::Broadcast, this);
+}
+
+int64_t
+WildfireClient::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_firstBroadcastJitter->SetStream (stream);
+  m_broadcastJitter->SetStream (stream + 1);
+  m_ackJitter->SetStream (stream + 2);
+  m_trickleRng->SetStream (stream + 3);
+  m_subscribeStartJitter->SetStream (stream + 4);
+  m_subscribeRng->SetStream (stream + 5);
+  m_gossipRng->SetStream (stream + 6);
+  m_energyRng->SetStream (stream + 7);
+  return 8;
+}
+
+Vector
+WildfireClient::GetPosition () const
+{
+  Ptr<MobilityModel> mobility = m_mobility;
+  if (!mobility)
+    {
+      mobility = GetNode ()->GetObject<MobilityModel> ();
+    }
+  return mobility ? mobility->GetPosition () : Vector ();
+}
+
+Vector
+WildfireClient::GroundPosition () const
+{
+  // Headers carry (x, y) only
+  Vector position = GetPosition ();
+  return Vector (position.x, position.y, 0);
+}
+
+void
+WildfireClient::ObserveNeighbour (Ipv4Address sender)
+{
+  m_neighbours[sender.Get ()] = Simulator::Now ();
+}
+
+uint32_t
+WildfireClient::CountNeighbours ()
+{
+  Time horizon = Simulator::Now () - m_gossipNeighbourWindow;
+  for (auto itr = m_neighbours.begin (); itr != m_neighbours.end (); )
     {
-      if (itr->second->getType () == WildfireMessageType::notification
-          && !itr->second->isExpired ())
+      if (itr->second < horizon)
+        {
+          itr = m_neighbours.erase (itr);
+        }
+      else
         {
-          Address dest = InetSocketAddress (Ipv4Address ("255.255.255.255"), m_port);
-          SendMsg (m_socket, &dest, itr->second);
+          ++itr;
         }
-      found = true;
     }
+  return m_neighbours.size ();
+}
 
-  if (found)
+void
+WildfireClient::ScheduleGossip (const WildfireHeader &header, bool fromServer)
+{
+  uint64_t key = (static_cast<uint64_t> (header.GetOrigin ()) << 32) | header.GetId ();
+  GossipState state;
+  state.origin = header.GetOrigin ();
+  state.id = header.GetId ();
+  state.zone = header.GetZone ();
+  state.copies = 1;
+  // The server is not a radio neighbour, a copy from it says nothing about
+  // how well the local area is already covered
+  state.minDistance = fromServer ? std::numeric_limits<double>::max ()
+    : CalculateDistance (header.GetPosition (), GroundPosition ());
+  m_gossip[key] = state;
+
+  // Random assessment delay, copies heard meanwhile feed the decision
+  Time delay = Seconds (m_firstBroadcastJitter->GetValue ());
+  m_txDeferred (delay);
+  Simulator::Schedule (delay, &WildfireClient::GossipDecide, this, key);
+}
+
+void
+WildfireClient::ObserveGossipCopy (const WildfireHeader &header)
+{
+  auto itr = m_gossip.find ((static_cast<uint64_t> (header.GetOrigin ()) << 32) | header.GetId ());
+  if (itr == m_gossip.end ())
     {
-      m_broadcastEvent =  Simulator::Schedule (m_broadcast_interval, &WildfireClient::Broadcast, this);
+      return;
     }
+  ++itr->second.copies;
+  double distance = CalculateDistance (header.GetPosition (), GroundPosition ());
+  itr->second.minDistance = std::min (itr->second.minDistance, distance);
+}
 
+void
+WildfireClient::GossipDecide (uint64_t key)
+{
+  auto itr = m_gossip.find (key);
+  if (itr == m_gossip.end ())
+    {
+      return;
+    }
+  GossipState state = itr->second;
+  m_gossip.erase (itr);
+
+  // A newer zone version or expiry may have replaced the message meanwhile
+  const WildfireMessage *message = state.zone != 0
+    ? m_messages.FindZone (state.origin, state.zone)
+    : m_messages.Find (state.origin, state.id);
+  if (message == nullptr || message->getId () != state.id || !CanRelay (*message))
+    {
+      return;
+    }
+
+  // Distance based: a close sender already covered most of our range.
+  // Counter based: enough copies were heard.  Density: in a crowd fewer
+  // rebroadcasts cover the same area.
+  double probability = 0;
+  if (m_gossipCounterThreshold == 0 || state.copies < m_gossipCounterThreshold)
+    {
+      double distance = m_gossipRange > 0 ? std::min (1.0, state.minDistance / m_gossipRange) : 1.0;
+      double density = std::min (1.0, static_cast<double> (m_gossipDensityThreshold) / std::max<uint32_t> (1, CountNeighbours ()));
+      probability = std::max (m_gossipMinProbability, distance * density) * GetEnergyScale ();
+    }
+  m_gossipProbability (probability);
+
+  if (m_gossipRng->GetValue () >= probability)
+    {
+      NS_LOG_DEBUG ("At time " << Simulator::Now ().As (Time::S) << " Gossip rebroadcast suppressed, p=" << probability);
+      m_txSuppressed ();
+      return;
+    }
+
+  NS_LOG_DEBUG ("At time " << Simulator::Now ().As (Time::S) << " Gossip rebroadcast, p=" << probability);
+  // Send with the current position, receivers use it for their own decision
+  WildfireMessage relay = *message;
+  relay.setPosition (GetPosition ());
+  SendMsg (m_socket, InetSocketAddress (Ipv4Address ("255.255.255.255"), m_port), relay);
+}
+
+void
+WildfireClient::TrickleTransmit ()
+{
+  // Low energy skips a share of the transmissions, the interval still doubles
+  if (m_energyRng->GetValue () >= GetEnergyScale ())
+    {
+      TrickleSuppressed ();
+      return;
+    }
+  if (SendStoredNotifications () == 0)
+    {
+      m_trickle.Stop ();
+    }
 }
 
 void
-WildfireClient::SendAck (Ptr<Socket> socket, Address* dest, uint32_t id )
+WildfireClient::TrickleSuppressed ()
+{
+  NS_LOG_DEBUG ("At time " << Simulator::Now ().As (Time::S) << " Rebroadcast suppressed");
+  m_txSuppressed ();
+}
+
+void
+WildfireClient::BindEnergySource ()
+{
+  if (!m_energyAware)
+    {
+      return;
+    }
+  Ptr<EnergySourceContainer> sources = GetNode ()->GetObject<EnergySourceContainer> ();
+  if (!sources || sources->GetN () == 0)
+    {
+      NS_LOG_WARN ("Node " << GetNode ()->GetId () << " has no energy source, energy awareness disabled");
+      return;
+    }
+  m_energySource = sources->Get (0);
+  m_energySource->TraceConnectWithoutContext ("RemainingEnergy",
+                                              MakeCallback (&WildfireClient::RemainingEnergyChanged, this));
+  for (uint32_t i = 0; i < GetNode ()->GetNDevices (); ++i)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (GetNode ()->GetDevice (i));
+      if (device)
+        {
+          m_wifiPhy = device->GetPhy ();
+          break;
+        }
+    }
+}
+
+void
+WildfireClient::UnbindEnergySource ()
+{
+  if (m_energySource)
+    {
+      m_energySource->TraceDisconnectWithoutContext ("RemainingEnergy",
+                                                     MakeCallback (&WildfireClient::RemainingEnergyChanged, this));
+    }
+  m_energySource = 0;
+  m_wifiPhy = 0;
+}
+
+void
+WildfireClient::BindCollisionTrace (bool bind)
+{
+  // Disconnect from the PHYs we connected to, the node devices may already
+  // be disposed by then
+  for (Ptr<WifiPhy> phy : m_collisionPhys)
+    {
+      phy->TraceDisconnectWithoutContext ("PhyRxDrop", MakeCallback (&WildfireClient::PhyRxDrop, this));
+    }
+  m_collisionPhys.clear ();
+  if (!bind)
+    {
+      return;
+    }
+  for (uint32_t i = 0; i < GetNode ()->GetNDevices (); ++i)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (GetNode ()->GetDevice (i));
+      if (device)
+        {
+          device->GetPhy ()->TraceConnectWithoutContext ("PhyRxDrop", MakeCallback (&WildfireClient::PhyRxDrop, this));
+          m_collisionPhys.push_back (device->GetPhy ());
+        }
+    }
+}
+
+void
+WildfireClient::PhyRxDrop (Ptr<const Packet> packet, WifiPhyRxfailureReason reason)
+{
+  // Frames arriving while another is received, or aborted by our own
+  // transmission, are lost to an overlap, the other reasons are not collisions
+  switch (reason)
+    {
+    case RXING:
+    case BUSY_DECODING_PREAMBLE:
+    case RECEPTION_ABORTED_BY_TX:
+    case PREAMBLE_DETECTION_PACKET_SWITCH:
+    case FRAME_CAPTURE_PACKET_SWITCH:
+      m_txCollided (packet, reason);
+      break;
+    default:
+      break;
+    }
+}
+
+double
+WildfireClient::GetEnergyScale ()
+{
+  if (!m_energySource)
+    {
+      return 1;
+    }
+  double fraction = m_energySource->GetEnergyFraction ();
+  if (fraction >= m_energyLowThreshold)
+    {
+      return 1;
+    }
+  if (fraction <= m_energyCriticalThreshold)
+    {
+      return 0;
+    }
+  return (fraction - m_energyCriticalThreshold) / (m_energyLowThreshold - m_energyCriticalThreshold);
+}
+
+bool
+WildfireClient::IsEnergyCritical ()
+{
+  return m_energySource && m_energySource->GetEnergyFraction () <= m_energyCriticalThreshold;
+}
+
+void
+WildfireClient::RemainingEnergyChanged (double oldValue, double remainingEnergy)
+{
+  if (m_dutyCycleEvent.IsRunning () || !IsEnergyCritical ())
+    {
+      return;
+    }
+  NS_LOG_INFO ("At time " << Simulator::Now ().As (Time::S) << " Node " << GetNode ()->GetId ()
+                          << " energy critical, relaying stopped");
+  // Stored notifications are no longer relayed, the receive path stays up
+  // in the listen windows
+  Simulator::Cancel (m_broadcastEvent);
+  m_trickle.Stop ();
+  m_gossip.clear ();
+  m_dutyCycleEvent = Simulator::ScheduleNow (&WildfireClient::DutyCycle, this);
+}
+
+void
+WildfireClient::DutyCycle ()
+{
+  if (!m_wifiPhy)
+    {
+      // Nothing to put to sleep, keep the event running so relaying stays off
+      m_dutyCycleEvent = Simulator::Schedule (m_listenWindow + m_sleepInterval, &WildfireClient::DutyCycle, this);
+      return;
+    }
+  if (m_wifiPhy->IsStateSleep ())
+    {
+      m_wifiPhy->ResumeFromSleep ();
+      m_dutyCycle (false);
+      m_dutyCycleEvent = Simulator::Schedule (m_listenWindow, &WildfireClient::DutyCycle, this);
+    }
+  else
+    {
+      m_wifiPhy->SetSleepMode ();
+      m_dutyCycle (true);
+      m_dutyCycleEvent = Simulator::Schedule (m_sleepInterval, &WildfireClient::DutyCycle, this);
+    }
+}
+
+double
+WildfireClient::GetEnergyConsumed (void) const
+{
+  if (!m_energySource)
+    {
+      return 0;
+    }
+  return m_energySource->GetInitialEnergy () - m_energySource->GetRemainingEnergy ();
+}
+
+uint32_t
+WildfireClient::GetDeliveredCount (void) const
+{
+  return m_delivered;
+}
+
+void
+WildfireClient::ScheduleExpiry ()
+{
+  Time next = m_messages.GetNextExpiry ();
+  if (next == Time::Max ())
+    {
+      return;
+    }
+  Simulator::Cancel (m_expiryEvent);
+  // Expired means strictly before now, so evict one step after the expiry time
+  m_expiryEvent = Simulator::Schedule (Max (next - Simulator::Now (), Time (0)) + TimeStep (1),
+                                       &WildfireClient::EvictExpired, this);
+}
+
+void
+WildfireClient::EvictExpired ()
+{
+  m_messages.EvictExpired (Simulator::Now ());
+  ScheduleExpiry ();
+}
+
+void
+WildfireClient::ScheduleAck (Ptr<Socket> socket, const Address &dest, uint32_t id)
+{
+  // Acks from every node that heard the same notification would collide
+  Time ackDelay = Seconds (m_ackJitter->GetValue ());
+  NS_LOG_INFO ("Send Ack to " << InetSocketAddress::ConvertFrom (dest).GetIpv4 () << " in " << ackDelay.As (Time::S));
+  m_txDeferred (ackDelay);
+  Simulator::Schedule (ackDelay, &WildfireClient::SendAck, this, socket, dest, id);
+}
+
+void
+WildfireClient::SendAck (Ptr<Socket> socket, const Address &dest, uint32_t id )
 {
-  std::string payload = std::string ("");
   Time expires_at = Time (Simulator::Now () + Hours (1));
-  WildfireMessage message = WildfireMessage (id, WildfireMessageType::acknowledgement, &expires_at, &payload);
-  SendMsg (socket, dest, &message);
+  WildfireMessage message = WildfireMessage (id, WildfireMessageType::acknowledgement, expires_at, std::string ());
+  message.setOrigin (GetNode ()->GetId ());
+  SendMsg (socket, dest, message);
 }
 
 void
-WildfireClient::SendMsg (Ptr<Socket> socket, Address* dest, WildfireMessage* message)
+WildfireClient::SendMsg (Ptr<Socket> socket, const Address &dest, const WildfireMessage &message)
 {
-  auto serialized_message = message->serialize ();
-  Ptr<Packet> p = Create<Packet> (serialized_message->data (), serialized_message->size ());
+  Ptr<Packet> p = message.toPacket (m_wireFormat);
+  Address localAddress;
+  socket->GetSockName (localAddress);
   m_txTrace ();
-  socket->SendTo (p, 0, *dest);
+  m_txTraceWithAddresses (p, localAddress, dest);
+  socket->SendTo (p, 0, dest);
 }
 
 void
 WildfireClient::ScheduleSubscription (Time dt, Ipv4Address dest)
 {
   NS_LOG_FUNCTION (this << dt);
-  Simulator::Schedule (dt, &WildfireClient::SendSubscription, this, dest);
+  Time jitter = Seconds (m_subscribeStartJitter->GetValue ());
+  m_subscribeEvent = Simulator::Schedule (dt + jitter, &WildfireClient::SendSubscription, this, dest);
+}
+
+void
+WildfireClient::ScheduleSubscriptionRetry (Time retryAfter)
+{
+  // Exponential backoff, half fixed and half random so retries of clients
+  // that failed together do not line up again
+  double backoff = m_subscribeBackoffMin.GetSeconds ();
+  for (uint32_t i = 1; i < m_subscribeAttempts && backoff < m_subscribeBackoffMax.GetSeconds (); ++i)
+    {
+      backoff *= 2;
+    }
+  backoff = std::min (backoff, m_subscribeBackoffMax.GetSeconds ());
+  Time delay = Seconds (backoff / 2 + m_subscribeRng->GetValue (0, backoff / 2));
+  delay = Max (delay, retryAfter - Simulator::Now () + Seconds (m_subscribeRng->GetValue (0, m_subscribeBackoffMin.GetSeconds ())));
+  NS_LOG_LOGIC ("Subscription attempt " << m_subscribeAttempts + 1 << " in " << delay.As (Time::S));
+  m_subscribeEvent = Simulator::Schedule (delay, &WildfireClient::RetrySubscribe, this, m_socket);
 }
 
 void
@@ -325,6 +1283,42 @@ WildfireClient::RetrySubscribe (Ptr<Socket> socket)
   SendSubscription ( Ipv4Address::ConvertFrom (m_peerAddress) );
 }
 
+void
+WildfireClient::RenewSubscription ()
+{
+  NS_LOG_FUNCTION (this);
+  Time remaining = m_leaseExpiry - Simulator::Now ();
+  if (!remaining.IsStrictlyPositive ())
+    {
+      NS_LOG_INFO ("Subscription lease ran out on " << GetNode ()->GetId ());
+      m_subscribed = false;
+      m_subscribeAttempts = 0;
+      SendSubscription (Ipv4Address::ConvertFrom (m_peerAddress));
+      return;
+    }
+
+  SendSubscribeRequest (Ipv4Address::ConvertFrom (m_peerAddress));
+  // The ack cancels this retry and schedules the next renewal
+  Time retry = Min (remaining, Max (m_subscribeBackoffMin, Seconds (remaining.GetSeconds () / 2)));
+  m_renewEvent = Simulator::Schedule (retry, &WildfireClient::RenewSubscription, this);
+}
+
+void
+WildfireClient::SendUnsubscribe ()
+{
+  if (!m_subscribed)
+    {
+      return;
+    }
+
+  Time expires_at = Time (Simulator::Now () + Hours (1));
+  WildfireMessage message = WildfireMessage (m_id++, WildfireMessageType::unsubscribe, expires_at, std::string ());
+  message.setOrigin (GetNode ()->GetId ());
+  SendMsg (m_socket, InetSocketAddress (Ipv4Address::ConvertFrom (m_peerAddress), m_peerPort), message);
+  m_subscribed = false;
+  NS_LOG_INFO ("Wildfire Unsubscribe Sent from " << GetNode ()->GetId ());
+}
+
 void
 WildfireClient::SendSubscription (Ipv4Address dest)
 {
@@ -333,24 +1327,51 @@ WildfireClient::SendSubscription (Ipv4Address dest)
       return;
     }
 
-  NS_ASSERT (m_socket->Connect (InetSocketAddress (Ipv4Address::ConvertFrom (m_peerAddress), m_peerPort)) != -1);
-  // TODO: move send details to seperate function
+  if (m_subscribeAttempts == 0)
+    {
+      m_subscribeStart = Simulator::Now ();
+    }
+  ++m_subscribeAttempts;
+  m_subscribeAttempt (m_subscribeAttempts);
+  SendSubscribeRequest (dest);
+  ScheduleSubscriptionRetry (Simulator::Now ());
+}
+
+void
+WildfireClient::SendSubscribeRequest (Ipv4Address dest)
+{
+  if (m_socket->Connect (InetSocketAddress (Ipv4Address::ConvertFrom (m_peerAddress), m_peerPort)) == -1)
+    {
+      NS_FATAL_ERROR ("Failed to connect socket");
+    }
   Ptr<Packet> p;
-  std::string message = std::string ("Subscription Request");
   Time expires_at = Time (Simulator::Now () + Hours (1));
-  WildfireMessage alert = WildfireMessage (m_id, WildfireMessageType::subscribe, &expires_at, &message);
+  WildfireMessage alert = WildfireMessage (m_id, WildfireMessageType::subscribe, expires_at, "Subscription Request");
+  alert.setOrigin (GetNode ()->GetId ());
+  // The server uses the position to target notifications at an area
+  alert.setPosition (GetPosition ());
   m_id++;
-  auto serialized_alert = alert.serialize ();
-  p = Create<Packet> (serialized_alert->data (), serialized_alert->size ());
+  p = alert.toPacket (m_wireFormat);
   Address localAddress;
   m_socket->GetSockName (localAddress);
   m_txTrace ();
   m_txTraceWithAddresses (p, localAddress, InetSocketAddress (Ipv4Address::ConvertFrom (dest), 202));
   m_socket->Send (p);
-  Simulator::Schedule (Seconds (3.0), &WildfireClient::RetrySubscribe, this, m_socket);
 
   NS_LOG_INFO ("Wildfire Subscription Sent to " << dest);
   NS_LOG_INFO ("At time " << Simulator::Now ().As (Time::S) << " Wildfire Subscription Sent from " << this->GetNode ()->GetId ());
 }
 
+void
+WildfireClient::SetWireFormat (int format)
+{
+  m_wireFormat = static_cast<WildfireWireFormat> (format);
+}
+
+int
+WildfireClient::GetWireFormat (void) const
+{
+  return static_cast<int> (m_wireFormat);
+}
+
 } // Namespace ns3
@@ -24,23 +24,47 @@
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/traced-callback.h"
+#include "ns3/energy-source.h"
+#include "ns3/wifi-phy.h"
+#include <unordered_map>
+#include <vector>
 
 #include "wildfire-message.h"
+#include "wildfire-digest.h"
+#include "wildfire-message-store.h"
+#include "wildfire-seen-filter.h"
+#include "wildfire-trickle.h"
 #include "wildfire-mobility-model.h"
+#include "wildfire-road-graph.h"
 
 namespace ns3 {
 
 class Socket;
 class Packet;
+class WifiPhy;
 
 /**
  * \ingroup Wildfire
  * \brief Wildfire protocol client
  *
+ * With EnergyAware set the client binds to the first energy source of its
+ * node.  Below EnergyLowThreshold the rebroadcast interval grows and the
+ * relay probability shrinks with the remaining energy.  Below
+ * EnergyCriticalThreshold the client stops relaying and keeps the Wi-Fi PHY
+ * asleep except for short listen windows.
  */
 class WildfireClient : public Application
 {
 public:
+  /// How stored notifications are rebroadcast
+  enum BroadcastMode
+  {
+    FIXED,   //!< Every BroadcastInterval
+    TRICKLE, //!< Trickle timer (RFC 6206)
+    GOSSIP,  //!< Once, with a probability from sender distance, copies heard and neighbour density
+    BEACON   //!< Digest every BroadcastInterval, neighbours pull what they miss
+  };
+
   /**
    * \brief Get the type ID.
    * \return the object TypeId
@@ -48,10 +72,48 @@ public:
   static TypeId GetTypeId (void);
   WildfireClient ();
   virtual ~WildfireClient ();
+  /**
+   * \brief Subscribe to the server after dt plus a random SubscribeStartJitter
+   */
   void ScheduleSubscription (Time dt, Ipv4Address dest);
   void SendSubscription (Ipv4Address dest);
   void SetMobility (const Ptr<WildfireMobilityModel> mobility);
 
+  /**
+   * \brief Route notifications without a route of their own along the roads
+   * of graph to the nearest shelter, the graph is shared between clients
+   */
+  void SetRoadGraph (Ptr<WildfireRoadGraph> graph);
+
+  /**
+   * \brief Verify notifications with key, the public key of the server
+   *
+   * A provisioned key is the trust anchor, notifications relayed by peers
+   * are accepted before or without a subscription and keys in acks are
+   * ignored.  Without one the client trusts the key carried by acks from
+   * the server address and drops every notification until the first ack.
+   */
+  void SetServerKey (const Ed25519PublicKey &key);
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this application.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \return energy drawn from the bound energy source in joules, 0 when not energy aware
+   */
+  double GetEnergyConsumed (void) const;
+
+  /**
+   * \return number of new notifications and zone versions received
+   */
+  uint32_t GetDeliveredCount (void) const;
+
 protected:
   virtual void DoDispose (void);
 
@@ -60,6 +122,12 @@ private:
   virtual void StartApplication (void);
   virtual void StopApplication (void);
 
+  /**
+   * \brief WireFormat attribute accessors, EnumValue only holds an int
+   */
+  void SetWireFormat (int format);
+  int GetWireFormat (void) const;
+
   /**
    * \brief Send a packet
    */
@@ -76,28 +144,224 @@ private:
   bool HandleRequest (Ptr<Socket> socket, const Address & source);
   void HandleAccept (Ptr<Socket> socket, const Address & source);
 
-  void  SendAck (Ptr<Socket> socket, Address* dest, uint32_t id);
-  void  SendMsg (Ptr<Socket> socket, Address* dest, WildfireMessage* message);
+  void  SendAck (Ptr<Socket> socket, const Address &dest, uint32_t id);
+
+  /**
+   * \brief Ack notification id to dest after AckJitter
+   */
+  void  ScheduleAck (Ptr<Socket> socket, const Address &dest, uint32_t id);
+  void  SendMsg (Ptr<Socket> socket, const Address &dest, const WildfireMessage &message);
   void  Broadcast ();
+  void  ScheduleBroadcast (Ptr<RandomVariableStream> jitter);
+  /**
+   * \brief Broadcast every stored notification that may still be relayed
+   * \return the number of notifications sent
+   */
+  uint32_t SendStoredNotifications ();
+  bool  CanRelay (const WildfireMessage &message) const;
+
+  /**
+   * \brief Broadcast a digest of every stored notification that may still be relayed
+   * \return the number of digest entries sent
+   */
+  uint32_t SendDigest ();
+
+  /**
+   * \brief Pull the notifications of a neighbour digest this node does not hold
+   */
+  void  HandleDigest (const WildfireMessage &message, const Address &from);
+
+  /**
+   * \brief Send the requested notifications to the neighbour that pulled them
+   */
+  void  HandlePull (const WildfireMessage &message, const Address &from);
+
+  /**
+   * \brief Position of this node, from m_mobility or the node mobility model
+   */
+  Vector GetPosition () const;
+  Vector GroundPosition () const;
+
+  /**
+   * \brief Note a packet from a peer for the neighbour density estimate
+   */
+  void  ObserveNeighbour (Ipv4Address sender);
+  uint32_t CountNeighbours ();
+
+  /**
+   * \brief Start the assessment delay of a new notification in Gossip mode
+   *
+   * \param header header of the notification
+   * \param fromServer the notification came straight from the server
+   */
+  void  ScheduleGossip (const WildfireHeader &header, bool fromServer);
+
+  /**
+   * \brief Count a copy of a notification heard during its assessment delay
+   */
+  void  ObserveGossipCopy (const WildfireHeader &header);
+
+  /**
+   * \brief Decide whether to rebroadcast a notification once its assessment delay ends
+   */
+  void  GossipDecide (uint64_t key);
+  void  TrickleTransmit ();
+  void  TrickleSuppressed ();
+  void  ScheduleExpiry ();
+  void  EvictExpired ();
   void  SetRemote (Address ip, uint16_t port);
   void  SetRemote (Address addr);
   void  RetrySubscribe (Ptr<Socket> socket);
 
+  /**
+   * \brief Schedule the next subscription attempt
+   *
+   * The delay is drawn from [backoff / 2, backoff] where backoff doubles
+   * with every attempt from SubscribeBackoffMin up to SubscribeBackoffMax.
+   * A retry-after hint from the server postpones the attempt further.
+   *
+   * \param retryAfter earliest time the server accepts a new attempt
+   */
+  void  ScheduleSubscriptionRetry (Time retryAfter);
+
+  /**
+   * \brief Renew the server lease while staying subscribed
+   *
+   * Unanswered renewals are repeated after half the remaining lease, and
+   * no sooner than SubscribeBackoffMin.  A lease that runs out
+   * without an ack starts a new subscription.
+   */
+  void  RenewSubscription ();
+
+  /**
+   * \brief Send one subscribe request carrying the current position
+   */
+  void  SendSubscribeRequest (Ipv4Address dest);
+
+  /**
+   * \brief Tell the server to drop this subscriber
+   */
+  void  SendUnsubscribe ();
+
+  /**
+   * \brief Bind to the node energy source and Wi-Fi PHY when EnergyAware is set
+   */
+  void  BindEnergySource ();
+
+  /**
+   * \brief Stop following the energy source and release it and the Wi-Fi PHY
+   */
+  void  UnbindEnergySource ();
+
+  /**
+   * \brief Rebroadcast effort allowed by the remaining energy
+   *
+   * \return 1 above EnergyLowThreshold, falling linearly to 0 at
+   * EnergyCriticalThreshold
+   */
+  double GetEnergyScale ();
+  bool  IsEnergyCritical ();
+
+  /**
+   * \brief Start duty cycling once the energy source turns critical
+   */
+  void  RemainingEnergyChanged (double oldValue, double remainingEnergy);
+
+  /**
+   * \brief Follow, or stop following, the Wi-Fi PHY receptions dropped by the node
+   */
+  void  BindCollisionTrace (bool bind);
+
+  /**
+   * \brief Report drops caused by an overlapping transmission as collisions
+   */
+  void  PhyRxDrop (Ptr<const Packet> packet, WifiPhyRxfailureReason reason);
+
+  /**
+   * \brief Toggle the Wi-Fi PHY between a listen window and sleep
+   */
+  void  DutyCycle ();
+
   Ptr<Socket> m_socket; //!< Socket
   Address m_peerAddress; //!< Remote peer address
   uint16_t m_peerPort; //!< Remote peer port
   EventId m_sendEvent; //!< Event to send the next packet
   EventId m_broadcastEvent;  //!< Event to send the next broadcast packet
+  EventId m_expiryEvent; //!< Event to evict the next expiring message
+  EventId m_subscribeEvent; //!< Event for the next subscription attempt
+  EventId m_renewEvent; //!< Event to renew the subscription lease
+  Time m_leaseExpiry; //!< End of the lease granted by the last ack
   bool m_received = false;
   Time m_broadcast_interval;
+  BroadcastMode m_broadcastMode; //!< Rebroadcast scheduling
+  WildfireTrickleTimer m_trickle; //!< Trickle rebroadcast timer
+  Ptr<UniformRandomVariable> m_trickleRng; //!< Trickle transmission times
+  Time m_trickleImin; //!< Minimum Trickle interval
+  Time m_trickleImax; //!< Maximum Trickle interval
+  uint32_t m_trickleK; //!< Trickle redundancy constant
+  Ptr<RandomVariableStream> m_firstBroadcastJitter; //!< Jitter of the first rebroadcast
+  Ptr<RandomVariableStream> m_broadcastJitter; //!< Jitter of the following rebroadcasts
+  Ptr<RandomVariableStream> m_ackJitter; //!< Jitter of notification acks
   uint32_t m_id = 0;
   uint16_t m_port;   //!< Port on which we listen for incoming packets.
   Ptr<WildfireMobilityModel> m_mobility;
+  Ptr<WildfireRoadGraph> m_roadGraph; //!< Roads to the shelters, may be null
   bool m_subscribed = false;
+  Ptr<RandomVariableStream> m_subscribeStartJitter; //!< Spreads the first subscription attempts
+  Ptr<UniformRandomVariable> m_subscribeRng; //!< Subscription retry jitter
+  Time m_subscribeBackoffMin; //!< Backoff before the first retry
+  Time m_subscribeBackoffMax; //!< Cap on the subscription backoff
+  uint32_t m_subscribeAttempts = 0; //!< Subscription attempts so far
+  Time m_subscribeStart; //!< Time of the first subscription attempt
+  WildfireWireFormat m_wireFormat; //!< Encoding used for messages
 
   // wildfire related messages
-  std::string *m_key = nullptr; //Key from subscription service
-  std::map <uint32_t, WildfireMessage*>* m_messages;
+  Ed25519PublicKey m_serverKey; //!< Public key notifications are verified with
+  bool m_hasServerKey = false; //!< Whether m_serverKey is set
+  bool m_serverKeyProvisioned = false; //!< Whether m_serverKey was set by SetServerKey
+  WildfireVerifyCache m_verifyCache; //!< Memoized notification verification results
+  uint32_t m_verifyCacheSize; //!< Capacity of m_verifyCache
+  WildfireMessageStore m_messages; //!< Notifications held for rebroadcast
+  uint32_t m_messageStoreCapacity; //!< Capacity of m_messages
+  WildfireSeenFilter m_seenFilter; //!< Notifications already accepted
+  Time m_seenFilterAging; //!< How long m_seenFilter remembers a notification
+  uint8_t m_maxHops; //!< Hop count beyond which notifications are not relayed
+  Vector m_evacuationDestination; //!< Destination of notifications without a route
+  double m_evacuationSpeed; //!< Evacuation speed in m/s
+
+  /// Copies and sender distance seen for a notification awaiting its gossip decision
+  struct GossipState
+  {
+    uint32_t origin; //!< Origin of the notification
+    uint32_t id; //!< Id of the notification
+    uint16_t zone; //!< Zone of the notification, 0 for none
+    uint32_t copies; //!< Copies heard, including the first
+    double minDistance; //!< Distance to the closest sender heard in meters
+  };
+
+  std::unordered_map<uint64_t, GossipState> m_gossip; //!< Notifications awaiting a gossip decision
+  std::unordered_map<uint32_t, Time> m_neighbours; //!< Peers heard, by IPv4 address
+  Ptr<UniformRandomVariable> m_gossipRng; //!< Gossip decisions
+  double m_gossipRange; //!< Distance in meters at which the distance factor reaches 1
+  double m_gossipMinProbability; //!< Lower bound of the rebroadcast probability
+  uint32_t m_gossipCounterThreshold; //!< Copies after which a rebroadcast is suppressed
+  uint32_t m_gossipDensityThreshold; //!< Neighbours above which the probability is scaled down
+  Time m_gossipNeighbourWindow; //!< How long a peer counts as a neighbour
+  std::unordered_map<uint64_t, Time> m_pulls; //!< Pending pulls by (origin, id)
+  Time m_pullTimeout; //!< Time before a pending pull is requested again
+
+  bool m_energyAware; //!< Adapt rebroadcasts to the remaining energy
+  double m_energyLowThreshold; //!< Energy fraction below which rebroadcasts are scaled down
+  double m_energyCriticalThreshold; //!< Energy fraction below which relaying stops
+  double m_energyIntervalStretch; //!< Broadcast interval multiplier at the critical threshold
+  Time m_listenWindow; //!< Wi-Fi PHY awake time per duty cycle when critical
+  Time m_sleepInterval; //!< Wi-Fi PHY sleep time per duty cycle when critical
+  Ptr<EnergySource> m_energySource; //!< Energy source of the node, if bound
+  Ptr<WifiPhy> m_wifiPhy; //!< PHY put to sleep when critical
+  std::vector<Ptr<WifiPhy> > m_collisionPhys; //!< PHYs followed for collisions
+  Ptr<UniformRandomVariable> m_energyRng; //!< Energy scaled relay decisions
+  EventId m_dutyCycleEvent; //!< Next Wi-Fi PHY sleep or wake up
+  uint32_t m_delivered = 0; //!< New notifications and zone versions received
 
   /// Callbacks for tracing the packet Tx events
   TracedCallback<> m_txTrace;
@@ -117,6 +381,42 @@ private:
   /// Callback for wildfire notification received from peer
   TracedCallback<> m_rxPeerNotification;
 
+  /// Callback for duplicate notifications dropped before decoding
+  TracedCallback<Ptr<const Packet> > m_duplicatesDropped;
+
+  /// Callback for rebroadcasts and acks deferred by a random jitter
+  TracedCallback<Time> m_txDeferred;
+
+  /// Callback for Wi-Fi frames lost to an overlapping transmission
+  TracedCallback<Ptr<const Packet>, WifiPhyRxfailureReason> m_txCollided;
+
+  /// Callback for Trickle rebroadcasts suppressed by the redundancy constant
+  TracedCallback<> m_txSuppressed;
+
+  /// Callback for new notifications, carries the peer relays it took to arrive
+  TracedCallback<uint32_t> m_hopsTrace;
+
+  /// Callback for gossip decisions, carries the rebroadcast probability
+  TracedCallback<double> m_gossipProbability;
+
+  /// Callback for pull requests sent, carries the number of notifications requested
+  TracedCallback<uint32_t> m_pullTrace;
+
+  /// Callback for new notifications, carries the energy drawn so far per notification in joules
+  TracedCallback<double> m_energyPerDelivery;
+
+  /// Callback for duty cycling, true when the Wi-Fi PHY goes to sleep
+  TracedCallback<bool> m_dutyCycle;
+
+  /// Callback for superseded zone alerts dropped, carries the zone and version
+  TracedCallback<uint16_t, uint32_t> m_staleDropped;
+
+  /// Callback for subscription attempts, carries the attempt number
+  TracedCallback<uint32_t> m_subscribeAttempt;
+
+  /// Callback for an acknowledged subscription, carries the time since the first attempt
+  TracedCallback<Time> m_subscribedTrace;
+
 };
 
 } // namespace ns3
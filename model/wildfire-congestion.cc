@@ -0,0 +1,183 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "wildfire-congestion.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("WildfireCongestion");
+
+WildfireCongestion::WildfireCongestion ()
+  : m_tick (Seconds (1)),
+    m_jamDensity (5000),
+    m_minSpeedFactor (0.05),
+    m_speedStep (0.05),
+    m_lastCost (0),
+    m_totalCost (0),
+    m_updates (0)
+{
+  m_engine = Create<WildfireMobilityEngine> ();
+  m_grid.SetCellSize (100);
+}
+
+WildfireCongestion::~WildfireCongestion ()
+{
+  Simulator::Cancel (m_tickEvent);
+}
+
+void
+WildfireCongestion::SetTick (Time tick)
+{
+  m_tick = tick;
+}
+
+void
+WildfireCongestion::SetCellSize (double size)
+{
+  NS_ASSERT_MSG (m_grid.GetSize () == 0, "Cell size can only be set before the first update");
+  m_grid.SetCellSize (size);
+}
+
+void
+WildfireCongestion::SetJamDensity (double density)
+{
+  m_jamDensity = density;
+}
+
+void
+WildfireCongestion::SetMinSpeedFactor (double factor)
+{
+  m_minSpeedFactor = factor;
+}
+
+void
+WildfireCongestion::SetSpeedStep (double step)
+{
+  m_speedStep = step;
+}
+
+void
+WildfireCongestion::SetEngine (Ptr<WildfireMobilityEngine> engine)
+{
+  NS_ASSERT_MSG (m_nodes.empty (), "Engine can only be set before the first node is added");
+  m_engine = engine;
+}
+
+Ptr<WildfireMobilityEngine>
+WildfireCongestion::GetEngine (void) const
+{
+  return m_engine;
+}
+
+void
+WildfireCongestion::Add (Ptr<WildfireMobilityModel> mobility)
+{
+  if (!mobility->GetEngine ())
+    {
+      mobility->SetEngine (m_engine);
+    }
+  NS_ASSERT_MSG (mobility->GetEngine () == m_engine, "Mobility model is bound to another engine");
+  m_nodes.push_back (mobility);
+}
+
+uint32_t
+WildfireCongestion::GetN (void) const
+{
+  return m_nodes.size ();
+}
+
+void
+WildfireCongestion::Start (void)
+{
+  Simulator::Cancel (m_tickEvent);
+  m_tickEvent = Simulator::ScheduleNow (&WildfireCongestion::Tick, this);
+}
+
+void
+WildfireCongestion::Stop (void)
+{
+  Simulator::Cancel (m_tickEvent);
+}
+
+void
+WildfireCongestion::Tick (void)
+{
+  Update ();
+  m_tickEvent = Simulator::Schedule (m_tick, &WildfireCongestion::Tick, this);
+}
+
+double
+WildfireCongestion::GetSpeedFactor (double density) const
+{
+  double factor = 1 - density / m_jamDensity;
+  if (m_speedStep > 0)
+    {
+      factor = std::ceil (factor / m_speedStep) * m_speedStep;
+    }
+  return std::min (1.0, std::max (m_minSpeedFactor, factor));
+}
+
+void
+WildfireCongestion::Update (void)
+{
+  SystemWallClockMs clock;
+  clock.Start ();
+
+  // Move everybody first so every node sees the densities of this tick
+  Time now = Simulator::Now ();
+  m_engine->Index (now, m_grid);
+  double cellArea = m_grid.GetCellSize () * m_grid.GetCellSize () / 1e6;
+  for (const Ptr<WildfireMobilityModel> &node : m_nodes)
+    {
+      Vector position = m_engine->GetPosition (node->GetEngineSlot (), now);
+      double density = m_grid.GetCellCount (position) / cellArea;
+      node->SetSpeedFactor (GetSpeedFactor (density));
+    }
+
+  m_lastCost = clock.End () / 1000.0;
+  m_totalCost += m_lastCost;
+  ++m_updates;
+  NS_LOG_LOGIC ("Congestion update of " << m_nodes.size () << " nodes took " << m_lastCost << "s");
+}
+
+double
+WildfireCongestion::GetLastUpdateCost (void) const
+{
+  return m_lastCost;
+}
+
+uint64_t
+WildfireCongestion::GetUpdates (void) const
+{
+  return m_updates;
+}
+
+double
+WildfireCongestion::GetTotalUpdateCost (void) const
+{
+  return m_totalCost;
+}
+
+} // namespace ns3
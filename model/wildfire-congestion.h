@@ -0,0 +1,138 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_CONGESTION_H
+#define WILDFIRE_CONGESTION_H
+
+#include <vector>
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "wildfire-mobility-engine.h"
+#include "wildfire-mobility-model.h"
+#include "wildfire-spatial-index.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Density dependent evacuation speed
+ *
+ * Every tick the positions of every slot of the mobility engine are
+ * evaluated in one batch and moved in a shared grid, only nodes that changed
+ * cell touch the grid structure.  The
+ * density of the cell holding a node sets its speed factor with the
+ * Greenshields relation
+ *
+ *   factor = max (MinSpeedFactor, 1 - density / JamDensity)
+ *
+ * so a tick costs O(nodes) whatever the crowding.  Factors are quantized to
+ * SpeedStep so routes are only rebuilt on a noticeable change.
+ */
+class WildfireCongestion : public SimpleRefCount<WildfireCongestion>
+{
+public:
+  WildfireCongestion ();
+  ~WildfireCongestion ();
+
+  /**
+   * \brief Interval between density updates
+   */
+  void SetTick (Time tick);
+
+  /**
+   * \brief Cell edge length in meters, the area density is measured over
+   */
+  void SetCellSize (double size);
+
+  /**
+   * \brief Density in nodes per square kilometer at which traffic stops
+   */
+  void SetJamDensity (double density);
+
+  /**
+   * \brief Lowest speed factor, so a jammed node still creeps forward
+   */
+  void SetMinSpeedFactor (double factor);
+
+  /**
+   * \brief Granularity of the speed factor
+   */
+  void SetSpeedStep (double step);
+
+  /**
+   * \brief Share engine with other users, only allowed before the first Add
+   */
+  void SetEngine (Ptr<WildfireMobilityEngine> engine);
+  Ptr<WildfireMobilityEngine> GetEngine (void) const;
+
+  /**
+   * \brief Register a node, binding its mobility model to the engine
+   */
+  void Add (Ptr<WildfireMobilityModel> mobility);
+  uint32_t GetN (void) const;
+
+  /**
+   * \brief Start ticking, the first update runs now
+   */
+  void Start (void);
+  void Stop (void);
+
+  /**
+   * \brief Move every node in the grid and set its speed factor
+   */
+  void Update (void);
+
+  /**
+   * \brief Speed factor at density in nodes per square kilometer
+   */
+  double GetSpeedFactor (double density) const;
+
+  /**
+   * \return wall clock time of the last update in seconds, to the millisecond
+   */
+  double GetLastUpdateCost (void) const;
+
+  /**
+   * \return number of updates so far and their total wall clock time in seconds
+   */
+  uint64_t GetUpdates (void) const;
+  double GetTotalUpdateCost (void) const;
+
+private:
+  void Tick (void);
+
+  std::vector<Ptr<WildfireMobilityModel> > m_nodes; //!< Registered nodes
+  Ptr<WildfireMobilityEngine> m_engine; //!< Positions of the nodes
+  WildfireGridIndex m_grid; //!< Engine slot positions
+  Time m_tick; //!< Interval between updates
+  double m_jamDensity; //!< Nodes per square kilometer at which traffic stops
+  double m_minSpeedFactor; //!< Lower bound of the speed factor
+  double m_speedStep; //!< Speed factor quantization
+  EventId m_tickEvent; //!< Next update
+  double m_lastCost; //!< Wall clock time of the last update in seconds
+  double m_totalCost; //!< Wall clock time of every update in seconds
+  uint64_t m_updates; //!< Number of updates
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_CONGESTION_H */
@@ -0,0 +1,964 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "wildfire-crypto.h"
+
+namespace ns3
+{
+
+namespace {
+
+const uint32_t K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint64_t K512[80] = {
+  0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL,
+  0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+  0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+  0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+  0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
+  0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+  0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL,
+  0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+  0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+  0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+  0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL,
+  0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+  0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL,
+  0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+  0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+  0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+  0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL,
+  0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+  0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL,
+  0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+  0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+  0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+  0xd192e819d6ef5218ULL, 0xd69906245565a910ULL,
+  0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+  0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
+  0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+  0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+  0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+  0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL,
+  0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+  0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL,
+  0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+  0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+  0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+  0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
+  0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+  0x28db77f523047d84ULL, 0x32caab7b40c72493ULL,
+  0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+  0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+  0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+inline uint32_t
+Rotr (uint32_t x, uint32_t n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+inline uint64_t
+Rotr (uint64_t x, uint32_t n)
+{
+  return (x >> n) | (x << (64 - n));
+}
+
+const uint64_t FE_MASK = (static_cast<uint64_t> (1) << 51) - 1;
+
+/**
+ * \brief Element of GF(2^255 - 19) in five 51 bit limbs
+ *
+ * Limbs may exceed 51 bits between operations, FeCarry brings them back
+ * below 2^52 and FeToBytes produces the canonical encoding.
+ */
+struct Fe
+{
+  uint64_t v[5];
+};
+
+Fe
+FeFromInt (uint64_t x)
+{
+  Fe h = {{x, 0, 0, 0, 0}};
+  return h;
+}
+
+void
+FeCarry (Fe &h)
+{
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      h.v[i + 1] += h.v[i] >> 51;
+      h.v[i] &= FE_MASK;
+    }
+  h.v[0] += 19 * (h.v[4] >> 51);
+  h.v[4] &= FE_MASK;
+}
+
+Fe
+FeAdd (const Fe &a, const Fe &b)
+{
+  Fe h;
+  for (uint32_t i = 0; i < 5; ++i)
+    {
+      h.v[i] = a.v[i] + b.v[i];
+    }
+  FeCarry (h);
+  return h;
+}
+
+Fe
+FeSub (const Fe &a, const Fe &b)
+{
+  // Add 4p so no limb goes negative for inputs below 2^53
+  Fe h;
+  h.v[0] = a.v[0] + 0x1fffffffffffb4ULL - b.v[0];
+  for (uint32_t i = 1; i < 5; ++i)
+    {
+      h.v[i] = a.v[i] + 0x1ffffffffffffcULL - b.v[i];
+    }
+  FeCarry (h);
+  return h;
+}
+
+Fe
+FeMul (const Fe &a, const Fe &b)
+{
+  typedef unsigned __int128 uint128_t;
+  const uint64_t *f = a.v;
+  const uint64_t *g = b.v;
+  uint64_t g1 = 19 * g[1], g2 = 19 * g[2], g3 = 19 * g[3], g4 = 19 * g[4];
+  uint128_t r[5];
+  r[0] = (uint128_t) f[0] * g[0] + (uint128_t) f[1] * g4 + (uint128_t) f[2] * g3
+    + (uint128_t) f[3] * g2 + (uint128_t) f[4] * g1;
+  r[1] = (uint128_t) f[0] * g[1] + (uint128_t) f[1] * g[0] + (uint128_t) f[2] * g4
+    + (uint128_t) f[3] * g3 + (uint128_t) f[4] * g2;
+  r[2] = (uint128_t) f[0] * g[2] + (uint128_t) f[1] * g[1] + (uint128_t) f[2] * g[0]
+    + (uint128_t) f[3] * g4 + (uint128_t) f[4] * g3;
+  r[3] = (uint128_t) f[0] * g[3] + (uint128_t) f[1] * g[2] + (uint128_t) f[2] * g[1]
+    + (uint128_t) f[3] * g[0] + (uint128_t) f[4] * g4;
+  r[4] = (uint128_t) f[0] * g[4] + (uint128_t) f[1] * g[3] + (uint128_t) f[2] * g[2]
+    + (uint128_t) f[3] * g[1] + (uint128_t) f[4] * g[0];
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      r[i + 1] += r[i] >> 51;
+      r[i] &= FE_MASK;
+    }
+  r[0] += 19 * (r[4] >> 51);
+  r[4] &= FE_MASK;
+  r[1] += r[0] >> 51;
+  r[0] &= FE_MASK;
+  Fe h;
+  for (uint32_t i = 0; i < 5; ++i)
+    {
+      h.v[i] = static_cast<uint64_t> (r[i]);
+    }
+  FeCarry (h);
+  return h;
+}
+
+/**
+ * \brief Raise a to the 255 bit little endian exponent
+ */
+Fe
+FePow (const Fe &a, const uint8_t *exponent)
+{
+  Fe h = FeFromInt (1);
+  for (int32_t i = 254; i >= 0; --i)
+    {
+      h = FeMul (h, h);
+      if ((exponent[i / 8] >> (i % 8)) & 1)
+        {
+          h = FeMul (h, a);
+        }
+    }
+  return h;
+}
+
+/**
+ * \brief Exponent 2^255 - 21 = p - 2, a^(p - 2) is the inverse of a
+ */
+const uint8_t EXP_INVERT[32] = {
+  0xeb, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+};
+
+/**
+ * \brief Exponent 2^252 - 3 = (p - 5) / 8 of the square root candidate
+ */
+const uint8_t EXP_SQRT[32] = {
+  0xfd, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0f
+};
+
+/**
+ * \brief Exponent 2^253 - 5 = (p - 1) / 4, 2^((p - 1) / 4) is sqrt (-1)
+ */
+const uint8_t EXP_SQRTM1[32] = {
+  0xfb, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x1f
+};
+
+void
+FeToBytes (uint8_t *out, const Fe &a)
+{
+  // Three passes leave every limb below 2^51, then subtract p if h >= p
+  Fe h = a;
+  FeCarry (h);
+  FeCarry (h);
+  FeCarry (h);
+  uint64_t q = (h.v[0] + 19) >> 51;
+  for (uint32_t i = 1; i < 5; ++i)
+    {
+      q = (h.v[i] + q) >> 51;
+    }
+  h.v[0] += 19 * q;
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      h.v[i + 1] += h.v[i] >> 51;
+      h.v[i] &= FE_MASK;
+    }
+  h.v[4] &= FE_MASK;
+
+  uint64_t words[4] = {
+    h.v[0] | (h.v[1] << 51),
+    (h.v[1] >> 13) | (h.v[2] << 38),
+    (h.v[2] >> 26) | (h.v[3] << 25),
+    (h.v[3] >> 39) | (h.v[4] << 12)
+  };
+  for (uint32_t i = 0; i < 32; ++i)
+    {
+      out[i] = static_cast<uint8_t> (words[i / 8] >> (8 * (i % 8)));
+    }
+}
+
+Fe
+FeFromBytes (const uint8_t *in)
+{
+  uint64_t words[4] = {0, 0, 0, 0};
+  for (uint32_t i = 0; i < 32; ++i)
+    {
+      words[i / 8] |= static_cast<uint64_t> (in[i]) << (8 * (i % 8));
+    }
+  Fe h;
+  h.v[0] = words[0] & FE_MASK;
+  h.v[1] = ((words[0] >> 51) | (words[1] << 13)) & FE_MASK;
+  h.v[2] = ((words[1] >> 38) | (words[2] << 26)) & FE_MASK;
+  h.v[3] = ((words[2] >> 25) | (words[3] << 39)) & FE_MASK;
+  h.v[4] = (words[3] >> 12) & FE_MASK;
+  return h;
+}
+
+bool
+FeEqual (const Fe &a, const Fe &b)
+{
+  uint8_t x[32];
+  uint8_t y[32];
+  FeToBytes (x, a);
+  FeToBytes (y, b);
+  return std::memcmp (x, y, sizeof (x)) == 0;
+}
+
+bool
+FeIsNegative (const Fe &a)
+{
+  uint8_t x[32];
+  FeToBytes (x, a);
+  return x[0] & 1;
+}
+
+/**
+ * \brief Point of the twisted Edwards curve -x^2 + y^2 = 1 + d x^2 y^2 in
+ * extended coordinates x = X / Z, y = Y / Z, x y = T / Z
+ */
+struct Point
+{
+  Fe x, y, z, t;
+};
+
+/**
+ * \brief Curve constants, computed once on first use
+ */
+class Curve
+{
+public:
+  Curve ();
+
+  /**
+   * \brief Add two points, the formula is complete and also doubles
+   */
+  Point Add (const Point &p, const Point &q) const;
+  /**
+   * \brief Multiply a point by a 256 bit little endian scalar
+   */
+  Point Multiply (const Point &p, const uint8_t *scalar) const;
+  /**
+   * \brief Compute a P + b Q sharing the doublings of both products
+   */
+  Point MultiplyAdd (const Point &p, const uint8_t *a, const Point &q, const uint8_t *b) const;
+  void Encode (uint8_t *out, const Point &p) const;
+  /**
+   * \brief Decode a point, rejecting non-canonical y and x = 0 with the sign bit set
+   */
+  bool Decode (Point &p, const uint8_t *in) const;
+
+  Point base; //!< Base point B
+  Point neutral; //!< Neutral element (0, 1)
+
+private:
+  Fe m_d; //!< Curve constant d = -121665 / 121666
+  Fe m_d2; //!< 2 d
+  Fe m_sqrtm1; //!< Square root of -1
+};
+
+Curve::Curve ()
+{
+  Fe zero = FeFromInt (0);
+  Fe one = FeFromInt (1);
+  m_d = FeMul (FeSub (zero, FeFromInt (121665)), FePow (FeFromInt (121666), EXP_INVERT));
+  m_d2 = FeAdd (m_d, m_d);
+  m_sqrtm1 = FePow (FeFromInt (2), EXP_SQRTM1);
+  neutral.x = zero;
+  neutral.y = one;
+  neutral.z = one;
+  neutral.t = zero;
+  // B is the point with y = 4 / 5 and positive x
+  uint8_t encoded[32];
+  std::memset (encoded, 0x66, sizeof (encoded));
+  encoded[0] = 0x58;
+  Decode (base, encoded);
+}
+
+Point
+Curve::Add (const Point &p, const Point &q) const
+{
+  Fe a = FeMul (FeSub (p.y, p.x), FeSub (q.y, q.x));
+  Fe b = FeMul (FeAdd (p.y, p.x), FeAdd (q.y, q.x));
+  Fe c = FeMul (FeMul (p.t, m_d2), q.t);
+  Fe d = FeMul (p.z, q.z);
+  d = FeAdd (d, d);
+  Fe e = FeSub (b, a);
+  Fe f = FeSub (d, c);
+  Fe g = FeAdd (d, c);
+  Fe h = FeAdd (b, a);
+  Point r;
+  r.x = FeMul (e, f);
+  r.y = FeMul (g, h);
+  r.t = FeMul (e, h);
+  r.z = FeMul (f, g);
+  return r;
+}
+
+Point
+Curve::Multiply (const Point &p, const uint8_t *scalar) const
+{
+  Point r = neutral;
+  for (int32_t i = 255; i >= 0; --i)
+    {
+      r = Add (r, r);
+      if ((scalar[i / 8] >> (i % 8)) & 1)
+        {
+          r = Add (r, p);
+        }
+    }
+  return r;
+}
+
+Point
+Curve::MultiplyAdd (const Point &p, const uint8_t *a, const Point &q, const uint8_t *b) const
+{
+  Point pq = Add (p, q);
+  Point r = neutral;
+  for (int32_t i = 255; i >= 0; --i)
+    {
+      r = Add (r, r);
+      uint32_t bits = ((a[i / 8] >> (i % 8)) & 1) | (((b[i / 8] >> (i % 8)) & 1) << 1);
+      if (bits == 1)
+        {
+          r = Add (r, p);
+        }
+      else if (bits == 2)
+        {
+          r = Add (r, q);
+        }
+      else if (bits == 3)
+        {
+          r = Add (r, pq);
+        }
+    }
+  return r;
+}
+
+void
+Curve::Encode (uint8_t *out, const Point &p) const
+{
+  Fe zInverse = FePow (p.z, EXP_INVERT);
+  FeToBytes (out, FeMul (p.y, zInverse));
+  out[31] |= FeIsNegative (FeMul (p.x, zInverse)) << 7;
+}
+
+bool
+Curve::Decode (Point &p, const uint8_t *in) const
+{
+  Fe one = FeFromInt (1);
+  p.y = FeFromBytes (in);
+  uint8_t canonical[32];
+  FeToBytes (canonical, p.y);
+  canonical[31] |= in[31] & 0x80;
+  if (std::memcmp (canonical, in, sizeof (canonical)) != 0)
+    {
+      return false;
+    }
+
+  // x^2 = u / v, the candidate x = u v^3 (u v^7)^((p - 5) / 8)
+  Fe y2 = FeMul (p.y, p.y);
+  Fe u = FeSub (y2, one);
+  Fe v = FeAdd (FeMul (m_d, y2), one);
+  Fe v3 = FeMul (FeMul (v, v), v);
+  Fe uv7 = FeMul (FeMul (u, FeMul (v3, v3)), v);
+  p.x = FeMul (FeMul (u, v3), FePow (uv7, EXP_SQRT));
+  Fe vx2 = FeMul (v, FeMul (p.x, p.x));
+  if (!FeEqual (vx2, u))
+    {
+      if (!FeEqual (vx2, FeSub (FeFromInt (0), u)))
+        {
+          return false;
+        }
+      p.x = FeMul (p.x, m_sqrtm1);
+    }
+  bool negative = in[31] >> 7;
+  if (negative && FeEqual (p.x, FeFromInt (0)))
+    {
+      return false;
+    }
+  if (FeIsNegative (p.x) != negative)
+    {
+      p.x = FeSub (FeFromInt (0), p.x);
+    }
+  p.z = one;
+  p.t = FeMul (p.x, p.y);
+  return true;
+}
+
+const Curve&
+GetCurve (void)
+{
+  static const Curve curve;
+  return curve;
+}
+
+/**
+ * \brief Group order L = 2^252 + 27742317777372353535851937790883648493
+ */
+const int64_t ORDER[32] = {
+  0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10
+};
+
+/**
+ * \brief Reduce the 64 signed radix 2^8 digits of x modulo L into r
+ */
+void
+ModOrder (uint8_t *r, int64_t *x)
+{
+  for (int32_t i = 63; i >= 32; --i)
+    {
+      int64_t carry = 0;
+      int32_t j;
+      for (j = i - 32; j < i - 12; ++j)
+        {
+          x[j] += carry - 16 * x[i] * ORDER[j - (i - 32)];
+          carry = (x[j] + 128) >> 8;
+          x[j] -= carry * 256;
+        }
+      x[j] += carry;
+      x[i] = 0;
+    }
+  int64_t carry = 0;
+  for (uint32_t j = 0; j < 32; ++j)
+    {
+      x[j] += carry - (x[31] >> 4) * ORDER[j];
+      carry = x[j] >> 8;
+      x[j] &= 255;
+    }
+  for (uint32_t j = 0; j < 32; ++j)
+    {
+      x[j] -= carry * ORDER[j];
+    }
+  for (uint32_t i = 0; i < 32; ++i)
+    {
+      x[i + 1] += x[i] >> 8;
+      r[i] = static_cast<uint8_t> (x[i] & 255);
+    }
+}
+
+/**
+ * \brief Reduce a SHA-512 digest modulo L
+ */
+void
+ReduceDigest (uint8_t *r, const Sha512Digest &digest)
+{
+  int64_t x[64];
+  for (uint32_t i = 0; i < 64; ++i)
+    {
+      x[i] = digest[i];
+    }
+  ModOrder (r, x);
+}
+
+/**
+ * \brief Expand a seed into the clamped secret scalar and the nonce prefix
+ */
+Sha512Digest
+ExpandSeed (const Ed25519Seed &seed)
+{
+  Sha512 hash;
+  hash.Update (seed.data (), seed.size ());
+  Sha512Digest expanded = hash.Final ();
+  expanded[0] &= 248;
+  expanded[31] &= 127;
+  expanded[31] |= 64;
+  return expanded;
+}
+
+} // anonymous namespace
+
+Sha256::Sha256 ()
+  : m_blockSize (0),
+    m_length (0)
+{
+  m_state[0] = 0x6a09e667;
+  m_state[1] = 0xbb67ae85;
+  m_state[2] = 0x3c6ef372;
+  m_state[3] = 0xa54ff53a;
+  m_state[4] = 0x510e527f;
+  m_state[5] = 0x9b05688c;
+  m_state[6] = 0x1f83d9ab;
+  m_state[7] = 0x5be0cd19;
+}
+
+void
+Sha256::Transform (const uint8_t *block)
+{
+  uint32_t w[64];
+  for (uint32_t i = 0; i < 16; ++i)
+    {
+      w[i] = (static_cast<uint32_t> (block[i * 4]) << 24) | (static_cast<uint32_t> (block[i * 4 + 1]) << 16)
+        | (static_cast<uint32_t> (block[i * 4 + 2]) << 8) | static_cast<uint32_t> (block[i * 4 + 3]);
+    }
+  for (uint32_t i = 16; i < 64; ++i)
+    {
+      uint32_t s0 = Rotr (w[i - 15], 7) ^ Rotr (w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = Rotr (w[i - 2], 17) ^ Rotr (w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+  uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+  uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+  for (uint32_t i = 0; i < 64; ++i)
+    {
+      uint32_t s1 = Rotr (e, 6) ^ Rotr (e, 11) ^ Rotr (e, 25);
+      uint32_t ch = (e & f) ^ (~e & g);
+      uint32_t t1 = h + s1 + ch + K[i] + w[i];
+      uint32_t s0 = Rotr (a, 2) ^ Rotr (a, 13) ^ Rotr (a, 22);
+      uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint32_t t2 = s0 + maj;
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+
+  m_state[0] += a;
+  m_state[1] += b;
+  m_state[2] += c;
+  m_state[3] += d;
+  m_state[4] += e;
+  m_state[5] += f;
+  m_state[6] += g;
+  m_state[7] += h;
+}
+
+void
+Sha256::Update (const uint8_t *data, uint32_t size)
+{
+  m_length += size;
+  while (size > 0)
+    {
+      uint32_t n = 64 - m_blockSize;
+      if (n > size)
+        {
+          n = size;
+        }
+      std::memcpy (m_block + m_blockSize, data, n);
+      m_blockSize += n;
+      data += n;
+      size -= n;
+      if (m_blockSize == 64)
+        {
+          Transform (m_block);
+          m_blockSize = 0;
+        }
+    }
+}
+
+Sha256Digest
+Sha256::Final ()
+{
+  uint64_t bits = m_length * 8;
+  uint8_t pad = 0x80;
+  Update (&pad, 1);
+  pad = 0;
+  while (m_blockSize != 56)
+    {
+      Update (&pad, 1);
+    }
+  uint8_t length[8];
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      length[i] = static_cast<uint8_t> (bits >> (56 - i * 8));
+    }
+  Update (length, 8);
+
+  Sha256Digest digest;
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      digest[i * 4] = static_cast<uint8_t> (m_state[i] >> 24);
+      digest[i * 4 + 1] = static_cast<uint8_t> (m_state[i] >> 16);
+      digest[i * 4 + 2] = static_cast<uint8_t> (m_state[i] >> 8);
+      digest[i * 4 + 3] = static_cast<uint8_t> (m_state[i]);
+    }
+  return digest;
+}
+
+Sha512::Sha512 ()
+  : m_blockSize (0),
+    m_length (0)
+{
+  m_state[0] = 0x6a09e667f3bcc908ULL;
+  m_state[1] = 0xbb67ae8584caa73bULL;
+  m_state[2] = 0x3c6ef372fe94f82bULL;
+  m_state[3] = 0xa54ff53a5f1d36f1ULL;
+  m_state[4] = 0x510e527fade682d1ULL;
+  m_state[5] = 0x9b05688c2b3e6c1fULL;
+  m_state[6] = 0x1f83d9abfb41bd6bULL;
+  m_state[7] = 0x5be0cd19137e2179ULL;
+}
+
+void
+Sha512::Transform (const uint8_t *block)
+{
+  uint64_t w[80];
+  for (uint32_t i = 0; i < 16; ++i)
+    {
+      w[i] = 0;
+      for (uint32_t j = 0; j < 8; ++j)
+        {
+          w[i] = (w[i] << 8) | block[i * 8 + j];
+        }
+    }
+  for (uint32_t i = 16; i < 80; ++i)
+    {
+      uint64_t s0 = Rotr (w[i - 15], 1) ^ Rotr (w[i - 15], 8) ^ (w[i - 15] >> 7);
+      uint64_t s1 = Rotr (w[i - 2], 19) ^ Rotr (w[i - 2], 61) ^ (w[i - 2] >> 6);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+  uint64_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+  uint64_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+  for (uint32_t i = 0; i < 80; ++i)
+    {
+      uint64_t s1 = Rotr (e, 14) ^ Rotr (e, 18) ^ Rotr (e, 41);
+      uint64_t ch = (e & f) ^ (~e & g);
+      uint64_t t1 = h + s1 + ch + K512[i] + w[i];
+      uint64_t s0 = Rotr (a, 28) ^ Rotr (a, 34) ^ Rotr (a, 39);
+      uint64_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint64_t t2 = s0 + maj;
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+
+  m_state[0] += a;
+  m_state[1] += b;
+  m_state[2] += c;
+  m_state[3] += d;
+  m_state[4] += e;
+  m_state[5] += f;
+  m_state[6] += g;
+  m_state[7] += h;
+}
+
+void
+Sha512::Update (const uint8_t *data, uint32_t size)
+{
+  m_length += size;
+  while (size > 0)
+    {
+      uint32_t n = 128 - m_blockSize;
+      if (n > size)
+        {
+          n = size;
+        }
+      std::memcpy (m_block + m_blockSize, data, n);
+      m_blockSize += n;
+      data += n;
+      size -= n;
+      if (m_blockSize == 128)
+        {
+          Transform (m_block);
+          m_blockSize = 0;
+        }
+    }
+}
+
+Sha512Digest
+Sha512::Final ()
+{
+  // Messages stay far below 2^61 bytes, the upper half of the length is zero
+  uint64_t bits = m_length * 8;
+  uint8_t pad = 0x80;
+  Update (&pad, 1);
+  pad = 0;
+  while (m_blockSize != 120)
+    {
+      Update (&pad, 1);
+    }
+  uint8_t length[8];
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      length[i] = static_cast<uint8_t> (bits >> (56 - i * 8));
+    }
+  Update (length, 8);
+
+  Sha512Digest digest;
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      for (uint32_t j = 0; j < 8; ++j)
+        {
+          digest[i * 8 + j] = static_cast<uint8_t> (m_state[i] >> (56 - j * 8));
+        }
+    }
+  return digest;
+}
+
+Ed25519PublicKey
+Ed25519GetPublicKey (const Ed25519Seed &seed)
+{
+  const Curve &curve = GetCurve ();
+  Sha512Digest expanded = ExpandSeed (seed);
+  Ed25519PublicKey publicKey;
+  curve.Encode (publicKey.data (), curve.Multiply (curve.base, expanded.data ()));
+  return publicKey;
+}
+
+Ed25519Signature
+Ed25519Sign (const Ed25519Seed &seed, const uint8_t *prefix, uint32_t prefixSize,
+             const uint8_t *data, uint32_t size)
+{
+  const Curve &curve = GetCurve ();
+  Sha512Digest expanded = ExpandSeed (seed);
+  Ed25519PublicKey publicKey;
+  curve.Encode (publicKey.data (), curve.Multiply (curve.base, expanded.data ()));
+
+  // r = H (nonce prefix || M) mod L, R = r B
+  Sha512 nonceHash;
+  nonceHash.Update (expanded.data () + 32, 32);
+  nonceHash.Update (prefix, prefixSize);
+  nonceHash.Update (data, size);
+  uint8_t r[32];
+  ReduceDigest (r, nonceHash.Final ());
+  Ed25519Signature signature;
+  curve.Encode (signature.data (), curve.Multiply (curve.base, r));
+
+  // S = (r + H (R || A || M) a) mod L
+  Sha512 challengeHash;
+  challengeHash.Update (signature.data (), 32);
+  challengeHash.Update (publicKey.data (), publicKey.size ());
+  challengeHash.Update (prefix, prefixSize);
+  challengeHash.Update (data, size);
+  uint8_t k[32];
+  ReduceDigest (k, challengeHash.Final ());
+  int64_t x[64];
+  for (uint32_t i = 0; i < 64; ++i)
+    {
+      x[i] = i < 32 ? r[i] : 0;
+    }
+  for (uint32_t i = 0; i < 32; ++i)
+    {
+      for (uint32_t j = 0; j < 32; ++j)
+        {
+          x[i + j] += static_cast<int64_t> (k[i]) * expanded[j];
+        }
+    }
+  ModOrder (signature.data () + 32, x);
+  return signature;
+}
+
+bool
+Ed25519Verify (const Ed25519PublicKey &publicKey, const Ed25519Signature &signature,
+               const uint8_t *prefix, uint32_t prefixSize, const uint8_t *data, uint32_t size)
+{
+  const Curve &curve = GetCurve ();
+  Point a;
+  if (!curve.Decode (a, publicKey.data ()))
+    {
+      return false;
+    }
+  // S must be below L, otherwise S + L would be a second valid signature
+  const uint8_t *s = signature.data () + 32;
+  for (int32_t i = 31; i >= 0; --i)
+    {
+      if (s[i] != ORDER[i])
+        {
+          if (s[i] > ORDER[i])
+            {
+              return false;
+            }
+          break;
+        }
+      if (i == 0)
+        {
+          return false;
+        }
+    }
+
+  Sha512 challengeHash;
+  challengeHash.Update (signature.data (), 32);
+  challengeHash.Update (publicKey.data (), publicKey.size ());
+  challengeHash.Update (prefix, prefixSize);
+  challengeHash.Update (data, size);
+  uint8_t k[32];
+  ReduceDigest (k, challengeHash.Final ());
+
+  // Accept when S B - k A encodes to R
+  Fe zero = FeFromInt (0);
+  a.x = FeSub (zero, a.x);
+  a.t = FeSub (zero, a.t);
+  Point check = curve.MultiplyAdd (curve.base, s, a, k);
+  uint8_t encoded[32];
+  curve.Encode (encoded, check);
+  return std::memcmp (encoded, signature.data (), sizeof (encoded)) == 0;
+}
+
+bool
+WildfireVerifyCache::Key::operator== (const Key &other) const
+{
+  return id == other.id && hash == other.hash;
+}
+
+size_t
+WildfireVerifyCache::KeyHash::operator() (const Key &key) const
+{
+  // The hash is a signature, its leading bytes are already uniformly distributed
+  uint64_t prefix;
+  std::memcpy (&prefix, key.hash.data (), sizeof (prefix));
+  return static_cast<size_t> (prefix ^ (static_cast<uint64_t> (key.id) * 0x9e3779b97f4a7c15ULL));
+}
+
+WildfireVerifyCache::WildfireVerifyCache ()
+  : m_capacity (64),
+    m_hits (0),
+    m_misses (0)
+{
+}
+
+void
+WildfireVerifyCache::SetCapacity (uint32_t capacity)
+{
+  m_capacity = capacity;
+  m_results.reserve (capacity);
+}
+
+bool
+WildfireVerifyCache::Lookup (uint32_t id, const Ed25519Signature &hash, const uint8_t *prefix, uint32_t prefixSize,
+                             const uint8_t *data, uint32_t size, bool &valid)
+{
+  auto itr = m_results.find (Key {id, hash});
+  if (itr == m_results.end ()
+      || itr->second.content.size () != prefixSize + size
+      || !std::equal (prefix, prefix + prefixSize, itr->second.content.begin ())
+      || !std::equal (data, data + size, itr->second.content.begin () + prefixSize))
+    {
+      ++m_misses;
+      return false;
+    }
+  ++m_hits;
+  valid = itr->second.valid;
+  return true;
+}
+
+void
+WildfireVerifyCache::Insert (uint32_t id, const Ed25519Signature &hash, const uint8_t *prefix, uint32_t prefixSize,
+                             const uint8_t *data, uint32_t size, bool valid)
+{
+  if (m_capacity == 0)
+    {
+      return;
+    }
+  if (m_results.size () >= m_capacity)
+    {
+      m_results.clear ();
+    }
+  Result &result = m_results[Key {id, hash}];
+  result.content.assign (prefix, prefix + prefixSize);
+  result.content.insert (result.content.end (), data, data + size);
+  result.valid = valid;
+}
+
+void
+WildfireVerifyCache::Clear (void)
+{
+  m_results.clear ();
+}
+
+uint64_t
+WildfireVerifyCache::GetHits (void) const
+{
+  return m_hits;
+}
+
+uint64_t
+WildfireVerifyCache::GetMisses (void) const
+{
+  return m_misses;
+}
+
+} // namespace ns3
@@ -0,0 +1,162 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_CRYPTO_H
+#define WILDFIRE_CRYPTO_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+typedef std::array<uint8_t, 32> Sha256Digest;
+
+/**
+ * \ingroup Wildfire
+ * \brief Self contained SHA-256 (FIPS 180-4)
+ */
+class Sha256
+{
+public:
+  Sha256 ();
+  void Update (const uint8_t *data, uint32_t size);
+  Sha256Digest Final ();
+
+private:
+  void Transform (const uint8_t *block);
+
+  uint32_t m_state[8]; //!< Intermediate hash value
+  uint8_t m_block[64]; //!< Partially filled input block
+  uint32_t m_blockSize; //!< Bytes used in m_block
+  uint64_t m_length; //!< Total message length in bytes
+};
+
+typedef std::array<uint8_t, 64> Sha512Digest;
+
+/**
+ * \ingroup Wildfire
+ * \brief Self contained SHA-512 (FIPS 180-4), the hash of Ed25519
+ */
+class Sha512
+{
+public:
+  Sha512 ();
+  void Update (const uint8_t *data, uint32_t size);
+  Sha512Digest Final ();
+
+private:
+  void Transform (const uint8_t *block);
+
+  uint64_t m_state[8]; //!< Intermediate hash value
+  uint8_t m_block[128]; //!< Partially filled input block
+  uint32_t m_blockSize; //!< Bytes used in m_block
+  uint64_t m_length; //!< Total message length in bytes
+};
+
+typedef std::array<uint8_t, 32> Ed25519Seed; //!< Private key
+typedef std::array<uint8_t, 32> Ed25519PublicKey; //!< Encoded public point
+typedef std::array<uint8_t, 64> Ed25519Signature; //!< Encoded R followed by S
+
+/**
+ * \brief Derive the Ed25519 (RFC 8032) public key of a private key
+ */
+Ed25519PublicKey Ed25519GetPublicKey (const Ed25519Seed &seed);
+
+/**
+ * \brief Sign the concatenation of prefix and data with Ed25519
+ */
+Ed25519Signature Ed25519Sign (const Ed25519Seed &seed, const uint8_t *prefix, uint32_t prefixSize,
+                              const uint8_t *data, uint32_t size);
+
+/**
+ * \brief Verify an Ed25519 signature of the concatenation of prefix and data
+ *
+ * \return false for a bad signature, a malformed public key or a
+ * non-canonical S
+ */
+bool Ed25519Verify (const Ed25519PublicKey &publicKey, const Ed25519Signature &signature,
+                    const uint8_t *prefix, uint32_t prefixSize, const uint8_t *data, uint32_t size);
+
+/**
+ * \ingroup Wildfire
+ * \brief Memoized verification results keyed by (message id, hash)
+ *
+ * A rebroadcast notification arrives many times with the same id and hash,
+ * only the first copy has to check the signature.  Id and hash are chosen by the
+ * sender, so every entry also keeps the signed bytes it was computed over
+ * and a lookup only hits when the new copy signs the very same bytes.  The
+ * cache is cleared when it reaches its capacity or when the verification
+ * key changes.
+ */
+class WildfireVerifyCache
+{
+public:
+  WildfireVerifyCache ();
+  void SetCapacity (uint32_t capacity);
+
+  /**
+   * \brief Look up a previous verification result
+   * \param id message id
+   * \param hash message hash
+   * \param prefix signed fields of the message
+   * \param prefixSize size of the signed fields
+   * \param data signed payload of the message
+   * \param size size of the payload
+   * \param valid set to the cached result on a hit
+   * \return true on a cache hit
+   */
+  bool Lookup (uint32_t id, const Ed25519Signature &hash, const uint8_t *prefix, uint32_t prefixSize,
+               const uint8_t *data, uint32_t size, bool &valid);
+  void Insert (uint32_t id, const Ed25519Signature &hash, const uint8_t *prefix, uint32_t prefixSize,
+               const uint8_t *data, uint32_t size, bool valid);
+  void Clear (void);
+
+  uint64_t GetHits (void) const;
+  uint64_t GetMisses (void) const;
+
+private:
+  struct Key
+  {
+    uint32_t id;
+    Ed25519Signature hash;
+    bool operator== (const Key &other) const;
+  };
+  struct KeyHash
+  {
+    size_t operator() (const Key &key) const;
+  };
+
+  struct Result
+  {
+    std::vector<uint8_t> content; //!< Signed fields followed by the payload
+    bool valid;
+  };
+
+  std::unordered_map<Key, Result, KeyHash> m_results; //!< Verification results
+  uint32_t m_capacity; //!< Maximum number of cached results
+  uint64_t m_hits; //!< Number of cache hits
+  uint64_t m_misses; //!< Number of cache misses
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_CRYPTO_H */
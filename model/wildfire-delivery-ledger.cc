@@ -0,0 +1,207 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include "wildfire-delivery-ledger.h"
+
+namespace ns3
+{
+
+WildfireDeliveryLedger::WildfireDeliveryLedger ()
+{
+}
+
+bool
+WildfireDeliveryLedger::TestBit (const std::vector<uint64_t> &bits, uint32_t slot)
+{
+  uint32_t word = slot / 64;
+  return word < bits.size () && (bits[word] >> (slot % 64)) & 1;
+}
+
+bool
+WildfireDeliveryLedger::SetBit (std::vector<uint64_t> &bits, uint32_t slot)
+{
+  uint32_t word = slot / 64;
+  if (word >= bits.size ())
+    {
+      bits.resize (word + 1, 0);
+    }
+  uint64_t mask = static_cast<uint64_t> (1) << (slot % 64);
+  bool isNew = (bits[word] & mask) == 0;
+  bits[word] |= mask;
+  return isNew;
+}
+
+void
+WildfireDeliveryLedger::ClearBit (std::vector<uint64_t> &bits, uint32_t slot)
+{
+  uint32_t word = slot / 64;
+  if (word < bits.size ())
+    {
+      bits[word] &= ~(static_cast<uint64_t> (1) << (slot % 64));
+    }
+}
+
+void
+WildfireDeliveryLedger::Open (std::shared_ptr<const WildfireMessage> message)
+{
+  Record &record = m_records[message->getId ()];
+  record.message = std::move (message);
+  record.sent.clear ();
+  record.acked.clear ();
+  record.nSent = 0;
+  record.nAcked = 0;
+  record.attempts = 0;
+}
+
+void
+WildfireDeliveryLedger::Close (uint32_t id)
+{
+  m_records.erase (id);
+}
+
+bool
+WildfireDeliveryLedger::IsOpen (uint32_t id) const
+{
+  return m_records.find (id) != m_records.end ();
+}
+
+std::shared_ptr<const WildfireMessage>
+WildfireDeliveryLedger::GetMessage (uint32_t id) const
+{
+  auto itr = m_records.find (id);
+  if (itr == m_records.end ())
+    {
+      return nullptr;
+    }
+  return itr->second.message;
+}
+
+void
+WildfireDeliveryLedger::MarkSent (uint32_t id, uint32_t slot)
+{
+  auto itr = m_records.find (id);
+  if (itr != m_records.end () && SetBit (itr->second.sent, slot))
+    {
+      ++itr->second.nSent;
+    }
+}
+
+bool
+WildfireDeliveryLedger::MarkAcked (uint32_t id, uint32_t slot)
+{
+  // Only acks from slots the server sent to count, a slot that heard the
+  // notification from a peer acks the peer instead
+  auto itr = m_records.find (id);
+  if (itr == m_records.end () || !TestBit (itr->second.sent, slot) || !SetBit (itr->second.acked, slot))
+    {
+      return false;
+    }
+  ++itr->second.nAcked;
+  return true;
+}
+
+bool
+WildfireDeliveryLedger::IsAcked (uint32_t id, uint32_t slot) const
+{
+  auto itr = m_records.find (id);
+  return itr != m_records.end () && TestBit (itr->second.acked, slot);
+}
+
+void
+WildfireDeliveryLedger::ReleaseSlot (uint32_t slot)
+{
+  for (auto &entry : m_records)
+    {
+      ClearBit (entry.second.sent, slot);
+      ClearBit (entry.second.acked, slot);
+    }
+}
+
+void
+WildfireDeliveryLedger::GetUnacked (uint32_t id, std::vector<uint32_t> &slots) const
+{
+  auto itr = m_records.find (id);
+  if (itr == m_records.end ())
+    {
+      return;
+    }
+  const Record &record = itr->second;
+  // Walk the set bits of sent & ~acked a word at a time
+  for (uint32_t word = 0; word < record.sent.size (); ++word)
+    {
+      uint64_t bits = record.sent[word];
+      if (word < record.acked.size ())
+        {
+          bits &= ~record.acked[word];
+        }
+      while (bits != 0)
+        {
+          uint32_t bit = 0;
+          while (((bits >> bit) & 1) == 0)
+            {
+              ++bit;
+            }
+          slots.push_back (word * 64 + bit);
+          bits &= bits - 1;
+        }
+    }
+}
+
+uint32_t
+WildfireDeliveryLedger::GetSent (uint32_t id) const
+{
+  auto itr = m_records.find (id);
+  return itr == m_records.end () ? 0 : itr->second.nSent;
+}
+
+uint32_t
+WildfireDeliveryLedger::GetAcked (uint32_t id) const
+{
+  auto itr = m_records.find (id);
+  return itr == m_records.end () ? 0 : itr->second.nAcked;
+}
+
+double
+WildfireDeliveryLedger::GetDeliveryRatio (uint32_t id) const
+{
+  auto itr = m_records.find (id);
+  if (itr == m_records.end () || itr->second.nSent == 0)
+    {
+      return 0;
+    }
+  return static_cast<double> (itr->second.nAcked) / itr->second.nSent;
+}
+
+uint32_t
+WildfireDeliveryLedger::AddAttempt (uint32_t id)
+{
+  auto itr = m_records.find (id);
+  if (itr == m_records.end ())
+    {
+      return 0;
+    }
+  return ++itr->second.attempts;
+}
+
+void
+WildfireDeliveryLedger::Clear (void)
+{
+  m_records.clear ();
+}
+
+} // namespace ns3
@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_DELIVERY_LEDGER_H
+#define WILDFIRE_DELIVERY_LEDGER_H
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "wildfire-message.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Which subscribers were sent and acknowledged each notification
+ *
+ * Every open notification keeps two bitmaps indexed by subscriber slot,
+ * one for the slots it was sent to and one for the slots that acked it.
+ * Retransmissions are aimed at the difference of the two.
+ */
+class WildfireDeliveryLedger
+{
+public:
+  WildfireDeliveryLedger ();
+
+  /**
+   * \brief Start tracking a notification
+   */
+  void Open (std::shared_ptr<const WildfireMessage> message);
+
+  /**
+   * \brief Stop tracking a notification and release its bitmaps
+   */
+  void Close (uint32_t id);
+
+  bool IsOpen (uint32_t id) const;
+
+  /**
+   * \return the tracked notification or nullptr
+   */
+  std::shared_ptr<const WildfireMessage> GetMessage (uint32_t id) const;
+
+  /**
+   * \brief Record that the notification was sent to slot
+   */
+  void MarkSent (uint32_t id, uint32_t slot);
+
+  /**
+   * \brief Record an ack from slot
+   * \return true if this is the first ack of an open notification from slot
+   */
+  bool MarkAcked (uint32_t id, uint32_t slot);
+
+  bool IsAcked (uint32_t id, uint32_t slot) const;
+
+  /**
+   * \brief Forget slot in every open notification once its subscriber left
+   *
+   * The sent and acked counts keep the departed subscriber, only the bits
+   * are cleared so a later subscriber reusing the slot starts unsent.
+   */
+  void ReleaseSlot (uint32_t slot);
+
+  /**
+   * \brief Append the slots that were sent the notification but did not ack it
+   */
+  void GetUnacked (uint32_t id, std::vector<uint32_t> &slots) const;
+
+  uint32_t GetSent (uint32_t id) const;
+  uint32_t GetAcked (uint32_t id) const;
+
+  /**
+   * \brief Acked over sent subscribers, 0 for an unknown notification
+   */
+  double GetDeliveryRatio (uint32_t id) const;
+
+  /**
+   * \brief Count a retransmission round of the notification
+   * \return the number of rounds so far
+   */
+  uint32_t AddAttempt (uint32_t id);
+
+  void Clear (void);
+
+private:
+  /// Ledger of one notification
+  struct Record
+  {
+    std::shared_ptr<const WildfireMessage> message; //!< Notification to retransmit
+    std::vector<uint64_t> sent; //!< Bit per slot the notification was sent to
+    std::vector<uint64_t> acked; //!< Bit per slot that acked
+    uint32_t nSent; //!< Bits set in sent
+    uint32_t nAcked; //!< Bits set in acked
+    uint32_t attempts; //!< Retransmission rounds
+  };
+
+  static bool TestBit (const std::vector<uint64_t> &bits, uint32_t slot);
+
+  /**
+   * \return true if the bit was newly set
+   */
+  static bool SetBit (std::vector<uint64_t> &bits, uint32_t slot);
+
+  static void ClearBit (std::vector<uint64_t> &bits, uint32_t slot);
+
+  std::unordered_map<uint32_t, Record> m_records; //!< Open notifications by id
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_DELIVERY_LEDGER_H */
@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include "wildfire-digest.h"
+
+namespace ns3
+{
+
+namespace {
+
+void
+WriteU32 (std::string &out, uint32_t value)
+{
+  out.push_back (static_cast<char> (value >> 24));
+  out.push_back (static_cast<char> (value >> 16));
+  out.push_back (static_cast<char> (value >> 8));
+  out.push_back (static_cast<char> (value));
+}
+
+uint32_t
+ReadU32 (const uint8_t *data)
+{
+  return (static_cast<uint32_t> (data[0]) << 24) | (static_cast<uint32_t> (data[1]) << 16)
+         | (static_cast<uint32_t> (data[2]) << 8) | data[3];
+}
+
+} // anonymous namespace
+
+void
+WildfireDigest::Add (const Entry &entry)
+{
+  m_entries.push_back (entry);
+}
+
+void
+WildfireDigest::Add (const WildfireMessage &message)
+{
+  m_entries.push_back (Entry {message.getOrigin (), message.getId (), message.getZone (), message.getVersion ()});
+}
+
+uint32_t
+WildfireDigest::GetN (void) const
+{
+  return m_entries.size ();
+}
+
+const WildfireDigest::Entry&
+WildfireDigest::Get (uint32_t i) const
+{
+  return m_entries[i];
+}
+
+bool
+WildfireDigest::IsEmpty (void) const
+{
+  return m_entries.empty ();
+}
+
+void
+WildfireDigest::Clear (void)
+{
+  m_entries.clear ();
+}
+
+std::string
+WildfireDigest::Serialize (void) const
+{
+  std::string out;
+  out.reserve (m_entries.size () * ENTRY_SIZE);
+  for (const Entry &entry : m_entries)
+    {
+      WriteU32 (out, entry.origin);
+      WriteU32 (out, entry.id);
+      out.push_back (static_cast<char> (entry.zone >> 8));
+      out.push_back (static_cast<char> (entry.zone));
+      WriteU32 (out, entry.version);
+    }
+  return out;
+}
+
+bool
+WildfireDigest::Deserialize (const std::string &payload)
+{
+  m_entries.clear ();
+  if (payload.size () % ENTRY_SIZE != 0)
+    {
+      return false;
+    }
+  const uint8_t *data = reinterpret_cast<const uint8_t*> (payload.data ());
+  m_entries.reserve (payload.size () / ENTRY_SIZE);
+  for (uint32_t offset = 0; offset < payload.size (); offset += ENTRY_SIZE)
+    {
+      const uint8_t *p = data + offset;
+      Entry entry;
+      entry.origin = ReadU32 (p);
+      entry.id = ReadU32 (p + 4);
+      entry.zone = static_cast<uint16_t> ((p[8] << 8) | p[9]);
+      entry.version = ReadU32 (p + 10);
+      m_entries.push_back (entry);
+    }
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_DIGEST_H
+#define WILDFIRE_DIGEST_H
+
+#include <string>
+#include <vector>
+
+#include "wildfire-message.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Compact list of the notifications a node holds
+ *
+ * Carried as the payload of digest beacons and pull requests.  Each entry
+ * is (origin, id, zone, version), ENTRY_SIZE bytes in network order, so a
+ * beacon costs a few bytes per notification whatever the alert size.
+ */
+class WildfireDigest
+{
+public:
+  static const uint32_t ENTRY_SIZE = 14; //!< Encoded size of one entry in bytes
+
+  /// Identity of one notification
+  struct Entry
+  {
+    uint32_t origin; //!< Node id of the originator
+    uint32_t id; //!< Message id
+    uint16_t zone; //!< Alert zone, 0 for none
+    uint32_t version; //!< Version of the zone alert
+  };
+
+  void Add (const Entry &entry);
+  void Add (const WildfireMessage &message);
+  uint32_t GetN (void) const;
+  const Entry& Get (uint32_t i) const;
+  bool IsEmpty (void) const;
+  void Clear (void);
+
+  /**
+   * \brief Encode the entries as a message payload
+   */
+  std::string Serialize (void) const;
+
+  /**
+   * \brief Replace the entries with the ones encoded in payload
+   * \return false if the payload is not a whole number of entries
+   */
+  bool Deserialize (const std::string &payload);
+
+private:
+  std::vector<Entry> m_entries; //!< Entries in insertion order
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_DIGEST_H */
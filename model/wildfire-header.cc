@@ -0,0 +1,333 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include <cstring>
+#include "wildfire-header.h"
+#include "wildfire-message.h"
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED (WildfireHeader);
+
+const uint32_t WildfireHeader::COMPACT_SIZE;
+const uint32_t WildfireHeader::FULL_SIZE;
+
+WildfireHeader::WildfireHeader ()
+  : m_id (0),
+    m_origin (0),
+    m_type (0),
+    m_expiresAt (0),
+    m_payloadSize (0),
+    m_zone (0),
+    m_version (0),
+    m_hops (0),
+    m_ttl (255),
+    m_routeSize (0),
+    m_x (0),
+    m_y (0)
+{
+  std::memset (m_hash, 0, HASH_SIZE);
+}
+
+WildfireHeader::~WildfireHeader ()
+{
+}
+
+TypeId
+WildfireHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::WildfireHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<WildfireHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+WildfireHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+WildfireHeader::Print (std::ostream &os) const
+{
+  os << "id=" << m_id << " origin=" << m_origin << " type=" << static_cast<uint32_t> (m_type);
+  if (IsCompact ())
+    {
+      os << " payload=" << m_payloadSize;
+      return;
+    }
+  os << " expires=" << NanoSeconds (m_expiresAt).As (Time::S)
+     << " payload=" << m_payloadSize << " zone=" << m_zone << " version=" << m_version
+     << " hops=" << static_cast<uint32_t> (m_hops) << " ttl=" << static_cast<uint32_t> (m_ttl)
+     << " route=" << static_cast<uint32_t> (m_routeSize)
+     << " position=(" << m_x << ", " << m_y << ")";
+}
+
+uint32_t
+WildfireHeader::GetSerializedSize (void) const
+{
+  return IsCompact () ? COMPACT_SIZE : FULL_SIZE;
+}
+
+bool
+WildfireHeader::IsCompact (void) const
+{
+  return IsCompactType (m_type);
+}
+
+bool
+WildfireHeader::IsCompactType (uint8_t type)
+{
+  return type == WildfireMessageType::digest || type == WildfireMessageType::pull;
+}
+
+bool
+WildfireHeader::IsComplete (Ptr<const Packet> packet)
+{
+  // Id and origin come first, then the type byte that selects the layout
+  const uint32_t typeOffset = 4 + 4;
+  uint8_t start[typeOffset + 1];
+  uint32_t size = packet->GetSize ();
+  if (size < COMPACT_SIZE || packet->CopyData (start, sizeof (start)) != sizeof (start))
+    {
+      return false;
+    }
+  return size >= (IsCompactType (start[typeOffset]) ? COMPACT_SIZE : FULL_SIZE);
+}
+
+void
+WildfireHeader::ResetFullFields (void)
+{
+  m_expiresAt = 0;
+  m_zone = 0;
+  m_version = 0;
+  m_hops = 0;
+  m_ttl = 255;
+  m_routeSize = 0;
+  m_x = 0;
+  m_y = 0;
+  std::memset (m_hash, 0, HASH_SIZE);
+}
+
+void
+WildfireHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteHtonU32 (m_id);
+  i.WriteHtonU32 (m_origin);
+  i.WriteU8 (m_type);
+  if (IsCompact ())
+    {
+      i.WriteHtonU16 (m_payloadSize);
+      return;
+    }
+  i.WriteHtonU64 (static_cast<uint64_t> (m_expiresAt));
+  i.WriteHtonU16 (m_payloadSize);
+  i.WriteHtonU16 (m_zone);
+  i.WriteHtonU32 (m_version);
+  i.WriteU8 (m_hops);
+  i.WriteU8 (m_ttl);
+  i.WriteU8 (m_routeSize);
+  uint32_t bits;
+  std::memcpy (&bits, &m_x, sizeof (bits));
+  i.WriteHtonU32 (bits);
+  std::memcpy (&bits, &m_y, sizeof (bits));
+  i.WriteHtonU32 (bits);
+  i.Write (m_hash, HASH_SIZE);
+}
+
+uint32_t
+WildfireHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_id = i.ReadNtohU32 ();
+  m_origin = i.ReadNtohU32 ();
+  m_type = i.ReadU8 ();
+  if (IsCompact ())
+    {
+      m_payloadSize = i.ReadNtohU16 ();
+      ResetFullFields ();
+      return COMPACT_SIZE;
+    }
+  m_expiresAt = static_cast<int64_t> (i.ReadNtohU64 ());
+  m_payloadSize = i.ReadNtohU16 ();
+  m_zone = i.ReadNtohU16 ();
+  m_version = i.ReadNtohU32 ();
+  m_hops = i.ReadU8 ();
+  m_ttl = i.ReadU8 ();
+  m_routeSize = i.ReadU8 ();
+  uint32_t bits = i.ReadNtohU32 ();
+  std::memcpy (&m_x, &bits, sizeof (bits));
+  bits = i.ReadNtohU32 ();
+  std::memcpy (&m_y, &bits, sizeof (bits));
+  i.Read (m_hash, HASH_SIZE);
+  return GetSerializedSize ();
+}
+
+void
+WildfireHeader::SetId (uint32_t id)
+{
+  m_id = id;
+}
+
+uint32_t
+WildfireHeader::GetId (void) const
+{
+  return m_id;
+}
+
+void
+WildfireHeader::SetOrigin (uint32_t origin)
+{
+  m_origin = origin;
+}
+
+uint32_t
+WildfireHeader::GetOrigin (void) const
+{
+  return m_origin;
+}
+
+void
+WildfireHeader::SetType (uint8_t type)
+{
+  m_type = type;
+}
+
+uint8_t
+WildfireHeader::GetType (void) const
+{
+  return m_type;
+}
+
+void
+WildfireHeader::SetExpiresAt (Time expiresAt)
+{
+  m_expiresAt = expiresAt.GetNanoSeconds ();
+}
+
+Time
+WildfireHeader::GetExpiresAt (void) const
+{
+  return NanoSeconds (m_expiresAt);
+}
+
+void
+WildfireHeader::SetPayloadSize (uint16_t size)
+{
+  m_payloadSize = size;
+}
+
+uint16_t
+WildfireHeader::GetPayloadSize (void) const
+{
+  return m_payloadSize;
+}
+
+void
+WildfireHeader::SetZone (uint16_t zone)
+{
+  m_zone = zone;
+}
+
+uint16_t
+WildfireHeader::GetZone (void) const
+{
+  return m_zone;
+}
+
+void
+WildfireHeader::SetVersion (uint32_t version)
+{
+  m_version = version;
+}
+
+uint32_t
+WildfireHeader::GetVersion (void) const
+{
+  return m_version;
+}
+
+void
+WildfireHeader::SetHops (uint8_t hops)
+{
+  m_hops = hops;
+}
+
+uint8_t
+WildfireHeader::GetHops (void) const
+{
+  return m_hops;
+}
+
+void
+WildfireHeader::SetTtl (uint8_t ttl)
+{
+  m_ttl = ttl;
+}
+
+uint8_t
+WildfireHeader::GetTtl (void) const
+{
+  return m_ttl;
+}
+
+void
+WildfireHeader::SetRouteSize (uint8_t size)
+{
+  m_routeSize = size;
+}
+
+uint8_t
+WildfireHeader::GetRouteSize (void) const
+{
+  return m_routeSize;
+}
+
+void
+WildfireHeader::SetPosition (const Vector &position)
+{
+  m_x = static_cast<float> (position.x);
+  m_y = static_cast<float> (position.y);
+}
+
+Vector
+WildfireHeader::GetPosition (void) const
+{
+  return Vector (m_x, m_y, 0);
+}
+
+void
+WildfireHeader::SetHash (const uint8_t *hash, uint32_t size)
+{
+  uint32_t n = size < HASH_SIZE ? size : HASH_SIZE;
+  std::memcpy (m_hash, hash, n);
+  std::memset (m_hash + n, 0, HASH_SIZE - n);
+}
+
+const uint8_t*
+WildfireHeader::GetHash (void) const
+{
+  return m_hash;
+}
+
+} // namespace ns3
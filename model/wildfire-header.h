@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_HEADER_H
+#define WILDFIRE_HEADER_H
+
+#include "ns3/header.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/vector.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Fixed layout binary header carried by every wildfire packet
+ *
+ * The payload (alert text, server public key, ...) follows the header and is
+ * GetPayloadSize () bytes long.  The position is the ground position (x, y)
+ * of the sending node, z is not carried.  Notifications for an alert zone
+ * carry the zone and a version, a higher version supersedes the lower ones.
+ * Zone 0 is used by notifications outside any zone.  Hops counts the peer
+ * relays a packet went through.  Every relay decrements the TTL and one that
+ * brings it to zero does not forward.  Both change in flight and are not
+ * signed.  A notification may carry an evacuation route of GetRouteSize ()
+ * waypoints, (x, y) floats following the payload.
+ *
+ * Digests and pulls are unsigned peer control traffic sent every beacon, so
+ * for those types only id, origin, type and payload size go on the wire and
+ * the remaining fields read back as their defaults.
+ */
+class WildfireHeader : public Header
+{
+public:
+  static const uint32_t HASH_SIZE = 64; //!< Size of the hash field in bytes, an Ed25519 signature
+  static const uint32_t COMPACT_SIZE = 4 + 4 + 1 + 2; //!< Serialized size of a digest or pull header
+  static const uint32_t FULL_SIZE = 4 + 4 + 1 + 8 + 2 + 2 + 4 + 1 + 1 + 1 + 4 + 4 + HASH_SIZE; //!< Serialized size of any other header
+
+  WildfireHeader ();
+  virtual ~WildfireHeader ();
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  void SetId (uint32_t id);
+  uint32_t GetId (void) const;
+  void SetOrigin (uint32_t origin);
+  uint32_t GetOrigin (void) const;
+  void SetType (uint8_t type);
+  uint8_t GetType (void) const;
+  void SetExpiresAt (Time expiresAt);
+  Time GetExpiresAt (void) const;
+  void SetPayloadSize (uint16_t size);
+  uint16_t GetPayloadSize (void) const;
+  void SetZone (uint16_t zone);
+  uint16_t GetZone (void) const;
+  void SetVersion (uint32_t version);
+  uint32_t GetVersion (void) const;
+  void SetHops (uint8_t hops);
+  uint8_t GetHops (void) const;
+  void SetTtl (uint8_t ttl);
+  uint8_t GetTtl (void) const;
+  void SetRouteSize (uint8_t size);
+  uint8_t GetRouteSize (void) const;
+  void SetPosition (const Vector &position);
+  Vector GetPosition (void) const;
+
+  /**
+   * \brief Set the hash, copying at most HASH_SIZE bytes and zero filling the rest
+   */
+  void SetHash (const uint8_t *hash, uint32_t size);
+  const uint8_t* GetHash (void) const;
+
+  /**
+   * \return true if the type is serialized with the compact layout
+   */
+  bool IsCompact (void) const;
+  static bool IsCompactType (uint8_t type);
+
+  /**
+   * \brief Check a received packet before removing the header from it
+   *
+   * Deserialize trusts the length of its buffer, a truncated or foreign
+   * datagram has to be dropped before it gets there.
+   *
+   * \return true if packet starts with a whole header of the type it names
+   */
+  static bool IsComplete (Ptr<const Packet> packet);
+
+private:
+  /**
+   * \brief Reset the fields the compact layout does not carry
+   */
+  void ResetFullFields (void);
+
+  uint32_t m_id; //!< Message id
+  uint32_t m_origin; //!< Node id of the message originator
+  uint8_t m_type; //!< WildfireMessageType
+  int64_t m_expiresAt; //!< Expiry time in nanoseconds
+  uint16_t m_payloadSize; //!< Number of payload bytes following the header
+  uint16_t m_zone; //!< Alert zone, 0 for none
+  uint32_t m_version; //!< Version of the zone alert
+  uint8_t m_hops; //!< Relays so far
+  uint8_t m_ttl; //!< Relays left
+  uint8_t m_routeSize; //!< Number of route waypoints following the payload
+  float m_x; //!< Sender x position in meters
+  float m_y; //!< Sender y position in meters
+  uint8_t m_hash[HASH_SIZE]; //!< Message hash
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_HEADER_H */
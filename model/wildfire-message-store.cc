@@ -0,0 +1,276 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include <algorithm>
+#include <functional>
+#include "ns3/log.h"
+#include "wildfire-message-store.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("WildfireMessageStore");
+
+bool
+WildfireMessageStore::Expiry::operator> (const Expiry &other) const
+{
+  return expiresAt > other.expiresAt;
+}
+
+WildfireMessageStore::WildfireMessageStore ()
+  : m_capacity (32)
+{
+}
+
+void
+WildfireMessageStore::SetCapacity (uint32_t capacity)
+{
+  m_capacity = capacity;
+  while (m_messages.size () > m_capacity)
+    {
+      PruneHeap ();
+      RemoveAt (m_index[m_expiry.front ().key]);
+    }
+  m_messages.reserve (capacity);
+  m_index.reserve (capacity);
+}
+
+uint32_t
+WildfireMessageStore::GetCapacity (void) const
+{
+  return m_capacity;
+}
+
+uint32_t
+WildfireMessageStore::GetSize (void) const
+{
+  return m_messages.size ();
+}
+
+bool
+WildfireMessageStore::IsStorable (WildfireMessageType type)
+{
+  return type == WildfireMessageType::notification;
+}
+
+uint64_t
+WildfireMessageStore::MakeKey (uint32_t origin, uint32_t id)
+{
+  return (static_cast<uint64_t> (origin) << 32) | id;
+}
+
+uint64_t
+WildfireMessageStore::MakeZoneKey (uint32_t origin, uint16_t zone)
+{
+  // Node ids stay far below 2^31, so the top bit separates zone keys from (origin, id) keys
+  return (static_cast<uint64_t> (1) << 63) | (static_cast<uint64_t> (origin) << 16) | zone;
+}
+
+uint64_t
+WildfireMessageStore::MakeKey (const WildfireMessage &message)
+{
+  if (message.getZone () != 0)
+    {
+      return MakeZoneKey (message.getOrigin (), message.getZone ());
+    }
+  return MakeKey (message.getOrigin (), message.getId ());
+}
+
+const WildfireMessage*
+WildfireMessageStore::Find (uint32_t origin, uint32_t id) const
+{
+  auto itr = m_index.find (MakeKey (origin, id));
+  if (itr == m_index.end ())
+    {
+      return nullptr;
+    }
+  return &m_messages[itr->second];
+}
+
+const WildfireMessage*
+WildfireMessageStore::FindZone (uint32_t origin, uint16_t zone) const
+{
+  auto itr = m_index.find (MakeZoneKey (origin, zone));
+  if (itr == m_index.end ())
+    {
+      return nullptr;
+    }
+  return &m_messages[itr->second];
+}
+
+const WildfireMessage*
+WildfireMessageStore::Insert (WildfireMessage message)
+{
+  if (!IsStorable (message.getType ()) || m_capacity == 0)
+    {
+      return nullptr;
+    }
+
+  uint64_t key = MakeKey (message);
+  auto itr = m_index.find (key);
+  if (itr != m_index.end ())
+    {
+      if (message.getZone () != 0 && !message.supersedes (m_messages[itr->second]))
+        {
+          NS_LOG_LOGIC ("Rejecting stale version " << message.getVersion () << " of zone " << message.getZone ());
+          return nullptr;
+        }
+      // Same key replaces the stored copy, the old heap entry goes stale
+      m_messages[itr->second] = std::move (message);
+      m_expiry.push_back (Expiry {m_messages[itr->second].getExpiresAt (), key});
+      std::push_heap (m_expiry.begin (), m_expiry.end (), std::greater<Expiry> ());
+      CompactHeap ();
+      return &m_messages[itr->second];
+    }
+
+  if (m_messages.size () >= m_capacity)
+    {
+      PruneHeap ();
+      NS_LOG_LOGIC ("Store full, evicting message closest to expiry");
+      RemoveAt (m_index[m_expiry.front ().key]);
+    }
+
+  m_index[key] = m_messages.size ();
+  m_expiry.push_back (Expiry {message.getExpiresAt (), key});
+  std::push_heap (m_expiry.begin (), m_expiry.end (), std::greater<Expiry> ());
+  m_messages.push_back (std::move (message));
+  return &m_messages.back ();
+}
+
+bool
+WildfireMessageStore::Remove (uint32_t origin, uint32_t id)
+{
+  return RemoveKey (MakeKey (origin, id));
+}
+
+bool
+WildfireMessageStore::RemoveZone (uint32_t origin, uint16_t zone)
+{
+  return RemoveKey (MakeZoneKey (origin, zone));
+}
+
+bool
+WildfireMessageStore::RemoveKey (uint64_t key)
+{
+  auto itr = m_index.find (key);
+  if (itr == m_index.end ())
+    {
+      return false;
+    }
+  RemoveAt (itr->second);
+  CompactHeap ();
+  return true;
+}
+
+void
+WildfireMessageStore::RemoveAt (uint32_t index)
+{
+  // Swap with the last message to keep the storage dense
+  const WildfireMessage &removed = m_messages[index];
+  m_index.erase (MakeKey (removed));
+  if (index + 1 != m_messages.size ())
+    {
+      m_messages[index] = std::move (m_messages.back ());
+      m_index[MakeKey (m_messages[index])] = index;
+    }
+  m_messages.pop_back ();
+}
+
+void
+WildfireMessageStore::PruneHeap (void)
+{
+  // Drop heap entries whose message was removed or replaced with a new expiry
+  while (!m_expiry.empty ())
+    {
+      const Expiry &top = m_expiry.front ();
+      auto itr = m_index.find (top.key);
+      if (itr != m_index.end () && m_messages[itr->second].getExpiresAt () == top.expiresAt)
+        {
+          return;
+        }
+      std::pop_heap (m_expiry.begin (), m_expiry.end (), std::greater<Expiry> ());
+      m_expiry.pop_back ();
+    }
+}
+
+void
+WildfireMessageStore::CompactHeap (void)
+{
+  // Stale entries below the top are never pruned, so replaced and removed
+  // messages would grow the heap without bound.  Rebuild it from the live
+  // messages once stale entries outnumber them.
+  if (m_expiry.size () <= 2 * m_messages.size ())
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("Compacting " << m_expiry.size () << " heap entries for " << m_messages.size () << " messages");
+  m_expiry.clear ();
+  for (const WildfireMessage &message : m_messages)
+    {
+      m_expiry.push_back (Expiry {message.getExpiresAt (), MakeKey (message)});
+    }
+  std::make_heap (m_expiry.begin (), m_expiry.end (), std::greater<Expiry> ());
+}
+
+uint32_t
+WildfireMessageStore::GetHeapSize (void) const
+{
+  return m_expiry.size ();
+}
+
+uint32_t
+WildfireMessageStore::EvictExpired (Time now)
+{
+  uint32_t evicted = 0;
+  PruneHeap ();
+  while (!m_expiry.empty () && m_expiry.front ().expiresAt < now)
+    {
+      RemoveAt (m_index[m_expiry.front ().key]);
+      std::pop_heap (m_expiry.begin (), m_expiry.end (), std::greater<Expiry> ());
+      m_expiry.pop_back ();
+      ++evicted;
+      PruneHeap ();
+    }
+  NS_LOG_LOGIC ("Evicted " << evicted << " expired messages");
+  return evicted;
+}
+
+Time
+WildfireMessageStore::GetNextExpiry (void)
+{
+  PruneHeap ();
+  if (m_expiry.empty ())
+    {
+      return Time::Max ();
+    }
+  return m_expiry.front ().expiresAt;
+}
+
+WildfireMessageStore::Iterator
+WildfireMessageStore::Begin (void) const
+{
+  return m_messages.begin ();
+}
+
+WildfireMessageStore::Iterator
+WildfireMessageStore::End (void) const
+{
+  return m_messages.end ();
+}
+
+} // namespace ns3
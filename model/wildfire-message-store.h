@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_MESSAGE_STORE_H
+#define WILDFIRE_MESSAGE_STORE_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "wildfire-message.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Bounded store of the notifications a client is holding
+ *
+ * Messages live in a dense vector so iteration only touches live entries,
+ * with a hash index on (origin, id) for O(1) lookup and a min-heap on the
+ * expiry time for eager eviction.  When the store is full the message
+ * closest to expiry is evicted to make room.
+ *
+ * Zone alerts are keyed on (origin, zone) instead, so the store holds one
+ * version per zone and a newer version replaces the stored one.
+ */
+class WildfireMessageStore
+{
+public:
+  typedef std::vector<WildfireMessage>::const_iterator Iterator;
+
+  WildfireMessageStore ();
+
+  void SetCapacity (uint32_t capacity);
+  uint32_t GetCapacity (void) const;
+  uint32_t GetSize (void) const;
+
+  /**
+   * \brief Whether messages of this type are kept in the store
+   */
+  static bool IsStorable (WildfireMessageType type);
+
+  /**
+   * \param origin node id of the message originator
+   * \param id message id
+   * \return the stored message or nullptr
+   */
+  const WildfireMessage* Find (uint32_t origin, uint32_t id) const;
+
+  /**
+   * \param origin node id of the message originator
+   * \param zone alert zone, not 0
+   * \return the stored version of the zone alert or nullptr
+   */
+  const WildfireMessage* FindZone (uint32_t origin, uint16_t zone) const;
+
+  /**
+   * \brief Store a message, replacing any message with the same (origin, id)
+   *
+   * A zone alert replaces the stored alert of its zone if it is a newer
+   * version and is rejected otherwise.
+   *
+   * \return the stored message or nullptr if the message is not storable
+   */
+  const WildfireMessage* Insert (WildfireMessage message);
+
+  /**
+   * \brief Remove the message with the given (origin, id), zone alerts are
+   * removed with FindZone and RemoveZone
+   * \return true if a message was removed
+   */
+  bool Remove (uint32_t origin, uint32_t id);
+  bool RemoveZone (uint32_t origin, uint16_t zone);
+
+  /**
+   * \brief Remove every message that expired before now
+   * \return the number of evicted messages
+   */
+  uint32_t EvictExpired (Time now);
+
+  /**
+   * \brief Expiry time of the message closest to expiring, Time::Max () when empty
+   */
+  Time GetNextExpiry (void);
+
+  /**
+   * \brief Number of entries in the expiry heap, live and stale
+   */
+  uint32_t GetHeapSize (void) const;
+
+  Iterator Begin (void) const;
+  Iterator End (void) const;
+
+private:
+  /// Heap entry ordering messages by expiry
+  struct Expiry
+  {
+    Time expiresAt;
+    uint64_t key;
+    bool operator> (const Expiry &other) const;
+  };
+
+  static uint64_t MakeKey (uint32_t origin, uint32_t id);
+  static uint64_t MakeZoneKey (uint32_t origin, uint16_t zone);
+  static uint64_t MakeKey (const WildfireMessage &message);
+  bool RemoveKey (uint64_t key);
+  void RemoveAt (uint32_t index);
+  void PruneHeap (void);
+  void CompactHeap (void);
+
+  std::vector<WildfireMessage> m_messages; //!< Live messages
+  std::unordered_map<uint64_t, uint32_t> m_index; //!< (origin, id) or (origin, zone) to position in m_messages
+  std::vector<Expiry> m_expiry; //!< Min-heap on expiry, stale entries are skipped lazily and compacted away
+  uint32_t m_capacity; //!< Maximum number of stored messages
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_MESSAGE_STORE_H */
@@ -16,98 +16,562 @@
  * Author: Brian O'Neill <broneill@pdx.edu>
  */
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include "wildfire-message.h"
 namespace ns3
 {
 
-WildfireMessage::WildfireMessage (std::vector<uint8_t>* data)
+namespace {
+
+/// Hash carried by every message until messages are signed
+const char DEFAULT_HASH[] = "1234567890123456789012345678901234567890123456789012345678901234";
+
+/// Parse an unsigned decimal field, returns false on any non digit
+bool
+ParseUnsigned (const uint8_t *begin, const uint8_t *end, uint32_t &value)
+{
+  if (begin == end)
+    {
+      return false;
+    }
+  value = 0;
+  for (const uint8_t *c = begin; c != end; ++c)
+    {
+      if (*c < '0' || *c > '9')
+        {
+          return false;
+        }
+      value = value * 10 + (*c - '0');
+    }
+  return true;
+}
+
+/// Parse an "x,y" point of two floats, z is 0
+bool
+ParseTextPoint (const uint8_t *begin, const uint8_t *end, Vector &point)
+{
+  const uint8_t *comma = std::find (begin, end, ',');
+  float coordinates[2];
+  const uint8_t *bounds[3] = {begin, comma, end};
+  for (uint32_t c = 0; c < 2; ++c)
+    {
+      const uint8_t *from = bounds[c] + c;
+      char number[32];
+      uint32_t length = bounds[c + 1] - from;
+      if (comma == end || length == 0 || length >= sizeof (number))
+        {
+          return false;
+        }
+      std::copy (from, bounds[c + 1], number);
+      number[length] = '\0';
+      char *parsed;
+      coordinates[c] = std::strtof (number, &parsed);
+      if (parsed != number + length)
+        {
+          return false;
+        }
+    }
+  point = Vector (coordinates[0], coordinates[1], 0);
+  return true;
+}
+
+} // anonymous namespace
+
+WildfireMessage::WildfireMessage ()
+  : m_type (0),
+    m_id (0),
+    m_origin (0),
+    m_zone (0),
+    m_version (0),
+    m_hops (0),
+    m_ttl (255)
+{
+  m_hash.fill (0);
+}
+
+WildfireMessage::WildfireMessage (const uint8_t *data, uint32_t size)
+  : m_zone (0),
+    m_version (0),
+    m_hops (0),
+    m_ttl (255)
+{
+  deserialize (data, size);
+}
+
+WildfireMessage::WildfireMessage (Ptr<Packet> packet, WildfireWireFormat format)
+  : m_zone (0),
+    m_version (0),
+    m_hops (0),
+    m_ttl (255)
+{
+  if (format == WildfireWireFormat::text)
+    {
+      uint32_t size = packet->GetSize ();
+      std::vector<uint8_t> data (size);
+      packet->CopyData (data.data (), size);
+      deserialize (data.data (), size);
+      return;
+    }
+
+  WildfireHeader header;
+  packet->RemoveHeader (header);
+  deserialize (header, packet);
+}
+
+WildfireMessage::WildfireMessage (const WildfireHeader &header, Ptr<Packet> payload)
+  : m_zone (0),
+    m_version (0),
+    m_hops (0),
+    m_ttl (255)
+{
+  deserialize (header, payload);
+}
+
+void WildfireMessage::deserialize (const WildfireHeader &header, Ptr<Packet> payload)
+{
+  // Copy the payload straight from the packet buffer into the message, a
+  // route follows the payload and is copied along then cut off
+  uint32_t size = std::min<uint32_t> (header.GetPayloadSize (), payload->GetSize ());
+  uint32_t routeSize = std::min<uint32_t> (header.GetRouteSize () * WAYPOINT_SIZE, payload->GetSize () - size);
+  routeSize -= routeSize % WAYPOINT_SIZE;
+  m_message.assign (size + routeSize, '\0');
+  if (size + routeSize > 0)
+    {
+      payload->CopyData (reinterpret_cast<uint8_t*> (&m_message[0]), size + routeSize);
+    }
+  readRoute (reinterpret_cast<const uint8_t*> (m_message.data ()) + size, routeSize);
+  m_message.resize (size);
+
+  m_id = header.GetId ();
+  m_origin = header.GetOrigin ();
+  m_type = header.GetType ();
+  m_expires_at = header.GetExpiresAt ();
+  m_zone = header.GetZone ();
+  m_version = header.GetVersion ();
+  m_hops = header.GetHops ();
+  m_ttl = header.GetTtl ();
+  m_position = header.GetPosition ();
+  std::copy (header.GetHash (), header.GetHash () + WildfireHeader::HASH_SIZE, m_hash.begin ());
+}
+
+void WildfireMessage::deserialize (const uint8_t *data, uint32_t size)
 {
-  std::string s (data->begin (), data->end ());
-  size_t pos = 0;
-  std::string token;
-  std::vector<std::string> message;
-  while ((pos = s.find ('|')) != std::string::npos)
+  // id|origin|type|expires|zone|version|position|route|message|hash, the
+  // hash is always the last HASH_SIZE bytes
+  const uint32_t nFields = 8;
+  const uint8_t *end = data + size;
+  const uint8_t *fields[nFields];
+  const uint8_t *pos = data;
+  uint32_t found = 0;
+  while (found < nFields && (pos = std::find (pos, end, '|')) != end)
+    {
+      fields[found++] = pos++;
+    }
+
+  uint32_t id = 0;
+  uint32_t origin = 0;
+  uint32_t type = 0;
+  uint32_t zone = 0;
+  uint32_t version = 0;
+  bool valid = found == nFields && size > WildfireHeader::HASH_SIZE
+    && data[size - WildfireHeader::HASH_SIZE - 1] == '|'
+    && fields[nFields - 1] < end - WildfireHeader::HASH_SIZE - 1
+    && ParseUnsigned (data, fields[0], id)
+    && ParseUnsigned (fields[0] + 1, fields[1], origin)
+    && ParseUnsigned (fields[1] + 1, fields[2], type)
+    && ParseUnsigned (fields[3] + 1, fields[4], zone)
+    && ParseUnsigned (fields[4] + 1, fields[5], version)
+    && zone <= 0xffff;
+
+  // Expiry in integer nanoseconds, the signature covers it exactly
+  int64_t expires = 0;
+  if (valid)
     {
-      token = s.substr (0, pos);
-      message.push_back (token);
-      s.erase (0, pos + 1);
+      const uint8_t *begin = fields[2] + 1;
+      bool negative = begin != fields[3] && *begin == '-';
+      uint32_t digits = fields[3] - begin - negative;
+      valid = digits > 0 && digits <= 18;
+      for (const uint8_t *c = begin + negative; valid && c != fields[3]; ++c)
+        {
+          valid = *c >= '0' && *c <= '9';
+          expires = expires * 10 + (*c - '0');
+        }
+      expires = negative ? -expires : expires;
     }
-  message.push_back (s);
 
-  if(message.size () != 5)
+  Vector position;
+  valid = valid && ParseTextPoint (fields[5] + 1, fields[6], position);
+
+  m_route.clear ();
+  if (valid && fields[7] != fields[6] + 1)
     {
-      m_message = new std::string (data->begin (), data->end ());
+      valid = parseTextRoute (fields[6] + 1, fields[7]);
+    }
+
+  if (!valid)
+    {
+      m_message.assign (data, end);
       m_type = 0;
       m_id = 0;
-      m_expires_at = new Time (Simulator::Now ());
-      m_hash = new std::string ("");
+      m_origin = 0;
+      m_expires_at = Simulator::Now ();
+      m_route.clear ();
+      m_hash.fill (0);
       return;
     }
 
-  m_id = static_cast<uint32_t> (std::stoul (message[0]));
-  m_type = static_cast<uint8_t> (std::stoul (message[1]));
-  m_expires_at = new Time (message[2]);
-  m_message = new std::string (message[3]);
-  m_hash = new std::string (message[4]);
+  m_id = id;
+  m_origin = origin;
+  m_type = static_cast<uint8_t> (type);
+  m_expires_at = NanoSeconds (expires);
+  m_zone = static_cast<uint16_t> (zone);
+  m_version = version;
+  m_position = position;
+  m_message.assign (fields[nFields - 1] + 1, end - WildfireHeader::HASH_SIZE - 1);
+  std::copy (end - WildfireHeader::HASH_SIZE, end, m_hash.begin ());
 }
 
-WildfireMessage::WildfireMessage (uint32_t id, uint8_t type, Time* expires_at, std::string* message)
+bool WildfireMessage::parseTextRoute (const uint8_t *begin, const uint8_t *end)
 {
-  m_id = id;
-  m_type = type;
-  m_expires_at = new Time (*expires_at);
-  m_message = new std::string (*message);
-  m_hash = new std::string ("12345678901234567890123456789012");
+  // x,y;x,y;... with every coordinate a float written with %.9g
+  const uint8_t *pos = begin;
+  while (pos < end)
+    {
+      const uint8_t *next = std::find (pos, end, ';');
+      Vector waypoint;
+      if (!ParseTextPoint (pos, next, waypoint) || m_route.size () == MAX_ROUTE_SIZE)
+        {
+          return false;
+        }
+      m_route.push_back (waypoint);
+      if (next == end)
+        {
+          break;
+        }
+      pos = next + 1;
+    }
+  return true;
 }
 
-WildfireMessage::~WildfireMessage ()
+WildfireMessage::WildfireMessage (uint32_t id, uint8_t type, Time expires_at, std::string message)
+  : m_message (std::move (message)),
+    m_type (type),
+    m_id (id),
+    m_origin (0),
+    m_expires_at (expires_at),
+    m_zone (0),
+    m_version (0),
+    m_hops (0),
+    m_ttl (255)
 {
-  delete m_message;
-  delete m_hash;
-  delete m_expires_at;
+  std::copy (DEFAULT_HASH, DEFAULT_HASH + WildfireHeader::HASH_SIZE, m_hash.begin ());
 }
 
-uint32_t WildfireMessage::getId ()
+uint32_t WildfireMessage::getId () const
 {
   return m_id;
 }
 
-std::string* WildfireMessage::getMessage ()
+uint32_t WildfireMessage::getOrigin () const
+{
+  return m_origin;
+}
+
+void WildfireMessage::setOrigin (uint32_t origin)
+{
+  m_origin = origin;
+  m_encoded = 0;
+}
+
+uint16_t WildfireMessage::getZone () const
+{
+  return m_zone;
+}
+
+uint32_t WildfireMessage::getVersion () const
+{
+  return m_version;
+}
+
+void WildfireMessage::setZone (uint16_t zone, uint32_t version)
+{
+  m_zone = zone;
+  m_version = version;
+  m_encoded = 0;
+}
+
+bool WildfireMessage::supersedes (const WildfireMessage &other) const
+{
+  return m_zone != 0 && m_zone == other.m_zone && m_origin == other.m_origin
+         && m_version > other.m_version;
+}
+
+uint8_t WildfireMessage::getHops () const
+{
+  return m_hops;
+}
+
+uint8_t WildfireMessage::getTtl () const
+{
+  return m_ttl;
+}
+
+void WildfireMessage::setHops (uint8_t hops, uint8_t ttl)
 {
-  return new std::string (*m_message);
+  m_hops = hops;
+  m_ttl = ttl;
+  m_encoded = 0;
 }
 
-std::string* WildfireMessage::getHash ()
+void WildfireMessage::relay ()
 {
-  return new std::string (*m_hash);
+  setHops (m_hops < 255 ? m_hops + 1 : m_hops, m_ttl > 0 ? m_ttl - 1 : 0);
 }
 
-WildfireMessageType WildfireMessage::getType ()
+const Vector& WildfireMessage::getPosition () const
+{
+  return m_position;
+}
+
+void WildfireMessage::setPosition (const Vector &position)
+{
+  m_position = position;
+  m_encoded = 0;
+}
+
+const std::vector<Vector>& WildfireMessage::getRoute () const
+{
+  return m_route;
+}
+
+void WildfireMessage::setRoute (const std::vector<Vector> &route)
+{
+  NS_ASSERT_MSG (route.size () <= MAX_ROUTE_SIZE, "Route of " << route.size () << " waypoints is too long");
+  m_route = route;
+  m_encoded = 0;
+}
+
+uint32_t WildfireMessage::writeRoute (uint8_t *buffer) const
+{
+  // Ground (x, y) as big endian floats, like the header position
+  uint8_t *pos = buffer;
+  for (const Vector &waypoint : m_route)
+    {
+      float coordinates[2] = {static_cast<float> (waypoint.x), static_cast<float> (waypoint.y)};
+      for (float coordinate : coordinates)
+        {
+          uint32_t bits;
+          std::memcpy (&bits, &coordinate, sizeof (bits));
+          for (uint32_t i = 0; i < 4; ++i)
+            {
+              *pos++ = static_cast<uint8_t> (bits >> (24 - i * 8));
+            }
+        }
+    }
+  return pos - buffer;
+}
+
+void WildfireMessage::readRoute (const uint8_t *buffer, uint32_t size)
+{
+  m_route.clear ();
+  for (uint32_t offset = 0; offset + WAYPOINT_SIZE <= size; offset += WAYPOINT_SIZE)
+    {
+      float coordinates[2];
+      for (uint32_t c = 0; c < 2; ++c)
+        {
+          const uint8_t *p = buffer + offset + c * 4;
+          uint32_t bits = (static_cast<uint32_t> (p[0]) << 24) | (static_cast<uint32_t> (p[1]) << 16)
+            | (static_cast<uint32_t> (p[2]) << 8) | p[3];
+          std::memcpy (&coordinates[c], &bits, sizeof (bits));
+        }
+      m_route.push_back (Vector (coordinates[0], coordinates[1], 0));
+    }
+}
+
+const std::string& WildfireMessage::getMessage () const
+{
+  return m_message;
+}
+
+const WildfireHash& WildfireMessage::getHash () const
+{
+  return m_hash;
+}
+
+WildfireMessageType WildfireMessage::getType () const
 {
   return static_cast<WildfireMessageType> (m_type);
 }
 
-std::vector<uint8_t>* WildfireMessage::serialize ()
+Time WildfireMessage::getExpiresAt () const
 {
-  std::string myString = std::to_string (m_id) + '|' + std::to_string (m_type) + '|' + std::to_string (m_expires_at->ToDouble (Time::Unit::S)) + '|' +
-    *m_message + '|' + *m_hash;
-  return new std::vector<uint8_t> (myString.begin (), myString.end ());
+  return m_expires_at;
 }
 
-bool WildfireMessage::isValid (std::string* key)
+int WildfireMessage::writeTextFields (char *buffer, uint32_t size) const
 {
-  return true;
+  // Every signed field but the payload, then the unsigned sender position
+  // the server indexes subscribers by.  Waypoints are written with enough
+  // digits to decode to the same float the signature covers, the position
+  // with the float precision of the binary header
+  int length = std::snprintf (buffer, size, "%u|%u|%u|%lld|%u|%u|%.9g,%.9g|", m_id, m_origin,
+                              static_cast<uint32_t> (m_type),
+                              static_cast<long long> (m_expires_at.GetNanoSeconds ()),
+                              static_cast<uint32_t> (m_zone), m_version,
+                              static_cast<float> (m_position.x), static_cast<float> (m_position.y));
+  for (uint32_t i = 0; i < m_route.size () && length >= 0; ++i)
+    {
+      uint32_t offset = std::min<uint32_t> (length, size);
+      int n = std::snprintf (buffer + offset, size - offset, "%s%.9g,%.9g", i == 0 ? "" : ";",
+                             static_cast<float> (m_route[i].x), static_cast<float> (m_route[i].y));
+      length = n < 0 ? n : length + n;
+    }
+  if (length >= 0)
+    {
+      uint32_t offset = std::min<uint32_t> (length, size);
+      int n = std::snprintf (buffer + offset, size - offset, "|");
+      length = n < 0 ? n : length + n;
+    }
+  return length;
+}
+
+uint32_t WildfireMessage::getSerializedSize () const
+{
+  int length = writeTextFields (nullptr, 0);
+  return length + m_message.size () + 1 + WildfireHeader::HASH_SIZE;
+}
+
+uint32_t WildfireMessage::serialize (uint8_t *buffer, uint32_t size) const
+{
+  int length = writeTextFields (reinterpret_cast<char*> (buffer), size);
+  uint32_t total = length + m_message.size () + 1 + WildfireHeader::HASH_SIZE;
+  if (length < 0 || total > size)
+    {
+      return 0;
+    }
+
+  uint8_t *pos = std::copy (m_message.begin (), m_message.end (), buffer + length);
+  *pos++ = '|';
+  std::copy (m_hash.begin (), m_hash.end (), pos);
+  return total;
+}
+
+Ptr<Packet> WildfireMessage::toPacket (WildfireWireFormat format) const
+{
+  if (m_encoded == 0 || m_encodedFormat != format)
+    {
+      m_encoded = encode (format);
+      m_encodedFormat = format;
+    }
+  return m_encoded->Copy ();
+}
+
+Ptr<Packet> WildfireMessage::encode (WildfireWireFormat format) const
+{
+  if (format == WildfireWireFormat::text)
+    {
+      uint8_t buffer[512];
+      uint32_t size = getSerializedSize ();
+      if (size <= sizeof (buffer))
+        {
+          return Create<Packet> (buffer, serialize (buffer, sizeof (buffer)));
+        }
+      std::vector<uint8_t> large (size);
+      return Create<Packet> (large.data (), serialize (large.data (), size));
+    }
+
+  WildfireHeader header = getHeader ();
+  Ptr<Packet> p;
+  if (m_route.empty ())
+    {
+      p = Create<Packet> (reinterpret_cast<const uint8_t*> (m_message.data ()), m_message.size ());
+    }
+  else
+    {
+      std::vector<uint8_t> body (m_message.size () + m_route.size () * WAYPOINT_SIZE);
+      std::copy (m_message.begin (), m_message.end (), body.begin ());
+      writeRoute (body.data () + m_message.size ());
+      p = Create<Packet> (body.data (), body.size ());
+    }
+  p->AddHeader (header);
+  return p;
 }
 
-bool WildfireMessage::isExpired ()
+WildfireHeader WildfireMessage::getHeader () const
 {
-  return *m_expires_at < Simulator::Now ();
+  // The header length field is 16 bits, a longer payload would be cut short on the wire
+  NS_ABORT_MSG_IF (m_message.size () > MAX_PAYLOAD_SIZE,
+                   "Payload of " << m_message.size () << " bytes does not fit the binary header");
+  WildfireHeader header;
+  header.SetId (m_id);
+  header.SetOrigin (m_origin);
+  header.SetType (m_type);
+  header.SetExpiresAt (m_expires_at);
+  header.SetPayloadSize (static_cast<uint16_t> (m_message.size ()));
+  header.SetHash (m_hash.data (), m_hash.size ());
+  header.SetZone (m_zone);
+  header.SetVersion (m_version);
+  header.SetHops (m_hops);
+  header.SetTtl (m_ttl);
+  header.SetPosition (m_position);
+  header.SetRouteSize (static_cast<uint8_t> (m_route.size ()));
+  return header;
 }
 
-std::string* WildfireMessage::toString ()
+uint32_t WildfireMessage::getSignedFields (uint8_t *buffer) const
 {
-  return new std::string (std::to_string (m_id) + "," + std::to_string (m_type) + "," + std::to_string (m_expires_at->ToDouble (Time::Unit::S)) +
-                          "," + *m_message + "," + *m_hash);
+  // A forged version cannot supersede an alert and a forged route cannot
+  // redirect the evacuation
+  int64_t expires = m_expires_at.GetNanoSeconds ();
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      buffer[i] = static_cast<uint8_t> (m_id >> (24 - i * 8));
+      buffer[4 + i] = static_cast<uint8_t> (m_origin >> (24 - i * 8));
+    }
+  buffer[8] = m_type;
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      buffer[9 + i] = static_cast<uint8_t> (static_cast<uint64_t> (expires) >> (56 - i * 8));
+    }
+  buffer[17] = static_cast<uint8_t> (m_zone >> 8);
+  buffer[18] = static_cast<uint8_t> (m_zone);
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      buffer[19 + i] = static_cast<uint8_t> (m_version >> (24 - i * 8));
+    }
+  buffer[23] = static_cast<uint8_t> (m_route.size ());
+  return 24 + writeRoute (buffer + 24);
 }
 
-}
\ No newline at end of file
+void WildfireMessage::sign (const Ed25519Seed &key)
+{
+  uint8_t fields[MAX_SIGNED_FIELDS_SIZE];
+  uint32_t size = getSignedFields (fields);
+  m_hash = Ed25519Sign (key, fields, size,
+                        reinterpret_cast<const uint8_t*> (m_message.data ()), m_message.size ());
+  m_encoded = 0;
+}
+
+bool WildfireMessage::isValid (const Ed25519PublicKey &key) const
+{
+  uint8_t fields[MAX_SIGNED_FIELDS_SIZE];
+  uint32_t size = getSignedFields (fields);
+  return Ed25519Verify (key, m_hash, fields, size,
+                        reinterpret_cast<const uint8_t*> (m_message.data ()), m_message.size ());
+}
+
+bool WildfireMessage::isExpired () const
+{
+  return m_expires_at < Simulator::Now ();
+}
+
+std::string WildfireMessage::toString () const
+{
+  return std::to_string (m_id) + "," + std::to_string (m_type) + "," + std::to_string (m_expires_at.ToDouble (Time::Unit::S)) +
+         "," + m_message + "," + std::string (m_hash.begin (), m_hash.end ());
+}
+
+}
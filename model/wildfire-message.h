@@ -25,32 +25,186 @@
 #include "ns3/ipv4-address.h"
 #include "ns3/traced-callback.h"
 #include "ns3/core-module.h"
+#include "ns3/packet.h"
+#include <array>
+#include <vector>
+#include "wildfire-header.h"
+#include "wildfire-crypto.h"
 
 namespace ns3
 {
 
-enum WildfireMessageType { error, subscribe, unsubscribe, notification, acknowledgement };
+/// Digest beacons and pull requests carry a WildfireDigest as payload and are only sent between peers
+enum WildfireMessageType { error, subscribe, unsubscribe, notification, acknowledgement, digest, pull };
+
+/// Encoding used on the wire, text is the original '|' delimited format
+enum class WildfireWireFormat { binary, text };
+
+/// Fixed size hash carried by every message, an Ed25519 signature for signed messages
+typedef Ed25519Signature WildfireHash;
+
+/**
+ * \ingroup Wildfire
+ * \brief Wildfire protocol message
+ *
+ * Value type holding the fixed fields inline so messages can be moved and
+ * stored in containers without separate heap allocations, only the payload
+ * text beyond the short string buffer and an evacuation route have their
+ * own storage.  Sending again reuses the cached packet, receiving copies the
+ * payload once into the message that is stored.  The encoded
+ * packet is cached on the message, copies of the message share it until
+ * one of them is changed.
+ */
 class WildfireMessage
 {
 private:
-  std::string* m_message;
-  std::string* m_hash;
+  std::string m_message;
+  WildfireHash m_hash;
   std::uint8_t m_type;
   uint32_t m_id;
-  Time* m_expires_at;
+  uint32_t m_origin;
+  Time m_expires_at;
+  uint16_t m_zone; //!< Alert zone, 0 for none
+  uint32_t m_version; //!< Version of the zone alert
+  uint8_t m_hops; //!< Peer relays so far, not covered by the signature
+  uint8_t m_ttl; //!< Peer relays left, not covered by the signature
+  Vector m_position; //!< Sender position, not covered by the signature
+  std::vector<Vector> m_route; //!< Evacuation route waypoints, covered by the signature
+  mutable Ptr<Packet> m_encoded; //!< Encoded packet, shared by every send of this message
+  mutable WildfireWireFormat m_encodedFormat = WildfireWireFormat::binary; //!< Encoding of m_encoded
+
+  Ptr<Packet> encode (WildfireWireFormat format) const;
+  void deserialize (const uint8_t *data, uint32_t size);
+  void deserialize (const WildfireHeader &header, Ptr<Packet> payload);
+  uint32_t writeRoute (uint8_t *buffer) const;
+  void readRoute (const uint8_t *buffer, uint32_t size);
+  /**
+   * \brief Write the text fields before the payload, snprintf style
+   * \return the length the fields need, even when size is too small
+   */
+  int writeTextFields (char *buffer, uint32_t size) const;
+  bool parseTextRoute (const uint8_t *begin, const uint8_t *end);
 
 public:
-  WildfireMessage (std::vector<uint8_t>* data);
-  WildfireMessage (uint32_t id, uint8_t type, Time* expires_at, std::string* message);
-  ~WildfireMessage ();
-  uint32_t getId ();
-  std::string* getMessage ();
-  WildfireMessageType getType ();
-  std::string* getHash ();
-  std::vector<uint8_t>* serialize ();
-  bool isValid (std::string* key);
-  bool isExpired ();
-  std::string* toString ();
+  WildfireMessage ();
+  WildfireMessage (const uint8_t *data, uint32_t size);
+  WildfireMessage (Ptr<Packet> packet, WildfireWireFormat format);
+  /**
+   * \brief Build a message from an already decoded header
+   *
+   * \param header the header removed from the packet
+   * \param payload the packet holding the remaining payload bytes
+   */
+  WildfireMessage (const WildfireHeader &header, Ptr<Packet> payload);
+  WildfireMessage (uint32_t id, uint8_t type, Time expires_at, std::string message);
+  WildfireMessage (const WildfireMessage &other) = default;
+  WildfireMessage (WildfireMessage &&other) = default;
+  WildfireMessage& operator= (const WildfireMessage &other) = default;
+  WildfireMessage& operator= (WildfireMessage &&other) = default;
+
+  uint32_t getId () const;
+  uint32_t getOrigin () const;
+  void setOrigin (uint32_t origin);
+  const std::string& getMessage () const;
+  WildfireMessageType getType () const;
+  const WildfireHash& getHash () const;
+  Time getExpiresAt () const;
+  /**
+   * \brief Alert zone, 0 when the message is not a zone alert
+   *
+   * Zone and version are only carried by the binary format.
+   */
+  uint16_t getZone () const;
+  uint32_t getVersion () const;
+  void setZone (uint16_t zone, uint32_t version);
+  /**
+   * \brief Whether this zone alert replaces other, a newer version of the same zone and origin
+   */
+  bool supersedes (const WildfireMessage &other) const;
+  /**
+   * \brief Peer relays the message went through, 0 when heard from the origin
+   *
+   * Hops and TTL are only carried by the binary format, text messages can
+   * always be relayed.
+   */
+  uint8_t getHops () const;
+  /**
+   * \brief Remaining TTL, decremented by every relay like an IP TTL
+   */
+  uint8_t getTtl () const;
+  void setHops (uint8_t hops, uint8_t ttl);
+  /**
+   * \brief Turn a received message into the form a relay sends, one more
+   * hop and one less TTL
+   */
+  void relay ();
+  /**
+   * \brief Position of the sending node, only carried by the binary format
+   */
+  const Vector& getPosition () const;
+  void setPosition (const Vector &position);
+  /**
+   * \brief Evacuation route, empty when the notification carries none
+   *
+   * The route is signed, at most MAX_ROUTE_SIZE ground (x, y) waypoints.
+   */
+  const std::vector<Vector>& getRoute () const;
+  void setRoute (const std::vector<Vector> &route);
+
+  static const uint32_t MAX_PAYLOAD_SIZE = 65535; //!< Largest payload the binary header can describe
+  static const uint32_t MAX_ROUTE_SIZE = 255; //!< Waypoints a route may hold
+  static const uint32_t WAYPOINT_SIZE = 8; //!< Encoded size of a waypoint in bytes
+  static const uint32_t MAX_SIGNED_FIELDS_SIZE = 24 + MAX_ROUTE_SIZE * WAYPOINT_SIZE; //!< Largest getSignedFields () output
+
+  /**
+   * \brief Size of the text encoding written by serialize ()
+   *
+   * id|origin|type|expires|zone|version|position|route|message|hash with
+   * the expiry in nanoseconds, the sender position as x,y and the route as
+   * x,y waypoints separated by ';', so the text format carries every signed
+   * field and the position subscribers are indexed by.
+   */
+  uint32_t getSerializedSize () const;
+  /**
+   * \brief Write the text encoding into a caller provided buffer
+   *
+   * \param buffer destination buffer
+   * \param size size of the buffer
+   * \return the number of bytes written, 0 if the buffer is too small
+   */
+  uint32_t serialize (uint8_t *buffer, uint32_t size) const;
+  /**
+   * \brief Packet holding the encoded message
+   *
+   * The message is encoded on the first call and the result cached, later
+   * calls return a copy-on-write Packet::Copy () of the cached packet.
+   */
+  Ptr<Packet> toPacket (WildfireWireFormat format) const;
+  WildfireHeader getHeader () const;
+  /**
+   * \brief Write the signed fields other than the payload
+   *
+   * Id, origin, type, expiry, zone, version and route in their wire byte
+   * order, the signature covers these bytes followed by the payload.
+   *
+   * \param buffer destination of at least MAX_SIGNED_FIELDS_SIZE bytes
+   * \return the number of bytes written
+   */
+  uint32_t getSignedFields (uint8_t *buffer) const;
+  /**
+   * \brief Sign the message, storing the Ed25519 signature of its fields as the hash
+   *
+   * \param key private key of the server
+   */
+  void sign (const Ed25519Seed &key);
+  /**
+   * \brief Check the hash is an Ed25519 signature of the message fields
+   *
+   * \param key public key of the server
+   */
+  bool isValid (const Ed25519PublicKey &key) const;
+  bool isExpired () const;
+  std::string toString () const;
 };
 
 
@@ -0,0 +1,116 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include "ns3/log.h"
+#include "wildfire-mobility-engine.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("WildfireMobilityEngine");
+
+WildfireMobilityEngine::WildfireMobilityEngine ()
+{
+}
+
+uint32_t
+WildfireMobilityEngine::Add (const Vector &position)
+{
+  m_x.push_back (position.x);
+  m_y.push_back (position.y);
+  m_z.push_back (position.z);
+  m_vx.push_back (0);
+  m_vy.push_back (0);
+  m_t0.push_back (0);
+  m_segment.push_back (0);
+  return m_x.size () - 1;
+}
+
+uint32_t
+WildfireMobilityEngine::GetN (void) const
+{
+  return m_x.size ();
+}
+
+void
+WildfireMobilityEngine::SetSegment (uint32_t slot, Time start, const Vector &position,
+                                    const Vector &velocity, uint32_t segment)
+{
+  NS_ASSERT_MSG (slot < m_x.size (), "Unknown slot " << slot);
+  m_x[slot] = position.x;
+  m_y[slot] = position.y;
+  m_z[slot] = position.z;
+  m_vx[slot] = velocity.x;
+  m_vy[slot] = velocity.y;
+  m_t0[slot] = start.GetSeconds ();
+  m_segment[slot] = segment;
+}
+
+Vector
+WildfireMobilityEngine::GetPosition (uint32_t slot, Time t) const
+{
+  double elapsed = t.GetSeconds () - m_t0[slot];
+  return Vector (m_x[slot] + m_vx[slot] * elapsed, m_y[slot] + m_vy[slot] * elapsed, m_z[slot]);
+}
+
+Vector
+WildfireMobilityEngine::GetVelocity (uint32_t slot) const
+{
+  return Vector (m_vx[slot], m_vy[slot], 0);
+}
+
+uint32_t
+WildfireMobilityEngine::GetSegmentIndex (uint32_t slot) const
+{
+  return m_segment[slot];
+}
+
+void
+WildfireMobilityEngine::GetPositions (Time t, std::vector<double> &x, std::vector<double> &y) const
+{
+  uint32_t n = m_x.size ();
+  x.resize (n);
+  y.resize (n);
+  // Plain arrays and no branches so the loop vectorizes
+  double now = t.GetSeconds ();
+  const double *x0 = m_x.data ();
+  const double *y0 = m_y.data ();
+  const double *vx = m_vx.data ();
+  const double *vy = m_vy.data ();
+  const double *t0 = m_t0.data ();
+  double *xOut = x.data ();
+  double *yOut = y.data ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      double elapsed = now - t0[i];
+      xOut[i] = x0[i] + vx[i] * elapsed;
+      yOut[i] = y0[i] + vy[i] * elapsed;
+    }
+}
+
+void
+WildfireMobilityEngine::Index (Time t, WildfireGridIndex &grid)
+{
+  GetPositions (t, m_indexX, m_indexY);
+  for (uint32_t slot = 0; slot < m_indexX.size (); ++slot)
+    {
+      grid.Insert (slot, Vector (m_indexX[slot], m_indexY[slot], m_z[slot]));
+    }
+}
+
+} // namespace ns3
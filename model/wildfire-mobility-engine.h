@@ -0,0 +1,98 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_MOBILITY_ENGINE_H
+#define WILDFIRE_MOBILITY_ENGINE_H
+
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/vector.h"
+#include "wildfire-spatial-index.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Kinematic state of a whole population in structure of arrays form
+ *
+ * Every WildfireMobilityModel bound to an engine owns a slot and publishes
+ * the segment it is on at each course change.  The engine keeps the start
+ * position, velocity and start time of those segments in contiguous arrays,
+ * so the positions of every slot are evaluated in one branch free loop the
+ * compiler vectorizes.  Routes are 2D, z is constant along a segment.
+ *
+ * Positions are extrapolated along the current segments, so a query is exact
+ * from now up to the next course change of the population.  Slots are not
+ * reused.
+ */
+class WildfireMobilityEngine : public SimpleRefCount<WildfireMobilityEngine>
+{
+public:
+  WildfireMobilityEngine ();
+
+  /**
+   * \brief Add a stationary slot at position
+   * \return the slot
+   */
+  uint32_t Add (const Vector &position);
+  uint32_t GetN (void) const;
+
+  /**
+   * \brief Move slot onto a new segment
+   *
+   * \param slot slot returned by Add
+   * \param start time the segment starts
+   * \param position position at start
+   * \param velocity velocity in m/s, z is ignored
+   * \param segment index of the segment in the route of the slot
+   */
+  void SetSegment (uint32_t slot, Time start, const Vector &position, const Vector &velocity,
+                   uint32_t segment);
+
+  Vector GetPosition (uint32_t slot, Time t) const;
+  Vector GetVelocity (uint32_t slot) const;
+  uint32_t GetSegmentIndex (uint32_t slot) const;
+
+  /**
+   * \brief Ground positions of every slot at t, indexed by slot
+   */
+  void GetPositions (Time t, std::vector<double> &x, std::vector<double> &y) const;
+
+  /**
+   * \brief Insert every slot, with its slot as id, at its position at t
+   */
+  void Index (Time t, WildfireGridIndex &grid);
+
+private:
+  std::vector<double> m_x; //!< Segment start x in meters
+  std::vector<double> m_y; //!< Segment start y in meters
+  std::vector<double> m_z; //!< Height in meters
+  std::vector<double> m_vx; //!< x velocity in m/s
+  std::vector<double> m_vy; //!< y velocity in m/s
+  std::vector<double> m_t0; //!< Segment start time in seconds
+  std::vector<uint32_t> m_segment; //!< Segment index in the route of the slot
+  std::vector<double> m_indexX; //!< Scratch x positions of Index
+  std::vector<double> m_indexY; //!< Scratch y positions of Index
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_MOBILITY_ENGINE_H */
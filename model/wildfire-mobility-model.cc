@@ -1,5 +1,8 @@
+#include <algorithm>
 #include "wildfire-mobility-model.h"
 #include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/boolean.h"
 
 namespace ns3
 {
@@ -11,6 +14,16 @@ TypeId WildfireMobilityModel::GetTypeId (void) {
     .SetParent<MobilityModel>()
     .SetGroupName ("Mobility")
     .AddConstructor<WildfireMobilityModel>()
+    .AddAttribute ("StartDelay",
+                   "Time a node waits before moving on its first route",
+                   TimeValue (Seconds (5)),
+                   MakeTimeAccessor (&WildfireMobilityModel::m_startDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("PositionCache",
+                   "Answer repeated position queries at the same time from the last result",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&WildfireMobilityModel::m_positionCache),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -20,62 +33,303 @@ TypeId WildfireMobilityModel::GetInstanceTypeId () const
   return WildfireMobilityModel::GetTypeId ();
 }
 
-WildfireMobilityModel::WildfireMobilityModel () {
-  m_startTime = Time (0);
-  m_velocity = Vector (0, 0, 0);
-  m_startPosition = Vector (0, 0, 0);
-  m_destination = Vector (0, 0, 0);
+WildfireMobilityModel::WildfireMobilityModel ()
+  : m_departure (Time::Min ()),
+    m_speed (0),
+    m_speedFactor (1),
+    m_slot (0),
+    m_traceNode (0),
+    m_traceFix (0),
+    m_positionCache (true),
+    m_positionTime (Time::Min ())
+{
+  m_segments.push_back (Segment {Time (0), Vector (0, 0, 0), Vector (0, 0, 0), 0});
 }
 
 WildfireMobilityModel::~WildfireMobilityModel () {}
 
 void WildfireMobilityModel::SetDestinationVelocity (const Vector &destination, const double &velocity)
 {
-  // Note Currently 2D only
-  m_destination = destination;
-  double slope = (m_destination.y - m_startPosition.y) /
-    (m_destination.x - m_startPosition.x);
-  m_theta = atan (slope);
-  int16_t direction = m_destination.x > m_startPosition.x ? 1 : -1;
-  NS_LOG_INFO ("Destination set with slope " << slope << " and theta " << m_theta);
-  m_velocity = Vector ( sin (m_theta) * (velocity / 1000) * direction, cos (m_theta) * (velocity / 1000) * direction, 0);
+  SetRoute (std::vector<Vector> (1, destination), velocity);
+}
+
+void WildfireMobilityModel::SetRoute (const std::vector<Vector> &waypoints, double speed)
+{
+  NS_LOG_FUNCTION (this << waypoints.size () << speed);
+  NS_ASSERT_MSG (speed > 0, "Evacuation speed must be positive");
+  if (m_trace)
+    {
+      NS_LOG_INFO ("Replaying a trace, route ignored");
+      return;
+    }
+  Simulator::Cancel (m_courseChangeEvent);
+
+  // The evacuee only hesitates before leaving the first time, a reroute
+  // keeps the first departure or leaves at once
+  Time now = Simulator::Now ();
+  if (m_departure == Time::Min ())
+    {
+      m_departure = now + m_startDelay;
+    }
+  Time start = std::max (now, m_departure);
+  Vector position = DoGetPosition ();
+  m_waypoints = waypoints;
+  m_speed = speed;
+  m_segments.clear ();
+  m_segments.reserve (waypoints.size () + 2);
+  m_segments.push_back (Segment {now, position, Vector (0, 0, 0), 0});
+  BuildSegments (start, position, 0);
+  if (start == now && m_segments.size () > 1)
+    {
+      // Leaving now, the stationary segment is not needed
+      m_segments.erase (m_segments.begin ());
+    }
+  NS_LOG_INFO ("Route of " << waypoints.size () << " waypoints, arrival at " << GetArrivalTime ().As (Time::S));
+  CourseChange (0);
+}
+
+void
+WildfireMobilityModel::BuildSegments (Time start, Vector position, uint32_t first)
+{
+  // Routes are 2D, the node keeps its current height
+  double speed = m_speed * m_speedFactor;
+  uint32_t moving = 0;
+  for (uint32_t i = first; i < m_waypoints.size (); ++i)
+    {
+      Vector target (m_waypoints[i].x, m_waypoints[i].y, position.z);
+      double distance = CalculateDistance (position, target);
+      if (distance == 0)
+        {
+          continue;
+        }
+      double duration = distance / speed;
+      Vector velocity ((target.x - position.x) / duration, (target.y - position.y) / duration, 0);
+      m_segments.push_back (Segment {start, position, velocity, i});
+      start += Seconds (duration);
+      position = target;
+      ++moving;
+    }
+  // Stop at the last waypoint
+  if (moving > 0)
+    {
+      m_segments.push_back (Segment {start, position, Vector (0, 0, 0), static_cast<uint32_t> (m_waypoints.size ())});
+    }
+}
+
+void
+WildfireMobilityModel::SetSpeedFactor (double factor)
+{
+  NS_ASSERT_MSG (factor > 0 && factor <= 1, "Speed factor " << factor << " out of (0, 1]");
+  if (factor == m_speedFactor)
+    {
+      return;
+    }
+  m_speedFactor = factor;
+  const Segment &segment = GetSegment ();
+  if (segment.waypoint >= m_waypoints.size ())
+    {
+      return;
+    }
+
+  // Still waiting to leave, keep the departure time
+  Time now = Simulator::Now ();
+  Time start = now;
+  if (segment.velocity.x == 0 && segment.velocity.y == 0 && m_segments.size () > 1
+      && m_segments[1].start > now)
+    {
+      start = m_segments[1].start;
+    }
+  Vector position = DoGetPosition ();
+  uint32_t first = segment.waypoint;
+  Simulator::Cancel (m_courseChangeEvent);
+  m_segments.clear ();
+  m_segments.push_back (Segment {now, position, Vector (0, 0, 0), first});
+  BuildSegments (start, position, first);
+  if (start == now && m_segments.size () > 1)
+    {
+      // Leaving now, the stationary segment is not needed
+      m_segments.erase (m_segments.begin ());
+    }
+  CourseChange (0);
+}
 
-  // Add 5 second delay
-  m_startTime = (Simulator::Now () + Seconds (5));
+double
+WildfireMobilityModel::GetSpeedFactor (void) const
+{
+  return m_speedFactor;
+}
+
+void
+WildfireMobilityModel::SetEngine (Ptr<WildfireMobilityEngine> engine)
+{
+  NS_LOG_FUNCTION (this << engine);
+  NS_ASSERT_MSG (!m_engine, "Mobility model is already bound to an engine");
+  m_engine = engine;
+  m_slot = m_engine->Add (m_segments.front ().position);
+  const Segment &segment = GetSegment ();
+  Publish (&segment - m_segments.data ());
+}
+
+Ptr<WildfireMobilityEngine>
+WildfireMobilityModel::GetEngine (void) const
+{
+  return m_engine;
+}
+
+uint32_t
+WildfireMobilityModel::GetEngineSlot (void) const
+{
+  return m_slot;
+}
+
+void
+WildfireMobilityModel::Publish (uint32_t segment)
+{
+  m_positionTime = Time::Min ();
+  if (m_engine)
+    {
+      const Segment &s = m_segments[segment];
+      m_engine->SetSegment (m_slot, s.start, s.position, s.velocity, segment);
+    }
+}
+
+void
+WildfireMobilityModel::SetTrace (Ptr<WildfireMobilityTrace> trace, uint32_t node)
+{
+  NS_LOG_FUNCTION (this << trace << node);
+  WildfireMobilityTrace::Fix fix;
+  if (!trace->ReadFix (node, 0, fix))
+    {
+      NS_LOG_WARN ("Trace node " << node << " has no fixes, keeping the current mobility");
+      return;
+    }
+  Simulator::Cancel (m_courseChangeEvent);
+  m_trace = trace;
+  m_traceNode = node;
+  m_traceFix = 1;
+  m_nextFix = fix;
+  m_waypoints.clear ();
+
+  // Wait at the first fix
+  Time now = Simulator::Now ();
+  m_segments.clear ();
+  m_segments.push_back (Segment {now, fix.position, Vector (0, 0, 0), 0});
+  Publish (0);
+  NotifyCourseChange ();
+  m_courseChangeEvent = Simulator::Schedule (std::max (fix.time - now, Time (0)),
+                                             &WildfireMobilityModel::TraceRefill, this);
+}
+
+void
+WildfireMobilityModel::TraceRefill (void)
+{
+  // Skip the fixes already passed, the node goes on from the latest
+  Time now = Simulator::Now ();
+  Vector position = m_nextFix.position;
+  WildfireMobilityTrace::Fix fix;
+  bool more = m_trace->ReadFix (m_traceNode, m_traceFix, fix);
+  while (more && fix.time <= now)
+    {
+      position = fix.position;
+      more = m_trace->ReadFix (m_traceNode, ++m_traceFix, fix);
+    }
+
+  Vector velocity (0, 0, 0);
+  if (more)
+    {
+      double duration = (fix.time - now).GetSeconds ();
+      velocity = Vector ((fix.position.x - position.x) / duration, (fix.position.y - position.y) / duration, 0);
+      m_nextFix = fix;
+      ++m_traceFix;
+      m_courseChangeEvent = Simulator::Schedule (fix.time - now, &WildfireMobilityModel::TraceRefill, this);
+    }
+  else
+    {
+      NS_LOG_INFO ("End of trace node " << m_traceNode);
+    }
+  m_segments.clear ();
+  m_segments.push_back (Segment {now, position, velocity, 0});
+  Publish (0);
+  NotifyCourseChange ();
+}
+
+Time WildfireMobilityModel::GetArrivalTime (void) const
+{
+  return m_segments.back ().start;
+}
+
+const WildfireMobilityModel::Segment&
+WildfireMobilityModel::GetSegment (void) const
+{
+  // Last segment starting at or before now
+  Time now = Simulator::Now ();
+  auto itr = std::upper_bound (m_segments.begin (), m_segments.end (), now,
+                               [] (const Time &t, const Segment &segment) { return t < segment.start; });
+  return itr == m_segments.begin () ? *itr : *(itr - 1);
+}
+
+void
+WildfireMobilityModel::CourseChange (uint32_t segment)
+{
+  Publish (segment);
+  NotifyCourseChange ();
+  if (segment + 1 < m_segments.size ())
+    {
+      m_courseChangeEvent = Simulator::Schedule (m_segments[segment + 1].start - Simulator::Now (),
+                                                 &WildfireMobilityModel::CourseChange, this, segment + 1);
+    }
 }
 
 inline Vector WildfireMobilityModel::DoGetVelocity (void) const
 {
   NS_LOG_FUNCTION (this);
-  return m_velocity;
+  if (m_engine)
+    {
+      return m_engine->GetVelocity (m_slot);
+    }
+  return GetSegment ().velocity;
 }
 
 inline Vector
 WildfireMobilityModel::DoGetPosition (void) const
 {
-  // TODO: Stop at destination
+  // A transmission queries every receiver many times at the same time
+  Time now = Simulator::Now ();
+  if (m_positionCache && now == m_positionTime)
+    {
+      return m_position;
+    }
   NS_LOG_FUNCTION (this);
-  double elapsed_time = (Simulator::Now () - m_startTime).GetMilliSeconds ();
-  if (elapsed_time < 0)
+  if (m_engine)
     {
-      return m_startPosition;
+      m_position = m_engine->GetPosition (m_slot, now);
     }
-
-  return Vector (m_startPosition.x + m_velocity.x * elapsed_time,
-                 m_startPosition.y + m_velocity.y * elapsed_time,
-                 m_startPosition.x + m_velocity.z * elapsed_time );
+  else
+    {
+      const Segment &segment = GetSegment ();
+      double elapsed = (now - segment.start).GetSeconds ();
+      m_position = Vector (segment.position.x + segment.velocity.x * elapsed,
+                           segment.position.y + segment.velocity.y * elapsed,
+                           segment.position.z + segment.velocity.z * elapsed);
+    }
+  m_positionTime = now;
+  return m_position;
 }
 
 void
 WildfireMobilityModel::DoSetPosition (const Vector &position)
 {
   NS_LOG_FUNCTION (this << position);
-  m_velocity = DoGetVelocity ();
-  m_startTime = Simulator::Now ();
-  m_startPosition = position;
+  // Moving the node ends the route or trace
+  Simulator::Cancel (m_courseChangeEvent);
+  m_trace = 0;
+  m_waypoints.clear ();
+  m_segments.clear ();
+  m_segments.push_back (Segment {Simulator::Now (), position, Vector (0, 0, 0), 0});
+  Publish (0);
   NotifyCourseChange ();
 }
 
 
 
-}
\ No newline at end of file
+}
@@ -5,10 +5,37 @@
 #include "ns3/nstime.h"
 #include "ns3/event-id.h"
 #include "ns3/random-variable-stream.h"
+#include "wildfire-mobility-engine.h"
+#include "wildfire-mobility-trace.h"
+#include <vector>
 
 namespace ns3
 {
 
+/**
+ * \ingroup Wildfire
+ * \brief Evacuation along a route of waypoints
+ *
+ * The route is precomputed into a table of (start time, start position,
+ * velocity) segments, position queries binary search the table and do not
+ * allocate.  The node waits StartDelay after its first route, then moves at
+ * a constant speed from waypoint to waypoint and stops at the last one.
+ * Later routes, rerouting an evacuee already on the way, depart at once.  Course changes are only
+ * notified at segment boundaries.  A speed factor, set by congestion,
+ * rebuilds the rest of the route at the new speed.  The last position is
+ * cached, repeated queries at the same simulation time return it until the
+ * next course change.  The boundary event of the last segment fires at the
+ * arrival time and freezes the node at its last waypoint.
+ *
+ * Trace driven, the node replays the fixes of one node of a
+ * WildfireMobilityTrace instead, moving in a straight line from fix to fix.
+ * Only the fix it is heading for is held, the following one is read when it
+ * is reached.  Routes and speed factors are ignored while a trace plays.
+ *
+ * Bound to a WildfireMobilityEngine the model publishes each segment it
+ * enters to its engine slot and reads positions back from it, so the engine
+ * can evaluate a whole population in one batch.
+ */
 class WildfireMobilityModel : public MobilityModel
 {
 public:
@@ -27,20 +54,109 @@ public:
    */
   void SetDestinationVelocity (const Vector &destination, const double &velocity);
 
+  /**
+   * \brief Evacuate from the current position through the waypoints
+   *
+   * Only the first route waits StartDelay, a later one departs now or, while
+   * the first departure is still ahead, at that departure.  Ignored while a
+   * trace is replayed, see SetTrace.
+   *
+   * \param waypoints route, the node stops at the last waypoint
+   * \param speed speed in m/s
+   */
+  void SetRoute (const std::vector<Vector> &waypoints, double speed);
+
+  /**
+   * \return time the node reaches the last waypoint, the start of the
+   * route when it has no waypoints
+   */
+  Time GetArrivalTime (void) const;
+
+  /**
+   * \brief Scale the route speed, the rest of the route is rebuilt from the
+   * current position when the factor changes
+   *
+   * \param factor share of the route speed, in (0, 1]
+   */
+  void SetSpeedFactor (double factor);
+  double GetSpeedFactor (void) const;
+
+  /**
+   * \brief Keep the kinematic state in a slot of engine from now on, only
+   * allowed once
+   */
+  void SetEngine (Ptr<WildfireMobilityEngine> engine);
+  Ptr<WildfireMobilityEngine> GetEngine (void) const;
+
+  /**
+   * \return slot of the model in its engine
+   */
+  uint32_t GetEngineSlot (void) const;
+
+  /**
+   * \brief Replay node of trace from now on, the node waits at the first fix
+   * until its time.  Setting the position ends the replay.
+   */
+  void SetTrace (Ptr<WildfireMobilityTrace> trace, uint32_t node);
+
 private:
+  /// Straight line movement at constant velocity from start on
+  struct Segment
+  {
+    Time start; //!< Time the segment starts
+    Vector position; //!< Position at start
+    Vector velocity; //!< Velocity in m/s
+    uint32_t waypoint; //!< Waypoint the segment heads for, the route size once stopped
+  };
 
   virtual Vector DoGetPosition (void) const;
   virtual void DoSetPosition (const Vector &position);
   virtual Vector DoGetVelocity (void) const;
 
-  Time m_startTime;  //!< the start time
-  Vector m_velocity; //!< the acceleration
-  Vector m_startPosition; //!< the start position
-  Vector m_destination; //!< the destination
-  double m_theta; //!< Current Direction
+  /**
+   * \brief Segment in effect now
+   */
+  const Segment& GetSegment (void) const;
+
+  /**
+   * \brief Notify the course change of the segment starting now and
+   * schedule the next boundary
+   */
+  void CourseChange (uint32_t segment);
 
-  Time m_updatePeriod; //!< How often to update
+  /**
+   * \brief Append the segments from position through the waypoints from
+   * first on, leaving at start
+   */
+  void BuildSegments (Time start, Vector position, uint32_t first);
+
+  /**
+   * \brief Copy segment to the engine slot, if bound, and drop the cached
+   * position
+   */
+  void Publish (uint32_t segment);
+
+  /**
+   * \brief Head from the fix reached for the next fix of the trace
+   */
+  void TraceRefill (void);
 
+  std::vector<Segment> m_segments; //!< Route, sorted by start time, the last one is stationary
+  Time m_startDelay; //!< Wait before moving on the first route
+  Time m_departure; //!< Departure on the first route, Time::Min () before any route
+  std::vector<Vector> m_waypoints; //!< Route of the segments
+  double m_speed; //!< Route speed in m/s
+  double m_speedFactor; //!< Share of m_speed currently driven
+  EventId m_courseChangeEvent; //!< Next segment boundary
+  Ptr<WildfireMobilityEngine> m_engine; //!< Shared kinematic state, null when standalone
+  uint32_t m_slot; //!< Slot in m_engine
+  Ptr<WildfireMobilityTrace> m_trace; //!< Replayed trace, null when following routes
+  uint32_t m_traceNode; //!< Node of m_trace replayed
+  uint32_t m_traceFix; //!< Index of the next fix to read
+  WildfireMobilityTrace::Fix m_nextFix; //!< Fix the node is heading for
+  bool m_positionCache; //!< Whether DoGetPosition reuses m_position
+  mutable Time m_positionTime; //!< Time of m_position, Time::Min () when stale
+  mutable Vector m_position; //!< Last computed position
 };
 
 }
@@ -0,0 +1,325 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+#include "ns3/log.h"
+#include "wildfire-mobility-trace.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("WildfireMobilityTrace");
+
+const uint32_t WildfireMobilityTrace::HEADER_SIZE;
+const uint32_t WildfireMobilityTrace::INDEX_ENTRY_SIZE;
+const uint32_t WildfireMobilityTrace::FIX_SIZE;
+
+namespace {
+
+const char TRACE_MAGIC[4] = {'W', 'F', 'T', 'R'};
+const uint32_t TRACE_VERSION = 2;
+
+void
+PutU32 (uint8_t *buffer, uint32_t value)
+{
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      buffer[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+void
+PutU64 (uint8_t *buffer, uint64_t value)
+{
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      buffer[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+void
+PutDouble (uint8_t *buffer, double value)
+{
+  uint64_t bits;
+  std::memcpy (&bits, &value, sizeof (bits));
+  PutU64 (buffer, bits);
+}
+
+uint32_t
+GetU32 (const uint8_t *buffer)
+{
+  uint32_t value = 0;
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      value |= static_cast<uint32_t> (buffer[i]) << (8 * i);
+    }
+  return value;
+}
+
+uint64_t
+GetU64 (const uint8_t *buffer)
+{
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      value |= static_cast<uint64_t> (buffer[i]) << (8 * i);
+    }
+  return value;
+}
+
+double
+GetDouble (const uint8_t *buffer)
+{
+  uint64_t bits = GetU64 (buffer);
+  double value;
+  std::memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+/// One "node,time,x,y" CSV record
+bool
+ParseRecord (const std::string &line, uint32_t &id, double &time, double &x, double &y)
+{
+  std::istringstream record (line);
+  char a, b, c;
+  return static_cast<bool> (record >> id >> a >> time >> b >> x >> c >> y)
+         && a == ',' && b == ',' && c == ',';
+}
+
+bool
+IsComment (const std::string &line)
+{
+  size_t first = line.find_first_not_of (" \t\r");
+  return first == std::string::npos || line[first] == '#';
+}
+
+} // anonymous namespace
+
+WildfireMobilityTrace::WildfireMobilityTrace ()
+  : m_timeOrigin (0)
+{
+}
+
+bool
+WildfireMobilityTrace::Open (const std::string &filename)
+{
+  m_file.close ();
+  m_file.clear ();
+  m_offsets.clear ();
+  m_counts.clear ();
+  m_timeOrigin = 0;
+  m_file.open (filename.c_str (), std::ios::in | std::ios::binary);
+  uint8_t header[HEADER_SIZE];
+  if (!m_file || !m_file.read (reinterpret_cast<char *> (header), HEADER_SIZE)
+      || std::memcmp (header, TRACE_MAGIC, 4) != 0 || GetU32 (header + 4) != TRACE_VERSION)
+    {
+      NS_LOG_WARN ("Cannot read mobility trace " << filename);
+      m_file.close ();
+      return false;
+    }
+
+  uint32_t nNodes = GetU32 (header + 8);
+  m_timeOrigin = GetDouble (header + 12);
+  m_offsets.reserve (nNodes);
+  m_counts.reserve (nNodes);
+  for (uint32_t node = 0; node < nNodes; ++node)
+    {
+      uint8_t entry[INDEX_ENTRY_SIZE];
+      if (!m_file.read (reinterpret_cast<char *> (entry), INDEX_ENTRY_SIZE))
+        {
+          NS_LOG_WARN ("Truncated node table in mobility trace " << filename);
+          m_file.close ();
+          m_offsets.clear ();
+          m_counts.clear ();
+          return false;
+        }
+      m_offsets.push_back (GetU64 (entry));
+      m_counts.push_back (GetU32 (entry + 8));
+    }
+  NS_LOG_INFO ("Opened mobility trace " << filename << " of " << nNodes << " nodes");
+  return true;
+}
+
+uint32_t
+WildfireMobilityTrace::GetNNodes (void) const
+{
+  return m_counts.size ();
+}
+
+uint32_t
+WildfireMobilityTrace::GetNFixes (uint32_t node) const
+{
+  return node < m_counts.size () ? m_counts[node] : 0;
+}
+
+double
+WildfireMobilityTrace::GetTimeOrigin (void) const
+{
+  return m_timeOrigin;
+}
+
+void
+WildfireMobilityTrace::SetTimeOffset (Time offset)
+{
+  m_timeOffset = offset;
+}
+
+Time
+WildfireMobilityTrace::GetTimeOffset (void) const
+{
+  return m_timeOffset;
+}
+
+bool
+WildfireMobilityTrace::ReadFix (uint32_t node, uint32_t index, Fix &fix)
+{
+  if (index >= GetNFixes (node))
+    {
+      return false;
+    }
+  uint8_t buffer[FIX_SIZE];
+  m_file.clear ();
+  m_file.seekg (m_offsets[node] + static_cast<uint64_t> (index) * FIX_SIZE);
+  if (!m_file.read (reinterpret_cast<char *> (buffer), FIX_SIZE))
+    {
+      NS_LOG_WARN ("Cannot read fix " << index << " of trace node " << node);
+      return false;
+    }
+  fix.time = m_timeOffset + Seconds (GetDouble (buffer));
+  fix.position = Vector (GetDouble (buffer + 8), GetDouble (buffer + 16), 0);
+  return true;
+}
+
+bool
+WildfireMobilityTrace::ConvertCsv (const std::string &csvFilename, const std::string &traceFilename)
+{
+  /// Per node totals of the first pass
+  struct NodeFixes
+  {
+    uint32_t count; //!< Number of fixes
+    double last; //!< Time of the last fix, for the order check
+    uint64_t cursor; //!< File offset of the next fix written
+  };
+
+  // First pass, count the fixes of every node and check their order
+  std::ifstream csv (csvFilename.c_str ());
+  if (!csv)
+    {
+      NS_LOG_WARN ("Cannot open CSV trace " << csvFilename);
+      return false;
+    }
+  std::map<uint32_t, NodeFixes> nodes;
+  double origin = 0;
+  std::string line;
+  uint32_t lineNumber = 0;
+  bool first = true;
+  while (std::getline (csv, line))
+    {
+      ++lineNumber;
+      if (IsComment (line))
+        {
+          continue;
+        }
+      uint32_t id;
+      double time, x, y;
+      if (!ParseRecord (line, id, time, x, y))
+        {
+          if (first)
+            {
+              // Column names
+              first = false;
+              continue;
+            }
+          NS_LOG_WARN ("Malformed CSV trace record at " << csvFilename << ":" << lineNumber);
+          return false;
+        }
+      first = false;
+      auto itr = nodes.find (id);
+      if (itr == nodes.end ())
+        {
+          // The first fix of each node is its earliest
+          origin = nodes.empty () ? time : std::min (origin, time);
+          nodes[id] = NodeFixes {1, time, 0};
+        }
+      else if (time < itr->second.last)
+        {
+          NS_LOG_WARN ("Fix of node " << id << " out of time order at " << csvFilename << ":" << lineNumber);
+          return false;
+        }
+      else
+        {
+          ++itr->second.count;
+          itr->second.last = time;
+        }
+    }
+
+  // Header and node table, the fixes of each node follow in node order
+  std::ofstream trace (traceFilename.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  std::vector<uint8_t> table (HEADER_SIZE + INDEX_ENTRY_SIZE * nodes.size ());
+  std::memcpy (table.data (), TRACE_MAGIC, 4);
+  PutU32 (table.data () + 4, TRACE_VERSION);
+  PutU32 (table.data () + 8, nodes.size ());
+  PutDouble (table.data () + 12, origin);
+  uint64_t offset = table.size ();
+  uint8_t *entry = table.data () + HEADER_SIZE;
+  for (auto &node : nodes)
+    {
+      node.second.cursor = offset;
+      PutU64 (entry, offset);
+      PutU32 (entry + 8, node.second.count);
+      offset += static_cast<uint64_t> (node.second.count) * FIX_SIZE;
+      entry += INDEX_ENTRY_SIZE;
+    }
+  trace.write (reinterpret_cast<const char *> (table.data ()), table.size ());
+
+  // Second pass, write every fix at the cursor of its node
+  csv.clear ();
+  csv.seekg (0);
+  uint64_t fixes = 0;
+  while (trace && std::getline (csv, line))
+    {
+      uint32_t id;
+      double time, x, y;
+      if (IsComment (line) || !ParseRecord (line, id, time, x, y))
+        {
+          continue;
+        }
+      NodeFixes &node = nodes[id];
+      uint8_t buffer[FIX_SIZE];
+      PutDouble (buffer, time - origin);
+      PutDouble (buffer + 8, x);
+      PutDouble (buffer + 16, y);
+      trace.seekp (node.cursor);
+      trace.write (reinterpret_cast<const char *> (buffer), FIX_SIZE);
+      node.cursor += FIX_SIZE;
+      ++fixes;
+    }
+  if (!trace)
+    {
+      NS_LOG_WARN ("Cannot write mobility trace " << traceFilename);
+      return false;
+    }
+  NS_LOG_INFO ("Converted " << fixes << " fixes of " << nodes.size () << " nodes to " << traceFilename);
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_MOBILITY_TRACE_H
+#define WILDFIRE_MOBILITY_TRACE_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/vector.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Compact binary file of recorded ground positions, read on demand
+ *
+ * The file holds a 20 byte header ("WFTR", version, number of nodes, time
+ * origin), a table of (offset, number of fixes) per node and then the fixes
+ * of each node in time order, 24 bytes each (time, x and y as doubles).
+ * Times are seconds since the time origin, the CSV time of the earliest
+ * fix, so epoch stamped logs replay from the start of the simulation plus
+ * the time offset.  Positions are meters and keep full precision at UTM
+ * scale.  Every field is little endian.
+ *
+ * Only the per node table is kept in memory, fixes are read one at a time
+ * with a seek, so memory does not grow with the length of the trace.  Node
+ * i of the trace is the i-th smallest node id of the CSV it was converted
+ * from.
+ */
+class WildfireMobilityTrace : public SimpleRefCount<WildfireMobilityTrace>
+{
+public:
+  static const uint32_t HEADER_SIZE = 20; //!< Magic, version, node count and time origin
+  static const uint32_t INDEX_ENTRY_SIZE = 12; //!< Offset and fix count of a node
+  static const uint32_t FIX_SIZE = 24; //!< Time, x and y of a fix
+
+  /// Recorded position of a node
+  struct Fix
+  {
+    Time time; //!< Time of the fix
+    Vector position; //!< Ground position, z is 0
+  };
+
+  WildfireMobilityTrace ();
+
+  /**
+   * \brief Open a trace file and read its node table
+   * \return false if the file cannot be read or is not a trace
+   */
+  bool Open (const std::string &filename);
+
+  uint32_t GetNNodes (void) const;
+  uint32_t GetNFixes (uint32_t node) const;
+
+  /**
+   * \return CSV time in seconds of the earliest fix, trace time zero
+   */
+  double GetTimeOrigin (void) const;
+
+  /**
+   * \brief Set the simulation time the trace starts at, 0 by default
+   */
+  void SetTimeOffset (Time offset);
+  Time GetTimeOffset (void) const;
+
+  /**
+   * \brief Read fix index of node, its time shifted by the time offset
+   * \return false past the last fix of the node
+   */
+  bool ReadFix (uint32_t node, uint32_t index, Fix &fix);
+
+  /**
+   * \brief Convert "node,time,x,y" CSV records to a trace file
+   *
+   * Two passes over the CSV keep memory proportional to the number of
+   * nodes.  Fixes of a node must be in time order, nodes may interleave.
+   * Blank lines, '#' comments and a header line are skipped.  Times are
+   * written relative to the earliest fix of any node.
+   *
+   * \return false on a malformed or unordered record or an I/O error
+   */
+  static bool ConvertCsv (const std::string &csvFilename, const std::string &traceFilename);
+
+private:
+  std::ifstream m_file; //!< Open trace file
+  std::vector<uint64_t> m_offsets; //!< File offset of the first fix of each node
+  std::vector<uint32_t> m_counts; //!< Number of fixes of each node
+  double m_timeOrigin; //!< CSV time of trace time zero in seconds
+  Time m_timeOffset; //!< Simulation time of trace time zero
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_MOBILITY_TRACE_H */
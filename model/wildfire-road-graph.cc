@@ -0,0 +1,421 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <sstream>
+
+#include "ns3/log.h"
+#include "wildfire-road-graph.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("WildfireRoadGraph");
+
+const uint32_t WildfireRoadGraph::NONE;
+
+namespace {
+
+/// (distance, intersection) entry of the Dijkstra and A* queues
+typedef std::pair<double, uint32_t> QueueEntry;
+typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > MinQueue;
+
+} // anonymous namespace
+
+WildfireRoadGraph::WildfireRoadGraph ()
+  : m_built (true),
+    m_hits (0),
+    m_misses (0)
+{
+  m_offsets.push_back (0);
+}
+
+void
+WildfireRoadGraph::Clear (void)
+{
+  m_positions.clear ();
+  m_edges.clear ();
+  m_offsets.assign (1, 0);
+  m_targets.clear ();
+  m_lengths.clear ();
+  m_built = true;
+  m_grid.Clear ();
+  m_shelters.clear ();
+  m_next.clear ();
+  m_shelterOf.clear ();
+  m_routes.clear ();
+}
+
+bool
+WildfireRoadGraph::Load (const std::string &filename)
+{
+  std::ifstream file (filename.c_str ());
+  if (!file)
+    {
+      NS_LOG_WARN ("Cannot open road graph " << filename);
+      return false;
+    }
+  Clear ();
+
+  std::unordered_map<uint32_t, uint32_t> ids;
+  std::vector<uint32_t> shelters;
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline (file, line))
+    {
+      ++lineNumber;
+      std::istringstream record (line);
+      std::string kind;
+      if (!(record >> kind) || kind[0] == '#')
+        {
+          continue;
+        }
+      uint32_t id;
+      bool valid = static_cast<bool> (record >> id);
+      if (valid && kind == "n")
+        {
+          double x, y;
+          valid = static_cast<bool> (record >> x >> y) && ids.find (id) == ids.end ();
+          if (valid)
+            {
+              ids[id] = AddNode (Vector (x, y, 0));
+            }
+        }
+      else if (valid && kind == "e")
+        {
+          uint32_t to;
+          double length = -1;
+          valid = static_cast<bool> (record >> to);
+          record >> length;
+          auto a = ids.find (id);
+          auto b = ids.find (to);
+          valid = valid && a != ids.end () && b != ids.end ();
+          if (valid)
+            {
+              AddEdge (a->second, b->second, length);
+            }
+        }
+      else if (valid && kind == "s")
+        {
+          auto a = ids.find (id);
+          valid = a != ids.end ();
+          if (valid)
+            {
+              shelters.push_back (a->second);
+            }
+        }
+      else
+        {
+          valid = false;
+        }
+      if (!valid)
+        {
+          NS_LOG_WARN ("Malformed road graph record at " << filename << ":" << lineNumber);
+          Clear ();
+          return false;
+        }
+    }
+
+  Build ();
+  if (!shelters.empty ())
+    {
+      SetShelters (shelters);
+    }
+  NS_LOG_INFO ("Loaded " << GetNNodes () << " intersections and " << GetNEdges () << " roads from " << filename);
+  return true;
+}
+
+uint32_t
+WildfireRoadGraph::AddNode (const Vector &position)
+{
+  uint32_t node = m_positions.size ();
+  m_positions.push_back (position);
+  m_grid.Insert (node, position);
+  m_built = false;
+  return node;
+}
+
+void
+WildfireRoadGraph::AddEdge (uint32_t from, uint32_t to, double length)
+{
+  NS_ASSERT (from < m_positions.size () && to < m_positions.size ());
+  if (length < 0)
+    {
+      length = CalculateDistance (m_positions[from], m_positions[to]);
+    }
+  m_edges.push_back (Edge {from, to, length});
+  m_built = false;
+}
+
+void
+WildfireRoadGraph::Build (void)
+{
+  if (m_built)
+    {
+      return;
+    }
+  // Keep the roads already in the CSR arrays and add the new ones
+  uint32_t nNodes = m_positions.size ();
+  for (uint32_t node = 0; node + 1 < m_offsets.size (); ++node)
+    {
+      for (uint32_t i = m_offsets[node]; i < m_offsets[node + 1]; ++i)
+        {
+          if (node < m_targets[i])
+            {
+              m_edges.push_back (Edge {node, m_targets[i], m_lengths[i]});
+            }
+        }
+    }
+
+  // Counting sort of both directions of every road by source
+  m_offsets.assign (nNodes + 1, 0);
+  for (const Edge &edge : m_edges)
+    {
+      ++m_offsets[edge.from + 1];
+      ++m_offsets[edge.to + 1];
+    }
+  for (uint32_t node = 0; node < nNodes; ++node)
+    {
+      m_offsets[node + 1] += m_offsets[node];
+    }
+  m_targets.resize (m_offsets[nNodes]);
+  m_lengths.resize (m_offsets[nNodes]);
+  std::vector<uint32_t> fill (m_offsets.begin (), m_offsets.end () - 1);
+  for (const Edge &edge : m_edges)
+    {
+      m_targets[fill[edge.from]] = edge.to;
+      m_lengths[fill[edge.from]++] = edge.length;
+      m_targets[fill[edge.to]] = edge.from;
+      m_lengths[fill[edge.to]++] = edge.length;
+    }
+  m_edges.clear ();
+  m_edges.shrink_to_fit ();
+  m_built = true;
+
+  // Routes depend on the graph
+  if (!m_shelters.empty ())
+    {
+      std::vector<uint32_t> shelters;
+      shelters.swap (m_shelters);
+      SetShelters (shelters);
+    }
+}
+
+uint32_t
+WildfireRoadGraph::GetNNodes (void) const
+{
+  return m_positions.size ();
+}
+
+uint32_t
+WildfireRoadGraph::GetNEdges (void) const
+{
+  return m_targets.size () / 2 + m_edges.size ();
+}
+
+const Vector&
+WildfireRoadGraph::GetPosition (uint32_t node) const
+{
+  return m_positions[node];
+}
+
+uint32_t
+WildfireRoadGraph::FindNearestNode (const Vector &position)
+{
+  if (m_positions.empty ())
+    {
+      return NONE;
+    }
+  // Grow a circle until it holds an intersection, the closest one is then
+  // inside it
+  Vector ground (position.x, position.y, 0);
+  for (double radius = 100; ; radius *= 2)
+    {
+      m_nearby.clear ();
+      m_grid.Query (WildfireTargetArea::Circle (ground, radius), m_nearby);
+      if (!m_nearby.empty ())
+        {
+          break;
+        }
+    }
+  uint32_t nearest = NONE;
+  double best = std::numeric_limits<double>::max ();
+  for (uint32_t node : m_nearby)
+    {
+      double distance = CalculateDistance (ground, Vector (m_positions[node].x, m_positions[node].y, 0));
+      if (distance < best)
+        {
+          best = distance;
+          nearest = node;
+        }
+    }
+  return nearest;
+}
+
+void
+WildfireRoadGraph::SetShelters (const std::vector<uint32_t> &shelters)
+{
+  Build ();
+  m_shelters = shelters;
+  m_routes.clear ();
+
+  // Roads are two way, so the search from every shelter at once gives each
+  // intersection its distance to the nearest shelter and the next hop on
+  // the way there
+  uint32_t nNodes = m_positions.size ();
+  std::vector<double> distance (nNodes, std::numeric_limits<double>::max ());
+  m_next.assign (nNodes, NONE);
+  m_shelterOf.assign (nNodes, NONE);
+  MinQueue queue;
+  for (uint32_t shelter : m_shelters)
+    {
+      NS_ASSERT (shelter < nNodes);
+      distance[shelter] = 0;
+      m_shelterOf[shelter] = shelter;
+      queue.push (QueueEntry (0, shelter));
+    }
+  while (!queue.empty ())
+    {
+      QueueEntry top = queue.top ();
+      queue.pop ();
+      uint32_t node = top.second;
+      if (top.first > distance[node])
+        {
+          continue;
+        }
+      for (uint32_t i = m_offsets[node]; i < m_offsets[node + 1]; ++i)
+        {
+          uint32_t neighbour = m_targets[i];
+          double candidate = top.first + m_lengths[i];
+          if (candidate < distance[neighbour])
+            {
+              distance[neighbour] = candidate;
+              m_next[neighbour] = node;
+              m_shelterOf[neighbour] = m_shelterOf[node];
+              queue.push (QueueEntry (candidate, neighbour));
+            }
+        }
+    }
+}
+
+uint32_t
+WildfireRoadGraph::GetShelter (uint32_t node) const
+{
+  return node < m_shelterOf.size () ? m_shelterOf[node] : NONE;
+}
+
+std::shared_ptr<const std::vector<Vector> >
+WildfireRoadGraph::GetEvacuationRoute (const Vector &position)
+{
+  Build ();
+  uint32_t start = FindNearestNode (position);
+  auto itr = m_routes.find (start);
+  if (itr != m_routes.end ())
+    {
+      ++m_hits;
+      return itr->second;
+    }
+  ++m_misses;
+
+  std::shared_ptr<std::vector<Vector> > route = std::make_shared<std::vector<Vector> > ();
+  if (GetShelter (start) != NONE)
+    {
+      for (uint32_t node = start; node != NONE; node = m_next[node])
+        {
+          route->push_back (m_positions[node]);
+        }
+    }
+  m_routes[start] = route;
+  return route;
+}
+
+std::vector<uint32_t>
+WildfireRoadGraph::FindPath (uint32_t from, uint32_t to)
+{
+  Build ();
+  uint32_t nNodes = m_positions.size ();
+  std::vector<double> distance (nNodes, std::numeric_limits<double>::max ());
+  std::vector<uint32_t> previous (nNodes, NONE);
+  std::vector<uint32_t> path;
+  if (from >= nNodes || to >= nNodes)
+    {
+      return path;
+    }
+
+  // The straight line distance never overestimates a road distance and is
+  // consistent, so an intersection is final once taken off the queue
+  const Vector &goal = m_positions[to];
+  std::vector<bool> closed (nNodes, false);
+  MinQueue queue;
+  distance[from] = 0;
+  queue.push (QueueEntry (CalculateDistance (m_positions[from], goal), from));
+  while (!queue.empty ())
+    {
+      uint32_t node = queue.top ().second;
+      queue.pop ();
+      if (node == to)
+        {
+          break;
+        }
+      if (closed[node])
+        {
+          continue;
+        }
+      closed[node] = true;
+      for (uint32_t i = m_offsets[node]; i < m_offsets[node + 1]; ++i)
+        {
+          uint32_t neighbour = m_targets[i];
+          double candidate = distance[node] + m_lengths[i];
+          if (candidate < distance[neighbour])
+            {
+              distance[neighbour] = candidate;
+              previous[neighbour] = node;
+              queue.push (QueueEntry (candidate + CalculateDistance (m_positions[neighbour], goal), neighbour));
+            }
+        }
+    }
+
+  if (from != to && previous[to] == NONE)
+    {
+      return path;
+    }
+  for (uint32_t node = to; node != NONE; node = previous[node])
+    {
+      path.push_back (node);
+    }
+  std::reverse (path.begin (), path.end ());
+  return path;
+}
+
+uint64_t
+WildfireRoadGraph::GetCacheHits (void) const
+{
+  return m_hits;
+}
+
+uint64_t
+WildfireRoadGraph::GetCacheMisses (void) const
+{
+  return m_misses;
+}
+
+} // namespace ns3
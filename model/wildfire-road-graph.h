@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_ROAD_GRAPH_H
+#define WILDFIRE_ROAD_GRAPH_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ns3/simple-ref-count.h"
+#include "ns3/vector.h"
+#include "wildfire-spatial-index.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Road network for evacuation routing
+ *
+ * Intersections and undirected road segments kept in compressed sparse row
+ * form.  Once the shelters are set a single multi-source Dijkstra search
+ * gives every intersection the next hop towards its nearest shelter, so an
+ * evacuation route is read off the tree without a search per evacuee.
+ * Routes are cached per starting intersection and shared by every node
+ * leaving from it.
+ *
+ * The edge list file has one record per line, blank lines and lines
+ * starting with '#' are skipped:
+ *
+ * \verbatim
+   n <id> <x> <y>
+   e <from id> <to id> [length]
+   s <id>
+   \endverbatim
+ *
+ * Ids are arbitrary unsigned integers, an edge without a length uses the
+ * straight line distance and 's' marks a shelter.
+ */
+class WildfireRoadGraph : public SimpleRefCount<WildfireRoadGraph>
+{
+public:
+  /// Returned by the lookups when there is no intersection or no route
+  static const uint32_t NONE = 0xffffffff;
+
+  WildfireRoadGraph ();
+
+  /**
+   * \brief Replace the graph with the one in filename
+   * \return false if the file cannot be read or is malformed
+   */
+  bool Load (const std::string &filename);
+
+  /**
+   * \return index of the new intersection
+   */
+  uint32_t AddNode (const Vector &position);
+
+  /**
+   * \brief Add a two way road, length < 0 uses the straight line distance
+   */
+  void AddEdge (uint32_t from, uint32_t to, double length = -1);
+
+  /**
+   * \brief Build the adjacency arrays, called by Load and by the queries when needed
+   */
+  void Build (void);
+
+  uint32_t GetNNodes (void) const;
+  uint32_t GetNEdges (void) const;
+  const Vector& GetPosition (uint32_t node) const;
+
+  /**
+   * \return the intersection closest to position, NONE for an empty graph
+   */
+  uint32_t FindNearestNode (const Vector &position);
+
+  /**
+   * \brief Set the shelters and compute the next hop towards the nearest
+   * one for every intersection
+   */
+  void SetShelters (const std::vector<uint32_t> &shelters);
+
+  /**
+   * \return the nearest shelter reachable from node, NONE if none is
+   */
+  uint32_t GetShelter (uint32_t node) const;
+
+  /**
+   * \brief Waypoints from the intersection closest to position to its nearest shelter
+   *
+   * The route is cached, evacuees starting from the same intersection share
+   * it.  Empty when no shelter can be reached.
+   */
+  std::shared_ptr<const std::vector<Vector> > GetEvacuationRoute (const Vector &position);
+
+  /**
+   * \brief Shortest path between two intersections with A*
+   *
+   * The straight line distance is the heuristic, so road lengths must not
+   * be shorter than it.
+   *
+   * \return the intersections of the path, empty if to cannot be reached
+   */
+  std::vector<uint32_t> FindPath (uint32_t from, uint32_t to);
+
+  uint64_t GetCacheHits (void) const;
+  uint64_t GetCacheMisses (void) const;
+
+private:
+  /// Road segment before Build
+  struct Edge
+  {
+    uint32_t from; //!< First intersection
+    uint32_t to; //!< Second intersection
+    double length; //!< Length in meters
+  };
+
+  void Clear (void);
+
+  std::vector<Vector> m_positions; //!< Intersection positions
+  std::vector<Edge> m_edges; //!< Roads added since the last Build
+  std::vector<uint32_t> m_offsets; //!< First adjacency of every intersection, CSR
+  std::vector<uint32_t> m_targets; //!< Adjacent intersections, CSR
+  std::vector<double> m_lengths; //!< Road lengths, CSR
+  bool m_built; //!< Whether the CSR arrays are up to date
+  WildfireGridIndex m_grid; //!< Intersections by position
+  std::vector<uint32_t> m_shelters; //!< Shelter intersections
+  std::vector<uint32_t> m_next; //!< Next hop towards the nearest shelter
+  std::vector<uint32_t> m_shelterOf; //!< Nearest shelter of every intersection
+  std::unordered_map<uint32_t, std::shared_ptr<const std::vector<Vector> > > m_routes; //!< Routes by start
+  std::vector<uint32_t> m_nearby; //!< Query buffer of FindNearestNode
+  uint64_t m_hits; //!< Route cache hits
+  uint64_t m_misses; //!< Route cache misses
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_ROAD_GRAPH_H */
@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include <cstring>
+#include "wildfire-seen-filter.h"
+
+namespace ns3
+{
+
+WildfireSeenFilter::WildfireSeenFilter ()
+  : m_aging (Seconds (30)),
+    m_rotated (Time (0))
+{
+}
+
+void
+WildfireSeenFilter::SetAging (Time aging)
+{
+  m_aging = aging;
+}
+
+uint64_t
+WildfireSeenFilter::MakeKey (const WildfireHeader &header)
+{
+  // Fold the leading hash bytes with origin and id, a different hash for the
+  // same (origin, id) is a different message
+  uint64_t prefix;
+  std::memcpy (&prefix, header.GetHash (), sizeof (prefix));
+  uint64_t key = (static_cast<uint64_t> (header.GetOrigin ()) << 32) | header.GetId ();
+  return prefix ^ (key * 0x9e3779b97f4a7c15ULL);
+}
+
+void
+WildfireSeenFilter::Age (Time now)
+{
+  if (now - m_rotated < m_aging)
+    {
+      return;
+    }
+  if (now - m_rotated >= m_aging + m_aging)
+    {
+      m_previous.clear ();
+    }
+  else
+    {
+      m_previous.swap (m_current);
+    }
+  m_current.clear ();
+  m_rotated = now;
+}
+
+bool
+WildfireSeenFilter::Contains (const WildfireHeader &header, Time now)
+{
+  Age (now);
+  uint64_t key = MakeKey (header);
+  return m_current.count (key) != 0 || m_previous.count (key) != 0;
+}
+
+void
+WildfireSeenFilter::Add (const WildfireHeader &header, Time now)
+{
+  Age (now);
+  m_current.insert (MakeKey (header));
+}
+
+} // namespace ns3
@@ -0,0 +1,68 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_SEEN_FILTER_H
+#define WILDFIRE_SEEN_FILTER_H
+
+#include <unordered_set>
+
+#include "ns3/nstime.h"
+#include "wildfire-header.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Set of recently seen (origin, id, hash) triples
+ *
+ * Checked from the fixed header alone so duplicates can be dropped before
+ * any payload work.  Entries age out in two generations: the current set is
+ * moved to the previous set every aging interval, so an entry is remembered
+ * for between one and two intervals.
+ */
+class WildfireSeenFilter
+{
+public:
+  WildfireSeenFilter ();
+
+  void SetAging (Time aging);
+
+  /**
+   * \brief Whether the message described by header has been seen
+   */
+  bool Contains (const WildfireHeader &header, Time now);
+
+  /**
+   * \brief Remember the message described by header
+   */
+  void Add (const WildfireHeader &header, Time now);
+
+private:
+  static uint64_t MakeKey (const WildfireHeader &header);
+  void Age (Time now);
+
+  std::unordered_set<uint64_t> m_current; //!< Entries seen this generation
+  std::unordered_set<uint64_t> m_previous; //!< Entries seen last generation
+  Time m_aging; //!< Generation length
+  Time m_rotated; //!< Start of the current generation
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_SEEN_FILTER_H */
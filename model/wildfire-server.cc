@@ -25,6 +25,9 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
+#include "ns3/double.h"
 #include <vector>
 
 #include "wildfire-server.h"
@@ -38,16 +41,12 @@ NS_OBJECT_ENSURE_REGISTERED (WildfireServer);
 WildfireServer::WildfireServer ()
 {
   NS_LOG_FUNCTION (this);
-  m_privateKey = new std::string ("PRIVATEKEY");
-  m_publicKey = new std::string ("PUBLICKEY");
 }
 
 WildfireServer::~WildfireServer ()
 {
   NS_LOG_FUNCTION (this);
   m_socket = 0;
-  delete m_privateKey;
-  delete m_publicKey;
 }
 
 TypeId
@@ -61,6 +60,57 @@ WildfireServer::GetTypeId ()
                    UintegerValue (9),
                    MakeUintegerAccessor (&WildfireServer::m_port),
                    MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("Key",
+                   "Secret the Ed25519 key pair signing notifications is derived from. Only the public key is sent, in the subscription ack",
+                   StringValue ("wildfire-notification-key"),
+                   MakeStringAccessor (&WildfireServer::SetKey, &WildfireServer::GetKey),
+                   MakeStringChecker ())
+    .AddAttribute ("MaxSubscribeRate",
+                   "Subscription requests accepted per second, others are refused with a retry-after hint. 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&WildfireServer::m_maxSubscribeRate),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SubscriptionLease",
+                   "How long a subscription lasts without renewal, sent to the client as the ack expiry",
+                   TimeValue (Hours (1)),
+                   MakeTimeAccessor (&WildfireServer::m_subscriptionLease),
+                   MakeTimeChecker ())
+    .AddAttribute ("FanoutBatchSize",
+                   "Packets sent per fan-out batch, 0 sends every queued packet at once",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&WildfireServer::m_fanoutBatchSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FanoutInterval",
+                   "Time between fan-out batches, together with FanoutBatchSize the server egress rate",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&WildfireServer::m_fanoutInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("SpatialCellSize",
+                   "Edge length in meters of the grid cells indexing subscriber positions",
+                   DoubleValue (500),
+                   MakeDoubleAccessor (&WildfireServer::m_spatialCellSize),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("RetransmitTimeout",
+                   "Time to wait for acks after a notification fan-out before retransmitting to the unacked subscribers",
+                   TimeValue (Seconds (2)),
+                   MakeTimeAccessor (&WildfireServer::m_retransmitTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxRetransmissions",
+                   "Maximum retransmission rounds per notification",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&WildfireServer::m_maxRetransmissions),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Ttl",
+                   "Number of peer relays a notification may take",
+                   UintegerValue (255),
+                   MakeUintegerAccessor (&WildfireServer::m_ttl),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("WireFormat",
+                   "Encoding used for wildfire messages, Text is the legacy '|' delimited format",
+                   EnumValue (static_cast<int> (WildfireWireFormat::binary)),
+                   MakeEnumAccessor (&WildfireServer::SetWireFormat, &WildfireServer::GetWireFormat),
+                   MakeEnumChecker (static_cast<int> (WildfireWireFormat::binary), "Binary",
+                                    static_cast<int> (WildfireWireFormat::text), "Text"))
     .AddTraceSource ("Rx", "A packet has been received",
                      MakeTraceSourceAccessor (&WildfireServer::m_rxTrace),
                      "ns3::Packet::TracedCallback")
@@ -73,9 +123,27 @@ WildfireServer::GetTypeId ()
     .AddTraceSource ("Ack", "An Ack packet has been received",
                      MakeTraceSourceAccessor (&WildfireServer::m_ackTrace),
                      "")
-    .AddTraceSource ("Sub", "A Subscription packet has been received",
+    .AddTraceSource ("Sub", "A new subscriber has been added",
                      MakeTraceSourceAccessor (&WildfireServer::m_subTrace),
                      "")
+    .AddTraceSource ("Unsub", "A subscriber has unsubscribed",
+                     MakeTraceSourceAccessor (&WildfireServer::m_unsubTrace),
+                     "")
+    .AddTraceSource ("SubRefused", "A Subscription packet was refused by admission control",
+                     MakeTraceSourceAccessor (&WildfireServer::m_subRefusedTrace),
+                     "")
+    .AddTraceSource ("FanoutQueueDepth", "Packets waiting in the fan-out queues after a batch",
+                     MakeTraceSourceAccessor (&WildfireServer::m_fanoutQueueDepthTrace),
+                     "")
+    .AddTraceSource ("FanoutComplete", "A notification reached the last subscriber, with the time since it was queued",
+                     MakeTraceSourceAccessor (&WildfireServer::m_fanoutCompleteTrace),
+                     "ns3::Time::TracedCallback")
+    .AddTraceSource ("DeliveryRatio", "An ack changed the delivery ratio of a notification, with its id and ratio",
+                     MakeTraceSourceAccessor (&WildfireServer::m_deliveryRatioTrace),
+                     "")
+    .AddTraceSource ("Retransmit", "A notification was retransmitted, with its id and the number of unacked subscribers",
+                     MakeTraceSourceAccessor (&WildfireServer::m_retransmitTrace),
+                     "")
   ;
   return tid;
 }
@@ -92,6 +160,10 @@ WildfireServer::StartApplication ()
 {
   NS_LOG_FUNCTION (this);
 
+  m_subscribers.SetCellSize (m_spatialCellSize);
+  // A freed slot is reused by the next subscriber, which must not inherit
+  // the delivery state of the one that left
+  m_subscribers.SetReleaseCallback (MakeCallback (&WildfireDeliveryLedger::ReleaseSlot, &m_ledger));
   if (m_socket == 0)
     {
       TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
@@ -116,32 +188,259 @@ WildfireServer::StopApplication ()
       m_socket->Close ();
       m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
     }
+  Simulator::Cancel (m_fanoutEvent);
+  for (uint32_t priority = 0; priority < N_PRIORITIES; ++priority)
+    {
+      m_fanoutQueues[priority].clear ();
+    }
+  m_fanoutPending = 0;
+  m_ledger.Clear ();
+  m_zoneVersions.clear ();
+  m_subscribers.Clear ();
+}
+
+void
+WildfireServer::ScheduleNotification (Time dt, FanoutPriority priority)
+{
+  NS_LOG_FUNCTION (this << dt << priority);
+  m_sendEvent = Simulator::Schedule (dt, &WildfireServer::DoSendNotification, this, WildfireTargetArea (), priority, 0, 2,
+                                     std::vector<Vector> ());
+}
+
+void
+WildfireServer::ScheduleNotification (Time dt, const WildfireTargetArea &area, FanoutPriority priority)
+{
+  NS_LOG_FUNCTION (this << dt << priority);
+  m_sendEvent = Simulator::Schedule (dt, &WildfireServer::DoSendNotification, this, area, priority, 0, 2,
+                                     std::vector<Vector> ());
+}
+
+void
+WildfireServer::SendNotification (FanoutPriority priority)
+{
+  DoSendNotification (WildfireTargetArea (), priority, 0, 2, std::vector<Vector> ());
+}
+
+void
+WildfireServer::SendNotification (const WildfireTargetArea &area, FanoutPriority priority)
+{
+  DoSendNotification (area, priority, 0, 2, std::vector<Vector> ());
+}
+
+void
+WildfireServer::ScheduleLevelChange (Time dt, uint16_t zone, uint8_t level, const WildfireTargetArea &area,
+                                     const std::vector<Vector> &route)
+{
+  NS_LOG_FUNCTION (this << dt << zone << static_cast<uint32_t> (level));
+  NS_ASSERT_MSG (zone != 0, "Zone 0 is reserved for notifications outside any zone");
+  Simulator::Schedule (dt, &WildfireServer::DoSendNotification, this, area, ALERT, zone, level, route);
+}
+
+void
+WildfireServer::ScheduleTimeline (const std::vector<WildfireLevelChange> &timeline)
+{
+  for (const WildfireLevelChange &change : timeline)
+    {
+      ScheduleLevelChange (change.at, change.zone, change.level, change.area, change.route);
+    }
 }
 
 void
-WildfireServer::ScheduleNotification (Time dt)
+WildfireServer::SetEvacuationRoute (const std::vector<Vector> &route)
 {
-  NS_LOG_FUNCTION (this << dt);
-  m_sendEvent = Simulator::Schedule (dt, &WildfireServer::SendNotification, this);
+  m_route = route;
 }
 
 void
-WildfireServer::SendNotification ()
+WildfireServer::DoSendNotification (WildfireTargetArea area, FanoutPriority priority, uint16_t zone, uint8_t level,
+                                    std::vector<Vector> route)
 {
-  Ptr<Packet> p;
-  std::string message = std::string ("Level 2 Alert");
   Time expires_at = Simulator::Now () + Seconds (30);
-  WildfireMessage alert = WildfireMessage (id, WildfireMessageType::notification, &expires_at, &message);
+  WildfireMessage alert = WildfireMessage (id, WildfireMessageType::notification, expires_at,
+                                           "Level " + std::to_string (level) + " Alert");
+  alert.setOrigin (GetNode ()->GetId ());
+  alert.setHops (0, m_ttl);
+  alert.setRoute (route.empty () ? m_route : route);
+  if (zone != 0)
+    {
+      alert.setZone (zone, ++m_zoneVersions[zone]);
+      NS_LOG_INFO ("Zone " << zone << " now at level " << static_cast<uint32_t> (level)
+                           << ", version " << alert.getVersion ());
+    }
+  alert.sign (m_privateKey);
   id++;
-  for (auto subscriber = subscribers.begin (); subscriber != subscribers.end (); ++subscriber)
+  m_subscribers.EvictExpired (Simulator::Now ());
+
+  FanoutJob job;
+  job.message = std::make_shared<const WildfireMessage> (std::move (alert));
+  m_ledger.Open (job.message);
+  job.toSubscribers = true;
+  job.targeted = !area.IsEverywhere ();
+  job.nextSlot = 0;
+  job.remaining = m_subscribers.GetSize ();
+  if (job.targeted)
+    {
+      m_subscribers.Query (area, job.targets);
+      job.remaining = job.targets.size ();
+      NS_LOG_INFO ("Notification " << job.message->getId () << " targets " << job.remaining << " subscribers");
+    }
+  Enqueue (priority, std::move (job));
+}
+
+double
+WildfireServer::GetDeliveryRatio (uint32_t id) const
+{
+  return m_ledger.GetDeliveryRatio (id);
+}
+
+void
+WildfireServer::CheckDelivery (uint32_t id)
+{
+  std::shared_ptr<const WildfireMessage> message = m_ledger.GetMessage (id);
+  if (!message)
+    {
+      return;
+    }
+  // A superseded level is not worth retransmitting, the clients get the new one
+  if (message->isExpired ()
+      || (message->getZone () != 0 && m_zoneVersions[message->getZone ()] > message->getVersion ()))
+    {
+      m_ledger.Close (id);
+      return;
+    }
+
+  // Subscribers that left since the last round are not retried
+  std::vector<uint32_t> unacked;
+  m_ledger.GetUnacked (id, unacked);
+  uint32_t retry = 0;
+  for (uint32_t slot : unacked)
+    {
+      if (m_subscribers.GetSlot (slot).active)
+        {
+          unacked[retry++] = slot;
+        }
+    }
+  unacked.resize (retry);
+
+  if (unacked.empty () || m_ledger.AddAttempt (id) > m_maxRetransmissions)
+    {
+      // Keep the ledger queryable until the notification expires
+      Time expiresIn = message->getExpiresAt () - Simulator::Now ();
+      Simulator::Schedule (expiresIn + TimeStep (1), &WildfireServer::CheckDelivery, this, id);
+      return;
+    }
+
+  NS_LOG_INFO ("Retransmitting notification " << id << " to " << unacked.size () << " subscribers");
+  m_retransmitTrace (id, unacked.size ());
+  FanoutJob job;
+  job.message = message;
+  job.toSubscribers = true;
+  job.targeted = true;
+  job.nextSlot = 0;
+  job.remaining = unacked.size ();
+  job.targets = std::move (unacked);
+  Enqueue (ALERT, std::move (job));
+}
+
+void
+WildfireServer::EnqueueReply (Ptr<Socket> socket, const Address &dest, const WildfireMessage &message)
+{
+  FanoutJob job;
+  job.message = std::make_shared<const WildfireMessage> (message);
+  job.toSubscribers = false;
+  job.targeted = false;
+  job.nextSlot = 0;
+  job.remaining = 1;
+  job.dest = dest;
+  job.socket = socket;
+  Enqueue (CONTROL, std::move (job));
+}
+
+void
+WildfireServer::Enqueue (FanoutPriority priority, FanoutJob job)
+{
+  job.queuedAt = Simulator::Now ();
+  m_fanoutPending += job.remaining;
+  m_fanoutQueues[priority].push_back (std::move (job));
+  if (!m_fanoutEvent.IsRunning ())
+    {
+      m_fanoutEvent = Simulator::ScheduleNow (&WildfireServer::SendFanoutBatch, this);
+    }
+}
+
+void
+WildfireServer::SendFanoutBatch ()
+{
+  // Sending everything in one event floods the p2p and EPC queues, pace
+  // the fan-out to the configured egress rate instead
+  uint32_t budget = m_fanoutBatchSize > 0 ? m_fanoutBatchSize : UINT32_MAX;
+  for (uint32_t priority = 0; priority < N_PRIORITIES && budget > 0; ++priority)
+    {
+      std::deque<FanoutJob> &queue = m_fanoutQueues[priority];
+      while (!queue.empty () && budget > 0)
+        {
+          FanoutJob &job = queue.front ();
+          const WildfireMessage &message = *job.message;
+          if (job.toSubscribers && message.getZone () != 0
+              && m_zoneVersions[message.getZone ()] > message.getVersion ())
+            {
+              NS_LOG_LOGIC ("Dropping fan-out of superseded version " << message.getVersion ()
+                                                                      << " of zone " << message.getZone ());
+              m_fanoutPending -= job.remaining;
+              queue.pop_front ();
+              continue;
+            }
+          if (!job.toSubscribers)
+            {
+              SendMsg (job.socket, job.dest, *job.message);
+              --budget;
+            }
+          else
+            {
+              // Subscribers that joined during the fan-out are picked up as
+              // long as their slot is still ahead of the cursor
+              uint32_t end = job.targeted ? job.targets.size () : m_subscribers.GetSlotCount ();
+              for (; job.nextSlot < end && budget > 0; ++job.nextSlot)
+                {
+                  uint32_t slot = job.targeted ? job.targets[job.nextSlot] : job.nextSlot;
+                  const WildfireSubscriberRegistry::Subscriber &subscriber = m_subscribers.GetSlot (slot);
+                  if (!subscriber.active)
+                    {
+                      continue;
+                    }
+                  SendMsg (subscriber.socket, subscriber.address, *job.message);
+                  m_ledger.MarkSent (job.message->getId (), slot);
+                  NS_LOG_INFO ("Wildfire Notification SENT to " <<
+                               InetSocketAddress::ConvertFrom (subscriber.address).GetIpv4 () << " port " <<
+                               InetSocketAddress::ConvertFrom (subscriber.address).GetPort ());
+                  --budget;
+                  if (job.remaining > 0)
+                    {
+                      --job.remaining;
+                      --m_fanoutPending;
+                    }
+                }
+              if (job.nextSlot < end)
+                {
+                  break;
+                }
+              m_fanoutCompleteTrace (Simulator::Now () - job.queuedAt);
+              // Only check the acks once the last subscriber has been sent the notification
+              Simulator::Schedule (m_retransmitTimeout, &WildfireServer::CheckDelivery, this, job.message->getId ());
+            }
+          m_fanoutPending -= job.remaining;
+          queue.pop_front ();
+        }
+    }
+
+  m_fanoutQueueDepthTrace (m_fanoutPending);
+  for (uint32_t priority = 0; priority < N_PRIORITIES; ++priority)
     {
-      //NS_ASSERT (m_socket->Connect (InetSocketAddress::ConvertFrom (*subscriber)) != -1);
-      Address address = std::get<0> (*subscriber);
-      Ptr<Socket> socket = std::get<1> (*subscriber);
-      SendMsg (socket, &(address), &alert);
-      NS_LOG_INFO ("Wildfire Notification SENT to " <<
-                   InetSocketAddress::ConvertFrom (address).GetIpv4 () << " port " <<
-                   InetSocketAddress::ConvertFrom (address).GetPort ());
+      if (!m_fanoutQueues[priority].empty ())
+        {
+          m_fanoutEvent = Simulator::Schedule (m_fanoutInterval, &WildfireServer::SendFanoutBatch, this);
+          return;
+        }
     }
 }
 
@@ -180,49 +479,147 @@ WildfireServer::HandleRead (Ptr<Socket> socket)
                        InetSocketAddress::ConvertFrom (from).GetPort ());
         }
 
-      // Get data from packet
-      uint32_t size = packet->GetSize ();
-      uint8_t buffer[size];
-      packet->CopyData (buffer, size);
-
-      // convert data to application message
-      std::vector<uint8_t> vbuffer (buffer, buffer + sizeof buffer / sizeof buffer[0]);
-      WildfireMessage message = WildfireMessage (&vbuffer);
+      // Only the fixed header is needed on the server, the payload is never copied
+      WildfireHeader header;
+      if (m_wireFormat == WildfireWireFormat::text)
+        {
+          header = WildfireMessage (packet, m_wireFormat).getHeader ();
+        }
+      else if (WildfireHeader::IsComplete (packet))
+        {
+          packet->PeekHeader (header);
+        }
+      else
+        {
+          NS_LOG_INFO ("Dropping truncated packet of " << packet->GetSize () << " bytes");
+          continue;
+        }
 
       //NS_LOG_INFO(buffer);
       packet->RemoveAllPacketTags ();
       packet->RemoveAllByteTags ();
 
-      if(message.getType () == WildfireMessageType::subscribe)
+      Time retryAfter;
+      if(header.GetType () == WildfireMessageType::subscribe && !AdmitSubscription (retryAfter))
         {
-          NS_LOG_INFO ("Adding Subscriber");
-          subscribers.push_back (std::make_tuple (from, socket));
+          NS_LOG_INFO ("Refusing Subscriber, retry after " << retryAfter.As (Time::S));
+          m_subRefusedTrace ();
+          WildfireMessage error_message = WildfireMessage (header.GetId (), WildfireMessageType::error, retryAfter, std::string ());
+          error_message.setOrigin (GetNode ()->GetId ());
+          EnqueueReply (socket, from, error_message);
+        }
 
-          m_subTrace ();
+      else if(header.GetType () == WildfireMessageType::subscribe)
+        {
+          // Retries and renewals refresh the existing entry
+          Time expires_at = Simulator::Now () + m_subscriptionLease;
+          if (m_subscribers.Subscribe (header.GetOrigin (), from, socket, expires_at, header.GetPosition ()))
+            {
+              NS_LOG_INFO ("Adding Subscriber " << header.GetOrigin ());
+              m_subTrace ();
+            }
+
+          // Send Success Ack, the expiry is the end of the lease and the
+          // payload the public key notifications are verified with
+          WildfireMessage ack_message = WildfireMessage (header.GetId (), WildfireMessageType::acknowledgement, expires_at,
+                                                         std::string (m_publicKey.begin (), m_publicKey.end ()));
+          ack_message.setOrigin (GetNode ()->GetId ());
+          EnqueueReply (socket, from, ack_message);
+        }
 
-          // Send Success Ack
-          Ptr<Packet> ack;
-          Time expires_at = Simulator::Now () + Seconds (30);
-          WildfireMessage ack_message = WildfireMessage (message.getId (), WildfireMessageType::acknowledgement, &expires_at, m_publicKey);
-          SendMsg (socket, &from, &ack_message);
+      else if (header.GetType () == WildfireMessageType::unsubscribe)
+        {
+          if (m_subscribers.Unsubscribe (header.GetOrigin ()))
+            {
+              NS_LOG_INFO ("Removing Subscriber " << header.GetOrigin ());
+              m_unsubTrace ();
+            }
         }
 
-      else if (message.getType () == WildfireMessageType::acknowledgement)
+      else if (header.GetType () == WildfireMessageType::acknowledgement)
         {
           m_ackTrace ();
+          const WildfireSubscriberRegistry::Subscriber *subscriber = m_subscribers.Find (header.GetOrigin ());
+          if (subscriber != nullptr
+              && m_ledger.MarkAcked (header.GetId (), m_subscribers.GetSlotIndex (header.GetOrigin ())))
+            {
+              m_deliveryRatioTrace (header.GetId (), m_ledger.GetDeliveryRatio (header.GetId ()));
+            }
           NS_LOG_INFO ("Ack Received on Server");
         }
 
     }
 }
 
+bool
+WildfireServer::AdmitSubscription (Time &retryAfter)
+{
+  if (m_maxSubscribeRate == 0)
+    {
+      return true;
+    }
+
+  Time now = Simulator::Now ();
+  if (now >= m_admitWindowStart + Seconds (1))
+    {
+      m_admitWindowStart = now;
+      // Clients refused in the last window were told to come back in this one
+      m_admitted = 0;
+      m_refused = 0;
+    }
+  if (m_admitted < m_maxSubscribeRate)
+    {
+      ++m_admitted;
+      return true;
+    }
+
+  // Hand out the following windows in order so the retries arrive at the admitted rate
+  retryAfter = m_admitWindowStart + Seconds (1 + m_refused / m_maxSubscribeRate);
+  ++m_refused;
+  return false;
+}
+
 void
-WildfireServer::SendMsg (Ptr<Socket> socket, Address* dest, WildfireMessage* message)
+WildfireServer::SendMsg (Ptr<Socket> socket, const Address &dest, const WildfireMessage &message)
 {
-  auto serialized_message = message->serialize ();
-  Ptr<Packet> p = Create<Packet> (serialized_message->data (), serialized_message->size ());
+  Ptr<Packet> p = message.toPacket (m_wireFormat);
   m_txTrace ();
-  socket->SendTo (p, 0, *dest);
+  socket->SendTo (p, 0, dest);
+}
+
+void
+WildfireServer::SetWireFormat (int format)
+{
+  m_wireFormat = static_cast<WildfireWireFormat> (format);
+}
+
+int
+WildfireServer::GetWireFormat (void) const
+{
+  return static_cast<int> (m_wireFormat);
+}
+
+void
+WildfireServer::SetKey (std::string key)
+{
+  // Derived once, subscribe handling and signing only read the key pair
+  m_key = key;
+  Sha256 hash;
+  hash.Update (reinterpret_cast<const uint8_t*> (m_key.data ()), m_key.size ());
+  m_privateKey = hash.Final ();
+  m_publicKey = Ed25519GetPublicKey (m_privateKey);
+}
+
+std::string
+WildfireServer::GetKey (void) const
+{
+  return m_key;
+}
+
+Ed25519PublicKey
+WildfireServer::GetPublicKey (void) const
+{
+  return m_publicKey;
 }
 
-} // Namespace ns3
\ No newline at end of file
+} // Namespace ns3
@@ -23,21 +23,109 @@
 #include "ns3/ptr.h"
 #include "ns3/address.h"
 #include "ns3/traced-callback.h"
+#include <deque>
+#include <unordered_map>
+#include <memory>
 #include "wildfire-message.h"
+#include "wildfire-subscriber-registry.h"
+#include "wildfire-delivery-ledger.h"
 
 namespace ns3 {
 
 class Socket;
 class Packet;
 
+/**
+ * \ingroup Wildfire
+ * \brief Evacuation level of an alert zone changing at a given time
+ */
+struct WildfireLevelChange
+{
+  Time at; //!< Delay from the time the timeline is scheduled
+  uint16_t zone; //!< Alert zone, not 0
+  uint8_t level; //!< New evacuation level
+  WildfireTargetArea area; //!< Subscribers notified of the change
+  std::vector<Vector> route; //!< Evacuation route carried by the alert, empty for the default route
+};
+
 class WildfireServer : public Application
 {
 public:
+  /// Fan-out queues, lower values are sent first
+  enum FanoutPriority
+  {
+    CONTROL = 0, //!< Acks and errors
+    ALERT = 1, //!< Notifications
+    ROUTINE = 2, //!< Low priority notifications
+    N_PRIORITIES
+  };
+
   WildfireServer ();
   virtual ~WildfireServer ();
   static TypeId GetTypeId (void);
-  void ScheduleNotification (Time dt);
-  void SendNotification ();
+  void ScheduleNotification (Time dt, FanoutPriority priority = ALERT);
+
+  /**
+   * \brief Schedule a notification for the subscribers inside area
+   */
+  void ScheduleNotification (Time dt, const WildfireTargetArea &area, FanoutPriority priority = ALERT);
+
+  /**
+   * \brief Queue a signed notification for every subscriber
+   *
+   * The notification is sent by the paced fan-out, FanoutBatchSize
+   * packets every FanoutInterval.
+   */
+  void SendNotification (FanoutPriority priority = ALERT);
+
+  /**
+   * \brief Queue a signed notification for the subscribers inside area
+   *
+   * Subscribers are located by the position in their last subscribe, only
+   * the grid cells overlapping the area are visited.
+   */
+  void SendNotification (const WildfireTargetArea &area, FanoutPriority priority = ALERT);
+
+  /**
+   * \brief Schedule a change of the evacuation level of zone
+   *
+   * Every change is sent as the next version of the zone alert, clients
+   * replace the previous level with it and stop rebroadcasting the old one.
+   *
+   * \param route evacuation route of the alert, empty for the default route
+   */
+  void ScheduleLevelChange (Time dt, uint16_t zone, uint8_t level,
+                            const WildfireTargetArea &area = WildfireTargetArea (),
+                            const std::vector<Vector> &route = std::vector<Vector> ());
+
+  /**
+   * \brief Schedule every level change of timeline
+   */
+  void ScheduleTimeline (const std::vector<WildfireLevelChange> &timeline);
+
+  /**
+   * \brief Evacuation route carried by notifications that do not set their own
+   *
+   * Clients follow the waypoints of the route and stop at the last one.
+   */
+  void SetEvacuationRoute (const std::vector<Vector> &route);
+
+  /**
+   * \brief Share of the subscribers sent notification id that acked it
+   *
+   * Available until the notification expires, 0 afterwards.
+   */
+  double GetDeliveryRatio (uint32_t id) const;
+
+  /**
+   * \brief Public key clients verify notifications with
+   *
+   * Derived from the Key attribute, which never leaves the server.  Clients
+   * given this key by WildfireClientHelper::SetServerKey verify notifications
+   * relayed by peers without ever reaching the server, the others learn it
+   * from the subscription ack.
+   */
+  Ed25519PublicKey GetPublicKey (void) const;
 
 protected:
   virtual void DoDispose (void);
@@ -46,6 +134,18 @@ private:
   virtual void StartApplication (void);
   virtual void StopApplication (void);
 
+  /**
+   * \brief WireFormat attribute accessors, EnumValue only holds an int
+   */
+  void SetWireFormat (int format);
+  int GetWireFormat (void) const;
+
+  /**
+   * \brief Key attribute accessors, the key pair is derived on every set
+   */
+  void SetKey (std::string key);
+  std::string GetKey (void) const;
+
   /**
    * \brief Handle a packet reception.
    *
@@ -56,10 +156,64 @@ private:
   void HandleRead (Ptr<Socket> socket);
   bool HandleRequest (Ptr<Socket> socket, const Address & source);
   void HandleAccept (Ptr<Socket> socket, const Address & source);
-  void  SendMsg (Ptr<Socket> socket, Address* dest, WildfireMessage* message);
+  void  SendMsg (Ptr<Socket> socket, const Address &dest, const WildfireMessage &message);
+
+  /**
+   * \brief Admission control for subscription requests
+   *
+   * At most MaxSubscribeRate requests are accepted per second.  A refused
+   * request is answered with an error whose expires_at is the retry-after
+   * hint, refused clients are spread over the following seconds.
+   *
+   * \param retryAfter set to the retry-after hint when refused
+   * \return true if the request is accepted
+   */
+  bool AdmitSubscription (Time &retryAfter);
+  /**
+   * \param zone alert zone or 0 for a notification outside any zone
+   * \param level evacuation level in the notification text
+   * \param route evacuation route, empty for m_route
+   */
+  void DoSendNotification (WildfireTargetArea area, FanoutPriority priority, uint16_t zone, uint8_t level,
+                           std::vector<Vector> route);
+
+  /**
+   * \brief Retransmit notification id to the subscribers that did not ack it
+   *
+   * Runs RetransmitTimeout after every completed fan-out of the
+   * notification, at most MaxRetransmissions times.  The ledger entry is
+   * closed once the notification expires.
+   */
+  void CheckDelivery (uint32_t id);
+
+  /// A queued fan-out, either one message to every subscriber or a single reply
+  struct FanoutJob
+  {
+    std::shared_ptr<const WildfireMessage> message; //!< Message to send
+    bool toSubscribers; //!< Send to subscribers, otherwise to dest
+    bool targeted; //!< Send to the slots in targets rather than every subscriber
+    std::vector<uint32_t> targets; //!< Subscriber slots inside the target area
+    uint32_t nextSlot; //!< Fan-out cursor, a slot or an index into targets
+    uint32_t remaining; //!< Sends still counted in m_fanoutPending
+    Address dest; //!< Destination of a single reply
+    Ptr<Socket> socket; //!< Socket of a single reply
+    Time queuedAt; //!< Time the job was queued
+  };
+
+  /**
+   * \brief Queue a single reply on the CONTROL queue
+   */
+  void EnqueueReply (Ptr<Socket> socket, const Address &dest, const WildfireMessage &message);
+  void Enqueue (FanoutPriority priority, FanoutJob job);
+
+  /**
+   * \brief Send up to FanoutBatchSize queued packets, highest priority first
+   */
+  void SendFanoutBatch ();
 
   uint16_t m_port;   //!< Port on which we listen for incoming packets.
   Ptr<Socket> m_socket;   //!< IPv4 Socket
+  WildfireWireFormat m_wireFormat; //!< Encoding used for messages
 
   /// Callbacks for tracing the packet Rx events
   TracedCallback<Ptr<const Packet> > m_rxTrace;
@@ -76,11 +230,48 @@ private:
   /// Callbacks for tracing the received subscription events
   TracedCallback<> m_subTrace;
 
-  std::vector<std::tuple<Address,Ptr<Socket>>> subscribers;
+  /// Callbacks for tracing the received unsubscribe events
+  TracedCallback<> m_unsubTrace;
+
+  /// Callbacks for tracing subscription requests refused by admission control
+  TracedCallback<> m_subRefusedTrace;
+
+  /// Callbacks for tracing the number of queued fan-out packets after every batch
+  TracedCallback<uint32_t> m_fanoutQueueDepthTrace;
+
+  /// Callbacks for tracing completed notification fan-outs, time from queueing to the last subscriber
+  TracedCallback<Time> m_fanoutCompleteTrace;
+
+  /// Callbacks for tracing the delivery ratio of a notification whenever it changes
+  TracedCallback<uint32_t, double> m_deliveryRatioTrace;
+
+  /// Callbacks for tracing retransmission rounds, notification id and number of subscribers retried
+  TracedCallback<uint32_t, uint32_t> m_retransmitTrace;
+
+  WildfireSubscriberRegistry m_subscribers; //!< Registered subscribers
+  Time m_subscriptionLease; //!< Lease granted with every subscription
   EventId m_sendEvent;   //!< Event to send the next packet
+  EventId m_fanoutEvent; //!< Event to send the next fan-out batch
+  std::deque<FanoutJob> m_fanoutQueues[N_PRIORITIES]; //!< Queued fan-outs per priority
+  uint32_t m_fanoutPending = 0; //!< Packets waiting in the fan-out queues
+  uint32_t m_fanoutBatchSize; //!< Packets sent per batch, 0 for no limit
+  Time m_fanoutInterval; //!< Time between batches
+  double m_spatialCellSize; //!< Edge of the subscriber grid cells in meters
+  uint8_t m_ttl; //!< Peer relays allowed for notifications
+  WildfireDeliveryLedger m_ledger; //!< Sent and acked subscribers per notification
+  std::unordered_map<uint16_t, uint32_t> m_zoneVersions; //!< Latest alert version per zone
+  Time m_retransmitTimeout; //!< Wait for acks before retransmitting
+  uint32_t m_maxRetransmissions; //!< Retransmission rounds per notification
+
+  std::string m_key; //!< Secret the signing key pair is derived from
+  Ed25519Seed m_privateKey; //!< SHA-256 of m_key
+  Ed25519PublicKey m_publicKey; //!< Public key of m_privateKey, sent in acks
+  std::vector<Vector> m_route; //!< Default evacuation route of notifications
 
-  std::string* m_privateKey;
-  std::string* m_publicKey;
+  uint32_t m_maxSubscribeRate; //!< Subscriptions accepted per second, 0 for no limit
+  Time m_admitWindowStart; //!< Start of the current one second admission window
+  uint32_t m_admitted = 0; //!< Subscriptions accepted in the current window
+  uint32_t m_refused = 0; //!< Subscriptions refused in the current window
   uint32_t id = 0;
 };
 
@@ -0,0 +1,285 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "ns3/assert.h"
+#include "wildfire-spatial-index.h"
+
+namespace ns3
+{
+
+WildfireTargetArea::WildfireTargetArea ()
+  : m_shape (EVERYWHERE),
+    m_radius (0)
+{
+}
+
+WildfireTargetArea
+WildfireTargetArea::Circle (const Vector &center, double radius)
+{
+  WildfireTargetArea area;
+  area.m_shape = CIRCLE;
+  area.m_center = center;
+  area.m_radius = radius;
+  area.m_min = Vector (center.x - radius, center.y - radius, 0);
+  area.m_max = Vector (center.x + radius, center.y + radius, 0);
+  return area;
+}
+
+WildfireTargetArea
+WildfireTargetArea::Polygon (const std::vector<Vector> &vertices)
+{
+  NS_ASSERT_MSG (vertices.size () >= 3, "A polygon needs at least three vertices");
+  WildfireTargetArea area;
+  area.m_shape = POLYGON;
+  area.m_vertices = vertices;
+  area.m_min = Vector (std::numeric_limits<double>::max (), std::numeric_limits<double>::max (), 0);
+  area.m_max = Vector (std::numeric_limits<double>::lowest (), std::numeric_limits<double>::lowest (), 0);
+  for (const Vector &vertex : vertices)
+    {
+      area.m_min.x = std::min (area.m_min.x, vertex.x);
+      area.m_min.y = std::min (area.m_min.y, vertex.y);
+      area.m_max.x = std::max (area.m_max.x, vertex.x);
+      area.m_max.y = std::max (area.m_max.y, vertex.y);
+    }
+  return area;
+}
+
+bool
+WildfireTargetArea::IsEverywhere (void) const
+{
+  return m_shape == EVERYWHERE;
+}
+
+bool
+WildfireTargetArea::Contains (const Vector &position) const
+{
+  switch (m_shape)
+    {
+    case CIRCLE:
+      {
+        double dx = position.x - m_center.x;
+        double dy = position.y - m_center.y;
+        return dx * dx + dy * dy <= m_radius * m_radius;
+      }
+    case POLYGON:
+      {
+        if (position.x < m_min.x || position.x > m_max.x || position.y < m_min.y || position.y > m_max.y)
+          {
+            return false;
+          }
+        // Even-odd rule, count the edges crossed by a ray towards +x
+        bool inside = false;
+        for (size_t i = 0, j = m_vertices.size () - 1; i < m_vertices.size (); j = i++)
+          {
+            const Vector &a = m_vertices[i];
+            const Vector &b = m_vertices[j];
+            if ((a.y > position.y) != (b.y > position.y)
+                && position.x < (b.x - a.x) * (position.y - a.y) / (b.y - a.y) + a.x)
+              {
+                inside = !inside;
+              }
+          }
+        return inside;
+      }
+    default:
+      return true;
+    }
+}
+
+void
+WildfireTargetArea::GetBounds (Vector &min, Vector &max) const
+{
+  min = m_min;
+  max = m_max;
+}
+
+WildfireGridIndex::WildfireGridIndex ()
+  : m_cellSize (500),
+    m_size (0)
+{
+}
+
+void
+WildfireGridIndex::SetCellSize (double size)
+{
+  NS_ASSERT_MSG (m_size == 0, "The cell size can only be changed while the index is empty");
+  NS_ASSERT (size > 0);
+  m_cellSize = size;
+}
+
+int32_t
+WildfireGridIndex::CellCoordinate (double value) const
+{
+  double cell = std::floor (value / m_cellSize);
+  cell = std::max (cell, static_cast<double> (std::numeric_limits<int32_t>::min ()));
+  cell = std::min (cell, static_cast<double> (std::numeric_limits<int32_t>::max ()));
+  return static_cast<int32_t> (cell);
+}
+
+uint64_t
+WildfireGridIndex::MakeCell (int32_t x, int32_t y) const
+{
+  return (static_cast<uint64_t> (static_cast<uint32_t> (x)) << 32) | static_cast<uint32_t> (y);
+}
+
+void
+WildfireGridIndex::Insert (uint32_t id, const Vector &position)
+{
+  if (id >= m_entries.size ())
+    {
+      m_entries.resize (id + 1, Entry {Vector (), 0, 0, false});
+    }
+  uint64_t cell = MakeCell (CellCoordinate (position.x), CellCoordinate (position.y));
+  Entry &entry = m_entries[id];
+  if (entry.present && entry.cell == cell)
+    {
+      entry.position = position;
+      return;
+    }
+  if (entry.present)
+    {
+      Remove (id);
+    }
+
+  std::vector<uint32_t> &ids = m_cells[cell];
+  entry = Entry {position, cell, static_cast<uint32_t> (ids.size ()), true};
+  ids.push_back (id);
+  ++m_size;
+}
+
+void
+WildfireGridIndex::Remove (uint32_t id)
+{
+  if (!Contains (id))
+    {
+      return;
+    }
+  Entry &entry = m_entries[id];
+  auto itr = m_cells.find (entry.cell);
+  std::vector<uint32_t> &ids = itr->second;
+  // Swap with the last id of the cell to keep it dense
+  ids[entry.offset] = ids.back ();
+  m_entries[ids[entry.offset]].offset = entry.offset;
+  ids.pop_back ();
+  if (ids.empty ())
+    {
+      m_cells.erase (itr);
+    }
+  entry.present = false;
+  --m_size;
+}
+
+bool
+WildfireGridIndex::Contains (uint32_t id) const
+{
+  return id < m_entries.size () && m_entries[id].present;
+}
+
+void
+WildfireGridIndex::QueryCell (const std::vector<uint32_t> &cell, const WildfireTargetArea &area,
+                              std::vector<uint32_t> &ids) const
+{
+  for (uint32_t id : cell)
+    {
+      if (area.Contains (m_entries[id].position))
+        {
+          ids.push_back (id);
+        }
+    }
+}
+
+void
+WildfireGridIndex::Query (const WildfireTargetArea &area, std::vector<uint32_t> &ids) const
+{
+  if (area.IsEverywhere ())
+    {
+      for (const auto &cell : m_cells)
+        {
+          ids.insert (ids.end (), cell.second.begin (), cell.second.end ());
+        }
+      return;
+    }
+
+  Vector min, max;
+  area.GetBounds (min, max);
+  int32_t x0 = CellCoordinate (min.x);
+  int32_t x1 = CellCoordinate (max.x);
+  int32_t y0 = CellCoordinate (min.y);
+  int32_t y1 = CellCoordinate (max.y);
+  double spanned = (static_cast<double> (x1) - x0 + 1) * (static_cast<double> (y1) - y0 + 1);
+
+  // Areas much larger than the populated region are cheaper to answer from
+  // the occupied cells than by walking the empty ones
+  if (spanned > m_cells.size ())
+    {
+      for (const auto &cell : m_cells)
+        {
+          int32_t x = static_cast<int32_t> (cell.first >> 32);
+          int32_t y = static_cast<int32_t> (cell.first & 0xffffffff);
+          if (x >= x0 && x <= x1 && y >= y0 && y <= y1)
+            {
+              QueryCell (cell.second, area, ids);
+            }
+        }
+      return;
+    }
+
+  for (int64_t x = x0; x <= x1; ++x)
+    {
+      for (int64_t y = y0; y <= y1; ++y)
+        {
+          auto itr = m_cells.find (MakeCell (static_cast<int32_t> (x), static_cast<int32_t> (y)));
+          if (itr != m_cells.end ())
+            {
+              QueryCell (itr->second, area, ids);
+            }
+        }
+    }
+}
+
+uint32_t
+WildfireGridIndex::GetCellCount (const Vector &position) const
+{
+  auto itr = m_cells.find (MakeCell (CellCoordinate (position.x), CellCoordinate (position.y)));
+  return itr == m_cells.end () ? 0 : itr->second.size ();
+}
+
+double
+WildfireGridIndex::GetCellSize (void) const
+{
+  return m_cellSize;
+}
+
+uint32_t
+WildfireGridIndex::GetSize (void) const
+{
+  return m_size;
+}
+
+void
+WildfireGridIndex::Clear (void)
+{
+  m_entries.clear ();
+  m_cells.clear ();
+  m_size = 0;
+}
+
+} // namespace ns3
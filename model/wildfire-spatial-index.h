@@ -0,0 +1,136 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_SPATIAL_INDEX_H
+#define WILDFIRE_SPATIAL_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "ns3/vector.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Ground area targeted by a notification
+ *
+ * Either everywhere, a circle or a simple polygon in the x-y plane.
+ */
+class WildfireTargetArea
+{
+public:
+  /// An area covering every position
+  WildfireTargetArea ();
+
+  static WildfireTargetArea Circle (const Vector &center, double radius);
+
+  /**
+   * \param vertices polygon corners in order, the last one connects back to the first
+   */
+  static WildfireTargetArea Polygon (const std::vector<Vector> &vertices);
+
+  bool IsEverywhere (void) const;
+  bool Contains (const Vector &position) const;
+
+  /**
+   * \brief Axis aligned bounding box, only meaningful when not everywhere
+   */
+  void GetBounds (Vector &min, Vector &max) const;
+
+private:
+  enum Shape
+  {
+    EVERYWHERE,
+    CIRCLE,
+    POLYGON
+  };
+
+  Shape m_shape; //!< Kind of area
+  Vector m_center; //!< Circle center
+  double m_radius; //!< Circle radius
+  std::vector<Vector> m_vertices; //!< Polygon corners
+  Vector m_min; //!< Lower bounding box corner
+  Vector m_max; //!< Upper bounding box corner
+};
+
+/**
+ * \ingroup Wildfire
+ * \brief Uniform grid over the x-y plane mapping positions to ids
+ *
+ * Only occupied cells are stored.  Insert, move and remove are O(1), a
+ * query visits the cells overlapping the area bounds and tests the ids in
+ * them, so its cost follows the size of the area rather than the number of
+ * ids indexed.
+ */
+class WildfireGridIndex
+{
+public:
+  WildfireGridIndex ();
+
+  /**
+   * \brief Set the cell edge length in meters, only allowed while empty
+   */
+  void SetCellSize (double size);
+
+  /**
+   * \brief Index id at position, moving it if already indexed
+   */
+  void Insert (uint32_t id, const Vector &position);
+  void Remove (uint32_t id);
+  bool Contains (uint32_t id) const;
+
+  /**
+   * \brief Append the ids positioned inside area to ids
+   */
+  void Query (const WildfireTargetArea &area, std::vector<uint32_t> &ids) const;
+
+  /**
+   * \brief Number of ids in the cell holding position
+   */
+  uint32_t GetCellCount (const Vector &position) const;
+  double GetCellSize (void) const;
+
+  uint32_t GetSize (void) const;
+  void Clear (void);
+
+private:
+  /// Position of an indexed id
+  struct Entry
+  {
+    Vector position; //!< Indexed position
+    uint64_t cell; //!< Key of the cell holding the id
+    uint32_t offset; //!< Index of the id in the cell
+    bool present; //!< False when the id is not indexed
+  };
+
+  int32_t CellCoordinate (double value) const;
+  uint64_t MakeCell (int32_t x, int32_t y) const;
+  void QueryCell (const std::vector<uint32_t> &cell, const WildfireTargetArea &area,
+                  std::vector<uint32_t> &ids) const;
+
+  double m_cellSize; //!< Cell edge length in meters
+  std::vector<Entry> m_entries; //!< Entries by id
+  std::unordered_map<uint64_t, std::vector<uint32_t> > m_cells; //!< Ids in every occupied cell
+  uint32_t m_size; //!< Number of indexed ids
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_SPATIAL_INDEX_H */
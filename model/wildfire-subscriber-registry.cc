@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include "ns3/log.h"
+#include "wildfire-subscriber-registry.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("WildfireSubscriberRegistry");
+
+WildfireSubscriberRegistry::WildfireSubscriberRegistry ()
+{
+}
+
+void
+WildfireSubscriberRegistry::Reserve (uint32_t count)
+{
+  m_slots.reserve (count);
+  m_index.reserve (count);
+}
+
+void
+WildfireSubscriberRegistry::SetCellSize (double size)
+{
+  m_grid.SetCellSize (size);
+}
+
+void
+WildfireSubscriberRegistry::SetReleaseCallback (Callback<void, uint32_t> release)
+{
+  m_release = release;
+}
+
+bool
+WildfireSubscriberRegistry::Subscribe (uint32_t node, const Address &address, Ptr<Socket> socket, Time leaseExpiresAt,
+                                       const Vector &position)
+{
+  auto itr = m_index.find (node);
+  if (itr != m_index.end ())
+    {
+      // Retries and renewals only move the lease, the address may have changed
+      Subscriber &subscriber = m_slots[itr->second];
+      subscriber.address = address;
+      subscriber.socket = socket;
+      subscriber.leaseExpiresAt = leaseExpiresAt;
+      subscriber.position = position;
+      m_grid.Insert (itr->second, position);
+      return false;
+    }
+
+  uint32_t slot;
+  if (!m_free.empty ())
+    {
+      slot = m_free.back ();
+      m_free.pop_back ();
+    }
+  else
+    {
+      slot = m_slots.size ();
+      m_slots.emplace_back ();
+    }
+  m_slots[slot] = Subscriber {node, address, socket, leaseExpiresAt, position, true};
+  m_index[node] = slot;
+  m_grid.Insert (slot, position);
+  NS_LOG_LOGIC ("Subscriber " << node << " added in slot " << slot);
+  return true;
+}
+
+bool
+WildfireSubscriberRegistry::Unsubscribe (uint32_t node)
+{
+  auto itr = m_index.find (node);
+  if (itr == m_index.end ())
+    {
+      return false;
+    }
+  RemoveAt (itr->second);
+  return true;
+}
+
+void
+WildfireSubscriberRegistry::RemoveAt (uint32_t slot)
+{
+  Subscriber &subscriber = m_slots[slot];
+  NS_LOG_LOGIC ("Subscriber " << subscriber.node << " removed from slot " << slot);
+  m_index.erase (subscriber.node);
+  m_grid.Remove (slot);
+  subscriber.active = false;
+  subscriber.socket = 0;
+  m_free.push_back (slot);
+  if (!m_release.IsNull ())
+    {
+      m_release (slot);
+    }
+}
+
+const WildfireSubscriberRegistry::Subscriber*
+WildfireSubscriberRegistry::Find (uint32_t node) const
+{
+  auto itr = m_index.find (node);
+  if (itr == m_index.end ())
+    {
+      return nullptr;
+    }
+  return &m_slots[itr->second];
+}
+
+uint32_t
+WildfireSubscriberRegistry::EvictExpired (Time now)
+{
+  uint32_t evicted = 0;
+  for (uint32_t slot = 0; slot < m_slots.size (); ++slot)
+    {
+      if (m_slots[slot].active && m_slots[slot].leaseExpiresAt < now)
+        {
+          RemoveAt (slot);
+          ++evicted;
+        }
+    }
+  NS_LOG_LOGIC ("Evicted " << evicted << " expired subscribers");
+  return evicted;
+}
+
+uint32_t
+WildfireSubscriberRegistry::GetSize (void) const
+{
+  return m_index.size ();
+}
+
+uint32_t
+WildfireSubscriberRegistry::GetSlotCount (void) const
+{
+  return m_slots.size ();
+}
+
+const WildfireSubscriberRegistry::Subscriber&
+WildfireSubscriberRegistry::GetSlot (uint32_t slot) const
+{
+  return m_slots[slot];
+}
+
+void
+WildfireSubscriberRegistry::Query (const WildfireTargetArea &area, std::vector<uint32_t> &slots) const
+{
+  m_grid.Query (area, slots);
+}
+
+uint32_t
+WildfireSubscriberRegistry::GetSlotIndex (uint32_t node) const
+{
+  return m_index.at (node);
+}
+
+void
+WildfireSubscriberRegistry::Clear (void)
+{
+  m_slots.clear ();
+  m_free.clear ();
+  m_index.clear ();
+  m_grid.Clear ();
+}
+
+} // namespace ns3
@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_SUBSCRIBER_REGISTRY_H
+#define WILDFIRE_SUBSCRIBER_REGISTRY_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "ns3/address.h"
+#include "ns3/callback.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/socket.h"
+#include "ns3/vector.h"
+#include "wildfire-spatial-index.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Subscribers known to a WildfireServer
+ *
+ * Subscribers are kept in contiguous slots for fan-out iteration with a
+ * hash index on the subscriber node id, so a repeated subscribe only
+ * refreshes the existing entry.  A slot keeps its index for as long as the
+ * subscriber is registered, freed slots are reused by later subscribers.
+ * Every subscription holds a lease and is dropped once the lease expires.
+ * Subscriber positions are kept in a grid index for geo-targeted fan-out.
+ */
+class WildfireSubscriberRegistry
+{
+public:
+  /// A registered subscriber
+  struct Subscriber
+  {
+    uint32_t node; //!< Node id of the subscriber, the message origin
+    Address address; //!< Address notifications are sent to
+    Ptr<Socket> socket; //!< Socket the subscription arrived on
+    Time leaseExpiresAt; //!< End of the subscription lease
+    Vector position; //!< Position reported with the last subscribe
+    bool active; //!< False for a free slot
+  };
+
+  WildfireSubscriberRegistry ();
+
+  /**
+   * \brief Reserve room for the expected number of subscribers
+   */
+  void Reserve (uint32_t count);
+
+  /**
+   * \brief Set the spatial index cell size in meters, only allowed while empty
+   */
+  void SetCellSize (double size);
+
+  /**
+   * \brief Set the callback invoked with a slot when its subscriber is removed
+   *
+   * Called before the slot can be reused, not called by Clear.
+   */
+  void SetReleaseCallback (Callback<void, uint32_t> release);
+
+  /**
+   * \brief Add a subscriber or refresh the address, lease and position of a known one
+   * \return true if the subscriber is new
+   */
+  bool Subscribe (uint32_t node, const Address &address, Ptr<Socket> socket, Time leaseExpiresAt,
+                  const Vector &position);
+
+  /**
+   * \return true if the subscriber was registered
+   */
+  bool Unsubscribe (uint32_t node);
+
+  /**
+   * \return the subscriber or nullptr
+   */
+  const Subscriber* Find (uint32_t node) const;
+
+  /**
+   * \brief Drop every subscriber whose lease expired before now
+   * \return the number of dropped subscribers
+   */
+  uint32_t EvictExpired (Time now);
+
+  /// Number of registered subscribers
+  uint32_t GetSize (void) const;
+
+  /// Number of slots, iterate GetSlot (0 .. GetSlotCount () - 1) and skip inactive ones
+  uint32_t GetSlotCount (void) const;
+  const Subscriber& GetSlot (uint32_t slot) const;
+
+  /**
+   * \brief Append the slots of the subscribers positioned inside area
+   */
+  void Query (const WildfireTargetArea &area, std::vector<uint32_t> &slots) const;
+
+  /// Slot of a registered subscriber, valid until it is removed
+  uint32_t GetSlotIndex (uint32_t node) const;
+
+  void Clear (void);
+
+private:
+  void RemoveAt (uint32_t slot);
+
+  std::vector<Subscriber> m_slots; //!< Subscriber storage
+  std::vector<uint32_t> m_free; //!< Free slots, reused last in first out
+  std::unordered_map<uint32_t, uint32_t> m_index; //!< Node id to slot
+  WildfireGridIndex m_grid; //!< Slots by subscriber position
+  Callback<void, uint32_t> m_release; //!< Invoked with every freed slot
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_SUBSCRIBER_REGISTRY_H */
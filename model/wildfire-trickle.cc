@@ -0,0 +1,139 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "wildfire-trickle.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("WildfireTrickleTimer");
+
+WildfireTrickleTimer::WildfireTrickleTimer ()
+  : m_imin (MilliSeconds (100)),
+    m_imax (Seconds (60)),
+    m_k (2),
+    m_interval (MilliSeconds (100)),
+    m_counter (0),
+    m_running (false)
+{
+}
+
+WildfireTrickleTimer::~WildfireTrickleTimer ()
+{
+  Stop ();
+}
+
+void
+WildfireTrickleTimer::SetParameters (Time imin, Time imax, uint32_t k)
+{
+  NS_ASSERT_MSG (imin.IsStrictlyPositive () && imin <= imax, "Trickle needs 0 < Imin <= Imax");
+  m_imin = imin;
+  m_imax = imax;
+  m_k = k;
+}
+
+void
+WildfireTrickleTimer::SetRandomVariable (Ptr<UniformRandomVariable> rng)
+{
+  m_rng = rng;
+}
+
+void
+WildfireTrickleTimer::SetCallbacks (Callback<void> transmit, Callback<void> suppressed)
+{
+  m_transmit = transmit;
+  m_suppressed = suppressed;
+}
+
+void
+WildfireTrickleTimer::Consistent (void)
+{
+  ++m_counter;
+}
+
+void
+WildfireTrickleTimer::Inconsistent (void)
+{
+  if (m_running && m_interval == m_imin)
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("Trickle reset to Imin " << m_imin.As (Time::S));
+  m_running = true;
+  m_interval = m_imin;
+  StartInterval ();
+}
+
+void
+WildfireTrickleTimer::Stop (void)
+{
+  m_running = false;
+  Simulator::Cancel (m_transmitEvent);
+  Simulator::Cancel (m_intervalEvent);
+}
+
+bool
+WildfireTrickleTimer::IsRunning (void) const
+{
+  return m_running;
+}
+
+Time
+WildfireTrickleTimer::GetInterval (void) const
+{
+  return m_interval;
+}
+
+void
+WildfireTrickleTimer::StartInterval (void)
+{
+  Simulator::Cancel (m_transmitEvent);
+  Simulator::Cancel (m_intervalEvent);
+  m_counter = 0;
+
+  double half = m_interval.GetSeconds () / 2;
+  Time t = Seconds (m_rng->GetValue (half, 2 * half));
+  m_transmitEvent = Simulator::Schedule (t, &WildfireTrickleTimer::Transmit, this);
+  m_intervalEvent = Simulator::Schedule (m_interval, &WildfireTrickleTimer::DoubleInterval, this);
+}
+
+void
+WildfireTrickleTimer::Transmit (void)
+{
+  if (m_k != 0 && m_counter >= m_k)
+    {
+      NS_LOG_LOGIC ("Trickle suppressed after hearing " << m_counter << " copies");
+      if (!m_suppressed.IsNull ())
+        {
+          m_suppressed ();
+        }
+      return;
+    }
+  m_transmit ();
+}
+
+void
+WildfireTrickleTimer::DoubleInterval (void)
+{
+  m_interval = Min (m_interval + m_interval, m_imax);
+  StartInterval ();
+}
+
+} // namespace ns3
@@ -0,0 +1,95 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USo
+ *
+ * Author: Brian O'Neill <broneill@pdx.edu>
+ */
+
+#ifndef WILDFIRE_TRICKLE_H
+#define WILDFIRE_TRICKLE_H
+
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup Wildfire
+ * \brief Trickle timer (RFC 6206)
+ *
+ * Each interval I picks a transmission time t in [I/2, I).  At t the
+ * transmit callback fires unless k or more consistent transmissions were
+ * heard during the interval.  When the interval ends I doubles, up to Imax.
+ * An inconsistency resets I to Imin.
+ */
+class WildfireTrickleTimer
+{
+public:
+  WildfireTrickleTimer ();
+  ~WildfireTrickleTimer ();
+
+  /**
+   * \param imin minimum interval length
+   * \param imax maximum interval length
+   * \param k redundancy constant, 0 disables suppression
+   */
+  void SetParameters (Time imin, Time imax, uint32_t k);
+  void SetRandomVariable (Ptr<UniformRandomVariable> rng);
+
+  /**
+   * \param transmit called at t when the transmission is not suppressed
+   * \param suppressed called at t when the transmission is suppressed
+   */
+  void SetCallbacks (Callback<void> transmit, Callback<void> suppressed);
+
+  /**
+   * \brief A consistent transmission was heard, increments the counter c
+   */
+  void Consistent (void);
+
+  /**
+   * \brief An inconsistent transmission was heard or new data arrived,
+   * starts the timer at Imin or resets it when I is larger than Imin
+   */
+  void Inconsistent (void);
+
+  void Stop (void);
+  bool IsRunning (void) const;
+  Time GetInterval (void) const;
+
+private:
+  void StartInterval (void);
+  void Transmit (void);
+  void DoubleInterval (void);
+
+  Time m_imin; //!< Minimum interval length
+  Time m_imax; //!< Maximum interval length
+  uint32_t m_k; //!< Redundancy constant
+  Time m_interval; //!< Current interval length I
+  uint32_t m_counter; //!< Consistent transmissions heard this interval
+  bool m_running; //!< Whether the timer is running
+  EventId m_transmitEvent; //!< Event at t
+  EventId m_intervalEvent; //!< Event at the end of the interval
+  Ptr<UniformRandomVariable> m_rng; //!< Picks t within the interval
+  Callback<void> m_transmit; //!< Transmission callback
+  Callback<void> m_suppressed; //!< Suppressed transmission callback
+};
+
+} // namespace ns3
+
+#endif /* WILDFIRE_TRICKLE_H */
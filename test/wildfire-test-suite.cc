@@ -1,55 +1,851 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 /*
-// Include a header file from your module to test.
-#include "ns3/wildfire.h"
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
 
-// An essential include is test.h
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/packet.h"
+#include "ns3/simple-net-device-helper.h"
+#include "ns3/simulator.h"
 #include "ns3/test.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/wildfire-client.h"
+#include "ns3/wildfire-crypto.h"
+#include "ns3/wildfire-delivery-ledger.h"
+#include "ns3/wildfire-message.h"
+#include "ns3/wildfire-message-store.h"
+#include "ns3/wildfire-mobility-trace.h"
 
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
 using namespace ns3;
 
-// This is an example TestCase.
-class WildfireTestCase1 : public TestCase
+namespace {
+
+bool g_countAllocations = false; //!< Whether operator new counts
+uint64_t g_allocations = 0; //!< Heap allocations while counting
+
+} // anonymous namespace
+
+// Replace the global allocator to count heap allocations.  The replacement
+// is global to the shared test-runner, not to this suite: every other suite
+// allocates through it too.  It only forwards to malloc and free and counts
+// nothing unless g_countAllocations is set, which only happens inside
+// WildfireMessageAllocationTestCase, so the other suites behave as with the
+// default allocator.  Array and nothrow forms reach it through the default
+// operator new[] and nothrow new.
+void*
+operator new (std::size_t size)
+{
+  if (g_countAllocations)
+    {
+      ++g_allocations;
+    }
+  void *p = std::malloc (size > 0 ? size : 1);
+  if (p == nullptr)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief Steady state send and receive of a WildfireMessage allocate no more
+ * than the ns-3 Packet itself
+ *
+ * The payload is longer than the short string buffer of the standard
+ * library, so it lives on the heap like a real alert text.  Each message
+ * operation is compared with the Packet operations it cannot avoid:
+ *
+ * - the first toPacket with Create<Packet> and AddHeader of the same bytes,
+ * - every later toPacket, a resend from the cached packet, with Packet::Copy,
+ * - decoding the received packet with RemoveHeader alone, plus the single
+ *   copy of the payload the decoded message keeps for the message store.
+ *
+ * Moves and serialization into a caller buffer must not allocate at all.
+ * The message is measured inside a simulator event, like a client handling
+ * packets in steady state.
+ */
+class WildfireMessageAllocationTestCase : public TestCase
+{
+public:
+  WildfireMessageAllocationTestCase ();
+  virtual ~WildfireMessageAllocationTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Count the allocations of the message operations and of the
+   * Packet operations they are compared with
+   */
+  void Measure (void);
+
+  /// Start counting heap allocations from zero
+  static void StartCounting (void);
+
+  /**
+   * \brief Stop counting heap allocations
+   * \return the allocations since StartCounting
+   */
+  static uint64_t StopCounting (void);
+
+  uint64_t m_probeAllocations; //!< Allocations of a probe the counter must see
+  uint64_t m_createAllocations; //!< Create<Packet> and AddHeader of the encoded bytes
+  uint64_t m_copyAllocations; //!< Packet::Copy of the encoded packet
+  uint64_t m_removeHeaderAllocations; //!< RemoveHeader of a received packet
+  uint64_t m_encodeAllocations; //!< First toPacket of the message
+  uint64_t m_resendAllocations; //!< Later toPacket of the message
+  uint64_t m_decodeAllocations; //!< RemoveHeader and decode of the received packet
+  uint64_t m_moveAllocations; //!< Moves and serialization into a caller buffer
+  bool m_roundTrip; //!< Whether the decoded copies matched the original
+  bool m_serialized; //!< Whether the message fit the caller buffer
+};
+
+WildfireMessageAllocationTestCase::WildfireMessageAllocationTestCase ()
+  : TestCase ("WildfireMessage send and receive allocate no more than the Packet"),
+    m_probeAllocations (0),
+    m_createAllocations (0),
+    m_copyAllocations (0),
+    m_removeHeaderAllocations (0),
+    m_encodeAllocations (0),
+    m_resendAllocations (0),
+    m_decodeAllocations (0),
+    m_moveAllocations (0),
+    m_roundTrip (false),
+    m_serialized (false)
+{
+}
+
+WildfireMessageAllocationTestCase::~WildfireMessageAllocationTestCase ()
+{
+}
+
+void
+WildfireMessageAllocationTestCase::StartCounting (void)
+{
+  g_allocations = 0;
+  g_countAllocations = true;
+}
+
+uint64_t
+WildfireMessageAllocationTestCase::StopCounting (void)
+{
+  g_countAllocations = false;
+  return g_allocations;
+}
+
+void
+WildfireMessageAllocationTestCase::Measure (void)
+{
+  Ed25519Seed privateKey;
+  privateKey.fill (7);
+  WildfireMessage original (7, WildfireMessageType::notification, Seconds (30),
+                            "Level 2 Alert, evacuate north on Highway 9");
+  original.setOrigin (3);
+  original.setZone (4, 2);
+  original.setPosition (Vector (250, -75, 0));
+  original.sign (privateKey);
+  WildfireHeader header = original.getHeader ();
+  const uint8_t *payload = reinterpret_cast<const uint8_t*> (original.getMessage ().data ());
+  uint32_t payloadSize = original.getMessage ().size ();
+  uint8_t buffer[256];
+
+  // The counter has to see allocations for the comparisons below to mean anything
+  StartCounting ();
+  std::vector<uint8_t> *probe = new std::vector<uint8_t> (64);
+  m_probeAllocations = StopCounting ();
+  delete probe;
+
+  // Packet operations the message cannot do without
+  StartCounting ();
+  Ptr<Packet> created = Create<Packet> (payload, payloadSize);
+  created->AddHeader (header);
+  m_createAllocations = StopCounting ();
+  StartCounting ();
+  Ptr<Packet> copied = created->Copy ();
+  m_copyAllocations = StopCounting ();
+  WildfireHeader removed;
+  StartCounting ();
+  copied->RemoveHeader (removed);
+  m_removeHeaderAllocations = StopCounting ();
+
+  // Send, the first toPacket encodes, the following ones resend the cached packet
+  StartCounting ();
+  Ptr<Packet> sent = original.toPacket (WildfireWireFormat::binary);
+  m_encodeAllocations = StopCounting ();
+  StartCounting ();
+  Ptr<Packet> resent = original.toPacket (WildfireWireFormat::binary);
+  m_resendAllocations = StopCounting ();
+  bool sameBytes = sent->GetSize () == resent->GetSize ();
+
+  // Receive, header straight from the packet then the payload
+  WildfireHeader received;
+  StartCounting ();
+  resent->RemoveHeader (received);
+  WildfireMessage decoded (received, resent);
+  m_decodeAllocations = StopCounting ();
+
+  StartCounting ();
+  WildfireMessage moved (std::move (decoded));
+  WildfireMessage moveAssigned;
+  moveAssigned = std::move (moved);
+  uint32_t size = moveAssigned.serialize (buffer, sizeof (buffer));
+  m_moveAllocations = StopCounting ();
+  m_serialized = size > 0 && size == original.getSerializedSize ();
+
+  WildfireMessage text (buffer, size);
+  m_roundTrip = sameBytes;
+  for (const WildfireMessage *copy : {&moveAssigned, &text})
+    {
+      m_roundTrip = m_roundTrip
+        && copy->getId () == original.getId ()
+        && copy->getOrigin () == original.getOrigin ()
+        && copy->getZone () == original.getZone ()
+        && copy->getVersion () == original.getVersion ()
+        && copy->getType () == original.getType ()
+        && copy->getExpiresAt () == original.getExpiresAt ()
+        && copy->getMessage () == original.getMessage ()
+        && copy->getHash () == original.getHash ()
+        && copy->getPosition ().x == original.getPosition ().x
+        && copy->getPosition ().y == original.getPosition ().y
+        && copy->isValid (Ed25519GetPublicKey (privateKey));
+    }
+}
+
+void
+WildfireMessageAllocationTestCase::DoRun (void)
+{
+  Simulator::Schedule (Seconds (1), &WildfireMessageAllocationTestCase::Measure, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_GT (m_probeAllocations, 0, "Allocation counter is not active");
+  NS_TEST_ASSERT_MSG_GT (m_createAllocations, 0, "Packet allocations not seen by the counter");
+  // Freed Packet buffers are recycled, the message may come in below the baselines
+  NS_TEST_ASSERT_MSG_EQ (m_encodeAllocations <= m_createAllocations, true,
+                         "First toPacket allocated " << m_encodeAllocations << " times, the Packet alone "
+                                                     << m_createAllocations);
+  NS_TEST_ASSERT_MSG_EQ (m_resendAllocations <= m_copyAllocations, true,
+                         "Resend allocated " << m_resendAllocations << " times, Packet::Copy "
+                                             << m_copyAllocations);
+  NS_TEST_ASSERT_MSG_EQ (m_decodeAllocations <= m_removeHeaderAllocations + 1, true,
+                         "Receive allocated " << m_decodeAllocations << " times, RemoveHeader "
+                                              << m_removeHeaderAllocations << " and the payload copy");
+  NS_TEST_ASSERT_MSG_EQ (m_moveAllocations, 0, "Move or serialize into a caller buffer allocated on the heap");
+  NS_TEST_ASSERT_MSG_EQ (m_serialized, true, "Message did not serialize into the caller buffer");
+  NS_TEST_ASSERT_MSG_EQ (m_roundTrip, true, "Binary or text round trip changed the message or broke its signature");
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief Ed25519 matches test vector 2 of RFC 8032 section 7.1
+ */
+class WildfireEd25519TestCase : public TestCase
+{
+public:
+  WildfireEd25519TestCase ();
+  virtual ~WildfireEd25519TestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+WildfireEd25519TestCase::WildfireEd25519TestCase ()
+  : TestCase ("Ed25519 keys and signatures match RFC 8032")
+{
+}
+
+WildfireEd25519TestCase::~WildfireEd25519TestCase ()
+{
+}
+
+void
+WildfireEd25519TestCase::DoRun (void)
+{
+  const Ed25519Seed seed = {{
+    0x4c, 0xcd, 0x08, 0x9b, 0x28, 0xff, 0x96, 0xda, 0x9d, 0xb6, 0xc3, 0x46, 0xec, 0x11, 0x4e, 0x0f,
+    0x5b, 0x8a, 0x31, 0x9f, 0x35, 0xab, 0xa6, 0x24, 0xda, 0x8c, 0xf6, 0xed, 0x4f, 0xb8, 0xa6, 0xfb
+  }};
+  const Ed25519PublicKey expectedKey = {{
+    0x3d, 0x40, 0x17, 0xc3, 0xe8, 0x43, 0x89, 0x5a, 0x92, 0xb7, 0x0a, 0xa7, 0x4d, 0x1b, 0x7e, 0xbc,
+    0x9c, 0x98, 0x2c, 0xcf, 0x2e, 0xc4, 0x96, 0x8c, 0xc0, 0xcd, 0x55, 0xf1, 0x2a, 0xf4, 0x66, 0x0c
+  }};
+  const Ed25519Signature expectedSignature = {{
+    0x92, 0xa0, 0x09, 0xa9, 0xf0, 0xd4, 0xca, 0xb8, 0x72, 0x0e, 0x82, 0x0b, 0x5f, 0x64, 0x25, 0x40,
+    0xa2, 0xb2, 0x7b, 0x54, 0x16, 0x50, 0x3f, 0x8f, 0xb3, 0x76, 0x22, 0x23, 0xeb, 0xdb, 0x69, 0xda,
+    0x08, 0x5a, 0xc1, 0xe4, 0x3e, 0x15, 0x99, 0x6e, 0x45, 0x8f, 0x36, 0x13, 0xd0, 0xf1, 0x1d, 0x8c,
+    0x38, 0x7b, 0x2e, 0xae, 0xb4, 0x30, 0x2a, 0xee, 0xb0, 0x0d, 0x29, 0x16, 0x12, 0xbb, 0x0c, 0x00
+  }};
+  const uint8_t message = 0x72;
+
+  Ed25519PublicKey publicKey = Ed25519GetPublicKey (seed);
+  NS_TEST_ASSERT_MSG_EQ ((publicKey == expectedKey), true, "Wrong public key");
+  Ed25519Signature signature = Ed25519Sign (seed, nullptr, 0, &message, 1);
+  NS_TEST_ASSERT_MSG_EQ ((signature == expectedSignature), true, "Wrong signature");
+  NS_TEST_ASSERT_MSG_EQ (Ed25519Verify (publicKey, signature, nullptr, 0, &message, 1), true,
+                         "Valid signature rejected");
+  const uint8_t other = 0x73;
+  NS_TEST_ASSERT_MSG_EQ (Ed25519Verify (publicKey, signature, nullptr, 0, &other, 1), false,
+                         "Signature of another message accepted");
+  signature[63] ^= 0x10;
+  NS_TEST_ASSERT_MSG_EQ (Ed25519Verify (publicKey, signature, nullptr, 0, &message, 1), false,
+                         "Altered signature accepted");
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief A forged copy reusing the id and hash of a verified notification
+ * is not answered from the verification cache
+ */
+class WildfireVerifyCacheTestCase : public TestCase
 {
 public:
-  WildfireTestCase1 ();
-  virtual ~WildfireTestCase1 ();
+  WildfireVerifyCacheTestCase ();
+  virtual ~WildfireVerifyCacheTestCase ();
 
 private:
   virtual void DoRun (void);
+
+  /**
+   * \brief Look the message up in the cache, verifying and inserting on a miss
+   * \param cache the verification cache
+   * \param message the received message
+   * \param key public key of the server
+   * \param hit set to whether the cache answered
+   * \return whether the message is accepted
+   */
+  bool Verify (WildfireVerifyCache &cache, const WildfireMessage &message, const Ed25519PublicKey &key, bool &hit);
 };
 
-// Add some help text to this case to describe what it is intended to test
-WildfireTestCase1::WildfireTestCase1 ()
-  : TestCase ("Wildfire test case (does nothing)")
+WildfireVerifyCacheTestCase::WildfireVerifyCacheTestCase ()
+  : TestCase ("WildfireVerifyCache only hits on identical signed content")
+{
+}
+
+WildfireVerifyCacheTestCase::~WildfireVerifyCacheTestCase ()
 {
 }
 
-// This destructor does nothing but we include it as a reminder that
-// the test case should clean up after itself
-WildfireTestCase1::~WildfireTestCase1 ()
+bool
+WildfireVerifyCacheTestCase::Verify (WildfireVerifyCache &cache, const WildfireMessage &message,
+                                     const Ed25519PublicKey &key, bool &hit)
 {
+  uint8_t fields[WildfireMessage::MAX_SIGNED_FIELDS_SIZE];
+  uint32_t fieldsSize = message.getSignedFields (fields);
+  const uint8_t *payload = reinterpret_cast<const uint8_t*> (message.getMessage ().data ());
+  bool valid = false;
+  hit = cache.Lookup (message.getId (), message.getHash (), fields, fieldsSize,
+                      payload, message.getMessage ().size (), valid);
+  if (!hit)
+    {
+      valid = message.isValid (key);
+      cache.Insert (message.getId (), message.getHash (), fields, fieldsSize,
+                    payload, message.getMessage ().size (), valid);
+    }
+  return valid;
 }
 
-//
-// This method is the pure virtual method from class TestCase that every
-// TestCase must implement
-//
 void
-WildfireTestCase1::DoRun (void)
+WildfireVerifyCacheTestCase::DoRun (void)
 {
-  // A wide variety of test macros are available in src/core/test.h
-  NS_TEST_ASSERT_MSG_EQ (true, true, "true doesn't equal true for some reason");
-  // Use this one for floating point comparisons
-  NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
+  Ed25519Seed privateKey;
+  privateKey.fill (7);
+  Ed25519PublicKey key = Ed25519GetPublicKey (privateKey);
+  WildfireMessage original (7, WildfireMessageType::notification, Seconds (30), "Level 2 Alert");
+  original.setOrigin (3);
+  original.setZone (4, 2);
+  original.sign (privateKey);
+
+  WildfireVerifyCache cache;
+  bool hit = false;
+  NS_TEST_ASSERT_MSG_EQ (Verify (cache, original, key, hit), true, "Signed notification rejected");
+  NS_TEST_ASSERT_MSG_EQ (hit, false, "Empty cache answered");
+  NS_TEST_ASSERT_MSG_EQ (Verify (cache, original, key, hit), true, "Cached notification rejected");
+  NS_TEST_ASSERT_MSG_EQ (hit, true, "Identical copy missed the cache");
+
+  // Same id and hash, every other signed field changed in turn
+  WildfireMessage forged = original;
+  forged.setZone (4, 3);
+  NS_TEST_ASSERT_MSG_EQ (Verify (cache, forged, key, hit), false, "Forged version accepted");
+  NS_TEST_ASSERT_MSG_EQ (hit, false, "Forged version answered from the cache");
+
+  forged = original;
+  forged.setOrigin (4);
+  NS_TEST_ASSERT_MSG_EQ (Verify (cache, forged, key, hit), false, "Forged origin accepted");
+
+  forged = original;
+  forged.setRoute (std::vector<Vector> (1, Vector (100, 200, 0)));
+  NS_TEST_ASSERT_MSG_EQ (Verify (cache, forged, key, hit), false, "Forged route accepted");
+
+  const uint8_t alert[] = "Level 0 Alert";
+  forged = WildfireMessage (original.getHeader (), Create<Packet> (alert, sizeof (alert) - 1));
+  NS_TEST_ASSERT_MSG_EQ (Verify (cache, forged, key, hit), false, "Forged payload accepted");
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief Digests go on the wire with the compact header and decode intact
+ */
+class WildfireCompactHeaderTestCase : public TestCase
+{
+public:
+  WildfireCompactHeaderTestCase ();
+  virtual ~WildfireCompactHeaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+WildfireCompactHeaderTestCase::WildfireCompactHeaderTestCase ()
+  : TestCase ("WildfireHeader drops hash and position from digests and pulls")
+{
+}
+
+WildfireCompactHeaderTestCase::~WildfireCompactHeaderTestCase ()
+{
+}
+
+void
+WildfireCompactHeaderTestCase::DoRun (void)
+{
+  WildfireMessage beacon (5, WildfireMessageType::digest, Seconds (1), "entries");
+  beacon.setOrigin (8);
+  beacon.setPosition (Vector (100, 200, 0));
+  Ptr<Packet> packet = beacon.toPacket (WildfireWireFormat::binary);
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), WildfireHeader::COMPACT_SIZE + beacon.getMessage ().size (),
+                         "Digest not sent with the compact header");
+
+  WildfireMessage decoded (packet, WildfireWireFormat::binary);
+  NS_TEST_ASSERT_MSG_EQ (decoded.getId (), 5, "Digest id changed");
+  NS_TEST_ASSERT_MSG_EQ (decoded.getOrigin (), 8, "Digest origin changed");
+  NS_TEST_ASSERT_MSG_EQ (decoded.getType (), WildfireMessageType::digest, "Digest type changed");
+  NS_TEST_ASSERT_MSG_EQ (decoded.getMessage (), beacon.getMessage (), "Digest payload changed");
+
+  WildfireMessage alert (6, WildfireMessageType::notification, Seconds (30), "Level 2 Alert");
+  NS_TEST_ASSERT_MSG_EQ (alert.toPacket (WildfireWireFormat::binary)->GetSize (),
+                         WildfireHeader::FULL_SIZE + alert.getMessage ().size (),
+                         "Notification not sent with the full header");
+
+  // Truncated datagrams are refused before the header is removed
+  Ptr<Packet> full = alert.toPacket (WildfireWireFormat::binary);
+  NS_TEST_ASSERT_MSG_EQ (WildfireHeader::IsComplete (full), true, "Whole notification refused");
+  NS_TEST_ASSERT_MSG_EQ (WildfireHeader::IsComplete (full->CreateFragment (0, WildfireHeader::FULL_SIZE - 1)), false,
+                         "Notification cut inside the header accepted");
+  Ptr<Packet> digestHeader = beacon.toPacket (WildfireWireFormat::binary)->CreateFragment (0, WildfireHeader::COMPACT_SIZE);
+  NS_TEST_ASSERT_MSG_EQ (WildfireHeader::IsComplete (digestHeader), true, "Digest with an empty payload refused");
+  NS_TEST_ASSERT_MSG_EQ (WildfireHeader::IsComplete (Create<Packet> (4)), false, "Runt datagram accepted");
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief A released slot carries no delivery state into its next subscriber
+ */
+class WildfireDeliveryLedgerTestCase : public TestCase
+{
+public:
+  WildfireDeliveryLedgerTestCase ();
+  virtual ~WildfireDeliveryLedgerTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+WildfireDeliveryLedgerTestCase::WildfireDeliveryLedgerTestCase ()
+  : TestCase ("WildfireDeliveryLedger forgets released slots")
+{
+}
+
+WildfireDeliveryLedgerTestCase::~WildfireDeliveryLedgerTestCase ()
+{
+}
+
+void
+WildfireDeliveryLedgerTestCase::DoRun (void)
+{
+  WildfireDeliveryLedger ledger;
+  ledger.Open (std::make_shared<const WildfireMessage> (9, WildfireMessageType::notification, Seconds (30),
+                                                        "Level 2 Alert"));
+  ledger.MarkSent (9, 3);
+  ledger.MarkSent (9, 70);
+  NS_TEST_ASSERT_MSG_EQ (ledger.MarkAcked (9, 3), true, "First ack not counted");
+
+  ledger.ReleaseSlot (3);
+  ledger.ReleaseSlot (70);
+  NS_TEST_ASSERT_MSG_EQ (ledger.IsAcked (9, 3), false, "Released slot still acked");
+  NS_TEST_ASSERT_MSG_EQ (ledger.MarkAcked (9, 3), false, "Ack from an unsent subscriber counted");
+  std::vector<uint32_t> unacked;
+  ledger.GetUnacked (9, unacked);
+  NS_TEST_ASSERT_MSG_EQ (unacked.size (), 0, "Released slot still retransmitted to");
+
+  // The next subscriber in the slot is tracked from scratch
+  ledger.MarkSent (9, 3);
+  ledger.GetUnacked (9, unacked);
+  NS_TEST_ASSERT_MSG_EQ (unacked.size (), 1, "Reused slot not sent");
+  NS_TEST_ASSERT_MSG_EQ (ledger.MarkAcked (9, 3), true, "Ack from the reused slot not counted");
+  NS_TEST_ASSERT_MSG_EQ (ledger.GetSent (9), 3, "Departed subscribers dropped from the sent count");
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief The message store holds notifications keyed on (origin, id), evicts
+ * the message closest to expiry when full and keeps its expiry heap compact
+ */
+class WildfireMessageStoreTestCase : public TestCase
+{
+public:
+  WildfireMessageStoreTestCase ();
+  virtual ~WildfireMessageStoreTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Notification from the given origin expiring at the given time
+  static WildfireMessage MakeNotification (uint32_t origin, uint32_t id, Time expiresAt);
+};
+
+WildfireMessageStoreTestCase::WildfireMessageStoreTestCase ()
+  : TestCase ("WildfireMessageStore capacity, expiry and keys")
+{
+}
+
+WildfireMessageStoreTestCase::~WildfireMessageStoreTestCase ()
+{
+}
+
+WildfireMessage
+WildfireMessageStoreTestCase::MakeNotification (uint32_t origin, uint32_t id, Time expiresAt)
+{
+  WildfireMessage message (id, WildfireMessageType::notification, expiresAt, "Level 2 Alert");
+  message.setOrigin (origin);
+  return message;
+}
+
+void
+WildfireMessageStoreTestCase::DoRun (void)
+{
+  WildfireMessageStore store;
+
+  // Only notifications are retained
+  WildfireMessage digest (1, WildfireMessageType::digest, Seconds (30), "");
+  NS_TEST_ASSERT_MSG_EQ (store.Insert (digest) == nullptr, true, "Digest stored");
+  WildfireMessage ack (1, WildfireMessageType::acknowledgement, Seconds (30), "");
+  NS_TEST_ASSERT_MSG_EQ (store.Insert (ack) == nullptr, true, "Acknowledgement stored");
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 0, "Non notification retained");
+
+  // The same id from two origins are two messages, the same (origin, id) is replaced
+  store.Insert (MakeNotification (1, 4, Seconds (30)));
+  store.Insert (MakeNotification (2, 4, Seconds (10)));
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 2, "Same id from another origin replaced");
+  store.Insert (MakeNotification (2, 4, Seconds (20)));
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 2, "Same (origin, id) stored twice");
+  NS_TEST_ASSERT_MSG_EQ (store.Find (2, 4)->getExpiresAt (), Seconds (20), "Same (origin, id) not replaced");
+  NS_TEST_ASSERT_MSG_EQ (store.Find (3, 4) == nullptr, true, "Unknown origin found");
+
+  // A full store evicts the message closest to expiry
+  store.SetCapacity (2);
+  store.Insert (MakeNotification (3, 5, Seconds (40)));
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 2, "Capacity exceeded");
+  NS_TEST_ASSERT_MSG_EQ (store.Find (2, 4) == nullptr, true, "Message closest to expiry kept");
+  NS_TEST_ASSERT_MSG_EQ (store.Find (3, 5) != nullptr, true, "New message not stored");
+  store.SetCapacity (1);
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 1, "Shrinking the capacity kept every message");
+  NS_TEST_ASSERT_MSG_EQ (store.Find (3, 5) != nullptr, true, "Shrinking the capacity evicted the latest expiry");
+
+  // Expired messages are evicted in expiry order
+  store.SetCapacity (8);
+  store.Insert (MakeNotification (1, 6, Seconds (15)));
+  store.Insert (MakeNotification (1, 7, Seconds (25)));
+  NS_TEST_ASSERT_MSG_EQ (store.GetNextExpiry (), Seconds (15), "Wrong next expiry");
+  NS_TEST_ASSERT_MSG_EQ (store.EvictExpired (Seconds (30)), 2, "Expired messages not evicted");
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 1, "Live message evicted");
+  NS_TEST_ASSERT_MSG_EQ (store.GetNextExpiry (), Seconds (40), "Wrong next expiry after eviction");
+
+  // Replacing and removing leaves stale heap entries, they never outnumber live ones
+  for (uint32_t i = 0; i < 100; ++i)
+    {
+      store.Insert (MakeNotification (3, 5, Seconds (41 + i)));
+      store.Insert (MakeNotification (4, i, Seconds (50)));
+      store.Remove (4, i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 1, "Removed messages retained");
+  NS_TEST_ASSERT_MSG_EQ (store.GetHeapSize () <= 2 * store.GetSize (), true, "Stale heap entries not compacted");
+  NS_TEST_ASSERT_MSG_EQ (store.GetNextExpiry (), Seconds (140), "Wrong next expiry after compaction");
+  NS_TEST_ASSERT_MSG_EQ (store.EvictExpired (Seconds (200)), 1, "Compacted message not evicted");
+  NS_TEST_ASSERT_MSG_EQ (store.GetNextExpiry (), Time::Max (), "Empty store still expires");
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief A newer version of a zone alert replaces the stored one and an
+ * older version is rejected
+ */
+class WildfireZoneSupersessionTestCase : public TestCase
+{
+public:
+  WildfireZoneSupersessionTestCase ();
+  virtual ~WildfireZoneSupersessionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+WildfireZoneSupersessionTestCase::WildfireZoneSupersessionTestCase ()
+  : TestCase ("WildfireMessageStore keeps the newest version of a zone alert")
+{
+}
+
+WildfireZoneSupersessionTestCase::~WildfireZoneSupersessionTestCase ()
+{
+}
+
+void
+WildfireZoneSupersessionTestCase::DoRun (void)
+{
+  WildfireMessageStore store;
+  WildfireMessage first (1, WildfireMessageType::notification, Seconds (30), "Level 1 Alert");
+  first.setOrigin (5);
+  first.setZone (7, 1);
+  WildfireMessage second (2, WildfireMessageType::notification, Seconds (40), "Level 2 Alert");
+  second.setOrigin (5);
+  second.setZone (7, 2);
+  WildfireMessage third (3, WildfireMessageType::notification, Seconds (50), "Level 3 Alert");
+  third.setOrigin (5);
+  third.setZone (7, 3);
+
+  NS_TEST_ASSERT_MSG_EQ (store.Insert (first) != nullptr, true, "First version refused");
+  NS_TEST_ASSERT_MSG_EQ (store.Insert (third) != nullptr, true, "Newer version refused");
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 1, "Newer version stored beside the old one");
+  NS_TEST_ASSERT_MSG_EQ (store.FindZone (5, 7)->getVersion (), 3, "Newer version did not replace the old one");
+
+  NS_TEST_ASSERT_MSG_EQ (store.Insert (second) == nullptr, true, "Older version accepted");
+  NS_TEST_ASSERT_MSG_EQ (store.Insert (third) == nullptr, true, "Same version accepted again");
+  NS_TEST_ASSERT_MSG_EQ (store.FindZone (5, 7)->getMessage (), "Level 3 Alert", "Older version replaced the stored one");
+  NS_TEST_ASSERT_MSG_EQ (store.GetNextExpiry (), Seconds (50), "Replaced version still expires");
+
+  // Zones are per origin, another node's alert for the same zone is kept apart
+  second.setOrigin (6);
+  NS_TEST_ASSERT_MSG_EQ (store.Insert (second) != nullptr, true, "Alert of another origin refused");
+  NS_TEST_ASSERT_MSG_EQ (store.GetSize (), 2, "Alert of another origin replaced the stored one");
+  NS_TEST_ASSERT_MSG_EQ (store.FindZone (5, 7)->getVersion (), 3, "Alert of another origin superseded");
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief A CSV log converted to a trace file reads back relative to its
+ * earliest fix, and a log out of time order is refused
+ */
+class WildfireMobilityTraceTestCase : public TestCase
+{
+public:
+  WildfireMobilityTraceTestCase ();
+  virtual ~WildfireMobilityTraceTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+WildfireMobilityTraceTestCase::WildfireMobilityTraceTestCase ()
+  : TestCase ("WildfireMobilityTrace CSV round trip")
+{
+}
+
+WildfireMobilityTraceTestCase::~WildfireMobilityTraceTestCase ()
+{
+}
+
+void
+WildfireMobilityTraceTestCase::DoRun (void)
+{
+  std::string csvFilename = CreateTempDirFilename ("wildfire-trace.csv");
+  std::string traceFilename = CreateTempDirFilename ("wildfire-trace.wft");
+  std::ofstream csv (csvFilename.c_str ());
+  csv << "node,time,x,y\n"
+      << "# epoch stamped, nodes interleaved\n"
+      << "7,1700000010.5,500123.456,4100456.789\n"
+      << "3,1700000000.25,500000.001,4100000.002\n"
+      << "\n"
+      << "7,1700000020,500200.125,4100500.5\n";
+  csv.close ();
+  NS_TEST_ASSERT_MSG_EQ (WildfireMobilityTrace::ConvertCsv (csvFilename, traceFilename), true, "Conversion failed");
+
+  WildfireMobilityTrace trace;
+  NS_TEST_ASSERT_MSG_EQ (trace.Open (traceFilename), true, "Trace file refused");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNNodes (), 2, "Wrong node count");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNFixes (0), 1, "Wrong fix count of node 3");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNFixes (1), 2, "Wrong fix count of node 7");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetTimeOrigin (), 1700000000.25, "Time origin is not the earliest fix");
+
+  // Times come back relative to the earliest fix, shifted by the offset
+  trace.SetTimeOffset (Seconds (2));
+  WildfireMobilityTrace::Fix fix;
+  NS_TEST_ASSERT_MSG_EQ (trace.ReadFix (0, 0, fix), true, "First fix of node 3 missing");
+  NS_TEST_ASSERT_MSG_EQ (fix.time, Seconds (2), "Earliest fix not at the time offset");
+  NS_TEST_ASSERT_MSG_EQ (fix.position.x, 500000.001, "Position lost precision");
+  NS_TEST_ASSERT_MSG_EQ (fix.position.y, 4100000.002, "Position lost precision");
+  NS_TEST_ASSERT_MSG_EQ (trace.ReadFix (1, 0, fix), true, "First fix of node 7 missing");
+  NS_TEST_ASSERT_MSG_EQ (fix.time, Seconds (12.25), "Wrong relative time");
+  NS_TEST_ASSERT_MSG_EQ (trace.ReadFix (1, 1, fix), true, "Second fix of node 7 missing");
+  NS_TEST_ASSERT_MSG_EQ (fix.time, Seconds (21.75), "Wrong relative time");
+  NS_TEST_ASSERT_MSG_EQ (fix.position.x, 500200.125, "Wrong position");
+  NS_TEST_ASSERT_MSG_EQ (fix.position.y, 4100500.5, "Wrong position");
+  NS_TEST_ASSERT_MSG_EQ (trace.ReadFix (1, 2, fix), false, "Fix read past the last one");
+
+  // A node going back in time is refused
+  csv.open (csvFilename.c_str ());
+  csv << "1,2,0,0\n"
+      << "2,1,0,0\n"
+      << "1,1,0,0\n";
+  csv.close ();
+  NS_TEST_ASSERT_MSG_EQ (WildfireMobilityTrace::ConvertCsv (csvFilename, traceFilename), false,
+                         "Fixes out of time order accepted");
+}
+
+/**
+ * \ingroup Wildfire
+ * \brief A client acks every server copy of a notification, not only the
+ * first one, so retransmissions to unacked subscribers are answered
+ */
+class WildfireServerRetryAckTestCase : public TestCase
+{
+public:
+  WildfireServerRetryAckTestCase ();
+  virtual ~WildfireServerRetryAckTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Send the notification from the server socket to the client
+  void SendNotification (void);
+
+  /**
+   * \brief Count the acks of the notification arriving at the server
+   * \param socket the server socket
+   */
+  void ReceiveAck (Ptr<Socket> socket);
+
+  Ptr<Socket> m_server; //!< Socket standing in for the WildfireServer
+  Address m_client; //!< Listening address of the client
+  WildfireMessage m_notification; //!< Signed notification retransmitted
+  uint32_t m_acks; //!< Acks of m_notification received
+};
+
+WildfireServerRetryAckTestCase::WildfireServerRetryAckTestCase ()
+  : TestCase ("WildfireClient acks a server retransmission of a seen notification"),
+    m_acks (0)
+{
+}
+
+WildfireServerRetryAckTestCase::~WildfireServerRetryAckTestCase ()
+{
+}
+
+void
+WildfireServerRetryAckTestCase::SendNotification (void)
+{
+  m_server->SendTo (m_notification.toPacket (WildfireWireFormat::binary), 0, m_client);
+}
+
+void
+WildfireServerRetryAckTestCase::ReceiveAck (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+    {
+      WildfireMessage message (packet, WildfireWireFormat::binary);
+      if (message.getType () == WildfireMessageType::acknowledgement
+          && message.getId () == m_notification.getId ())
+        {
+          ++m_acks;
+        }
+    }
+}
+
+void
+WildfireServerRetryAckTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  SimpleNetDeviceHelper simple;
+  NetDeviceContainer devices = simple.Install (nodes);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = ipv4.Assign (devices);
+
+  const uint16_t serverPort = 4000;
+  const uint16_t clientPort = 9;
+  m_server = Socket::CreateSocket (nodes.Get (0), UdpSocketFactory::GetTypeId ());
+  m_server->Bind (InetSocketAddress (Ipv4Address::GetAny (), serverPort));
+  m_server->SetRecvCallback (MakeCallback (&WildfireServerRetryAckTestCase::ReceiveAck, this));
+  m_client = InetSocketAddress (interfaces.GetAddress (1), clientPort);
+
+  Ed25519Seed privateKey;
+  privateKey.fill (7);
+  m_notification = WildfireMessage (7, WildfireMessageType::notification, Seconds (60), "Level 2 Alert");
+  m_notification.setOrigin (nodes.Get (0)->GetId ());
+  m_notification.sign (privateKey);
+
+  Ptr<WildfireClient> client = CreateObject<WildfireClient> ();
+  client->SetAttribute ("RemoteAddress", AddressValue (interfaces.GetAddress (0)));
+  client->SetAttribute ("RemotePort", UintegerValue (serverPort));
+  client->SetAttribute ("Port", UintegerValue (clientPort));
+  client->SetServerKey (Ed25519GetPublicKey (privateKey));
+  nodes.Get (1)->AddApplication (client);
+  client->SetStartTime (Seconds (0));
+  client->SetStopTime (Seconds (5));
+
+  // The second copy is the retransmission of CheckDelivery, well inside
+  // the seen filter aging
+  Simulator::Schedule (Seconds (1), &WildfireServerRetryAckTestCase::SendNotification, this);
+  Simulator::Schedule (Seconds (2), &WildfireServerRetryAckTestCase::SendNotification, this);
+  Simulator::Stop (Seconds (6));
+  Simulator::Run ();
+  m_server->Close ();
+  m_server = 0;
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_acks, 2, "Server retransmission of a seen notification was not acked");
 }
 
-// The TestSuite class names the TestSuite, identifies what type of TestSuite,
-// and enables the TestCases to be run.  Typically, only the constructor for
-// this class must be defined
-//
+/**
+ * \ingroup Wildfire
+ * \brief Wildfire module test suite
+ */
 class WildfireTestSuite : public TestSuite
 {
 public:
@@ -59,10 +855,16 @@ public:
 WildfireTestSuite::WildfireTestSuite ()
   : TestSuite ("wildfire", UNIT)
 {
-  // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
-  AddTestCase (new WildfireTestCase1, TestCase::QUICK);
+  AddTestCase (new WildfireMessageAllocationTestCase, TestCase::QUICK);
+  AddTestCase (new WildfireEd25519TestCase, TestCase::QUICK);
+  AddTestCase (new WildfireVerifyCacheTestCase, TestCase::QUICK);
+  AddTestCase (new WildfireCompactHeaderTestCase, TestCase::QUICK);
+  AddTestCase (new WildfireDeliveryLedgerTestCase, TestCase::QUICK);
+  AddTestCase (new WildfireMessageStoreTestCase, TestCase::QUICK);
+  AddTestCase (new WildfireZoneSupersessionTestCase, TestCase::QUICK);
+  AddTestCase (new WildfireMobilityTraceTestCase, TestCase::QUICK);
+  AddTestCase (new WildfireServerRetryAckTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
-static WildfireTestSuite swildfireTestSuite;
-*/
+static WildfireTestSuite g_wildfireTestSuite;